@@ -0,0 +1,914 @@
+#include "IfcClashDetector.h"
+#include "MeshView.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+    constexpr double Infinity = std::numeric_limits<double>::infinity();
+
+    // Elements per leaf of the hierarchy
+    constexpr size_t LeafSize = 4;
+
+    // Subtrees larger than this are built by another task
+    constexpr size_t BuildGrain = 16384;
+
+    // Elements queried, and candidate pairs tested, by one task at least
+    constexpr size_t BroadGrain = 1024;
+    constexpr size_t NarrowGrain = 64;
+
+    // Sample points of an element tested inside the other one for containment
+    constexpr size_t ContainmentSamples = 3;
+
+    // Rounding error bound of the single precision rejections, relative to the largest coordinate about their origin
+    constexpr double RejectionSlack = 32.0 * FLT_EPSILON;
+
+    struct Vec3 {
+        double x, y, z;
+    };
+
+    Vec3 operator+(const Vec3& a, const Vec3& b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+    Vec3 operator-(const Vec3& a, const Vec3& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+    Vec3 operator*(const Vec3& a, double s) { return {a.x * s, a.y * s, a.z * s}; }
+    double dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Vec3 cross(const Vec3& a, const Vec3& b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+
+    struct Box {
+        double lo[3] = {Infinity, Infinity, Infinity};
+        double hi[3] = {-Infinity, -Infinity, -Infinity};
+
+        bool isEmpty() const { return !(lo[0] <= hi[0] && lo[1] <= hi[1] && lo[2] <= hi[2]); }
+        double extent(int axis) const { return hi[axis] - lo[axis]; }
+        double minExtent() const { return std::min({extent(0), extent(1), extent(2)}); }
+        Vec3 center() const { return {0.5 * (lo[0] + hi[0]), 0.5 * (lo[1] + hi[1]), 0.5 * (lo[2] + hi[2])}; }
+
+        void add(double x, double y, double z) {
+            lo[0] = std::min(lo[0], x); hi[0] = std::max(hi[0], x);
+            lo[1] = std::min(lo[1], y); hi[1] = std::max(hi[1], y);
+            lo[2] = std::min(lo[2], z); hi[2] = std::max(hi[2], z);
+        }
+        void add(const Box& other) {
+            for (int axis = 0; axis < 3; ++axis) {
+                lo[axis] = std::min(lo[axis], other.lo[axis]);
+                hi[axis] = std::max(hi[axis], other.hi[axis]);
+            }
+        }
+        // Grown by margin on every side, shrunk if it is negative
+        Box expanded(double margin) const {
+            Box box;
+            for (int axis = 0; axis < 3; ++axis) {
+                box.lo[axis] = lo[axis] - margin;
+                box.hi[axis] = hi[axis] + margin;
+            }
+            return box;
+        }
+        bool overlaps(const Box& other) const {
+            return lo[0] <= other.hi[0] && hi[0] >= other.lo[0]
+                && lo[1] <= other.hi[1] && hi[1] >= other.lo[1]
+                && lo[2] <= other.hi[2] && hi[2] >= other.lo[2];
+        }
+        bool contains(const Box& other) const {
+            return lo[0] <= other.lo[0] && hi[0] >= other.hi[0]
+                && lo[1] <= other.lo[1] && hi[1] >= other.hi[1]
+                && lo[2] <= other.lo[2] && hi[2] >= other.hi[2];
+        }
+        Box intersection(const Box& other) const {
+            Box box;
+            for (int axis = 0; axis < 3; ++axis) {
+                box.lo[axis] = std::max(lo[axis], other.lo[axis]);
+                box.hi[axis] = std::min(hi[axis], other.hi[axis]);
+            }
+            return box;
+        }
+    };
+
+    // World triangles of an element as structure of arrays, so that one triangle is tested against many in vector loops
+    struct Triangles {
+        std::vector<double> ax, ay, az, bx, by, bz, cx, cy, cz; // vertices
+        std::vector<double> nx, ny, nz, d;                      // unit normal and offset of the plane
+        std::vector<double> lox, loy, loz, hix, hiy, hiz;       // bounds
+
+        size_t size() const { return ax.size(); }
+        Vec3 a(size_t t) const { return {ax[t], ay[t], az[t]}; }
+        Vec3 b(size_t t) const { return {bx[t], by[t], bz[t]}; }
+        Vec3 c(size_t t) const { return {cx[t], cy[t], cz[t]}; }
+        Vec3 normal(size_t t) const { return {nx[t], ny[t], nz[t]}; }
+        Box box(size_t t) const {
+            Box box;
+            box.lo[0] = lox[t]; box.lo[1] = loy[t]; box.lo[2] = loz[t];
+            box.hi[0] = hix[t]; box.hi[1] = hiy[t]; box.hi[2] = hiz[t];
+            return box;
+        }
+
+        void clear() {
+            for (auto* pArray : {&ax, &ay, &az, &bx, &by, &bz, &cx, &cy, &cz, &nx, &ny, &nz, &d, &lox, &loy, &loz, &hix, &hiy, &hiz})
+                pArray->clear();
+        }
+
+        // Add the triangle of the 9 coordinates unless it is degenerate or outside the clip box
+        void add(const double* p, const Box& clip) {
+            const double lx = std::min({p[0], p[3], p[6]}), hx = std::max({p[0], p[3], p[6]});
+            const double ly = std::min({p[1], p[4], p[7]}), hy = std::max({p[1], p[4], p[7]});
+            const double lz = std::min({p[2], p[5], p[8]}), hz = std::max({p[2], p[5], p[8]});
+            if (lx > clip.hi[0] || hx < clip.lo[0] || ly > clip.hi[1] || hy < clip.lo[1] || lz > clip.hi[2] || hz < clip.lo[2])
+                return;
+
+            const Vec3 n = cross(Vec3{p[3] - p[0], p[4] - p[1], p[5] - p[2]}, Vec3{p[6] - p[0], p[7] - p[1], p[8] - p[2]});
+            const double length = std::sqrt(dot(n, n));
+            if (!(length > 1e-14))
+                return;
+
+            ax.push_back(p[0]); ay.push_back(p[1]); az.push_back(p[2]);
+            bx.push_back(p[3]); by.push_back(p[4]); bz.push_back(p[5]);
+            cx.push_back(p[6]); cy.push_back(p[7]); cz.push_back(p[8]);
+            nx.push_back(n.x / length); ny.push_back(n.y / length); nz.push_back(n.z / length);
+            d.push_back((n.x * p[0] + n.y * p[1] + n.z * p[2]) / length);
+            lox.push_back(lx); loy.push_back(ly); loz.push_back(lz);
+            hix.push_back(hx); hiy.push_back(hy); hiz.push_back(hz);
+        }
+    };
+
+    // Selects rather than std::min and std::max, which return references, so that the rejection loops vectorize
+    inline float minOf(float a, float b) { return a < b ? a : b; }
+    inline float maxOf(float a, float b) { return a > b ? a : b; }
+
+    // max(a, 0) without a select: a product of a select with itself is moved to a branch, which cannot be if-converted
+    inline float positivePart(float a) { return 0.5f * (a + std::abs(a)); }
+
+    /*
+     * Single precision copy of triangles about an origin, for the rejection loops: twice as many lanes per vector
+     * as doubles, and lanes as wide as the int32 masks. The rejections widen their bounds by slack,
+     * they keep every triangle pair the exact tests in double precision could keep.
+     */
+    struct RejectionTriangles {
+        std::vector<float> ax, ay, az, bx, by, bz, cx, cy, cz;
+        std::vector<float> nx, ny, nz, d;
+        std::vector<float> lox, loy, loz, hix, hiy, hiz;
+        Vec3 origin{};
+        float slack = 0.0f;
+
+        /**
+         * @param origin: center of the pair, eg. of the box of the other element
+         * @param radius: largest coordinate of the other element about origin
+         */
+        void assign(const Triangles& triangles, const Vec3& origin, double radius) {
+            this->origin = origin;
+            const size_t n = triangles.size();
+            for (auto* pArray : {&ax, &ay, &az, &bx, &by, &bz, &cx, &cy, &cz, &nx, &ny, &nz, &d, &lox, &loy, &loz, &hix, &hiy, &hiz})
+                pArray->resize(n);
+            for (size_t t = 0; t < n; ++t) {
+                ax[t] = float(triangles.ax[t] - origin.x); ay[t] = float(triangles.ay[t] - origin.y); az[t] = float(triangles.az[t] - origin.z);
+                bx[t] = float(triangles.bx[t] - origin.x); by[t] = float(triangles.by[t] - origin.y); bz[t] = float(triangles.bz[t] - origin.z);
+                cx[t] = float(triangles.cx[t] - origin.x); cy[t] = float(triangles.cy[t] - origin.y); cz[t] = float(triangles.cz[t] - origin.z);
+                nx[t] = float(triangles.nx[t]); ny[t] = float(triangles.ny[t]); nz[t] = float(triangles.nz[t]);
+                d[t] = float(triangles.d[t] - dot(triangles.normal(t), origin));
+                lox[t] = float(triangles.lox[t] - origin.x); loy[t] = float(triangles.loy[t] - origin.y); loz[t] = float(triangles.loz[t] - origin.z);
+                hix[t] = float(triangles.hix[t] - origin.x); hiy[t] = float(triangles.hiy[t] - origin.y); hiz[t] = float(triangles.hiz[t] - origin.z);
+                radius = std::max({radius, -double(lox[t]), -double(loy[t]), -double(loz[t]), double(hix[t]), double(hiy[t]), double(hiz[t])});
+            }
+            slack = float(RejectionSlack * (radius + 1.0));
+        }
+    };
+
+    // Scratch arrays of a worker
+    struct NarrowScratch {
+        Triangles trianglesA, trianglesB, outer;
+        RejectionTriangles rejectionB;
+        std::vector<int32_t> mask;
+        std::vector<float> gap;
+    };
+
+    template<typename Visit>
+    void forEachPosition(const SceneData::Mesh& mesh, Visit&& visit) {
+        if (!mesh.packedVertices.empty())
+            for (const auto& v : mesh.packedVertices)
+                visit(v.x, v.y, v.z);
+        else
+            for (const auto& v : mesh.vertices)
+                visit(v.x, v.y, v.z);
+    }
+
+    Box localBounds(const std::vector<SceneData::Mesh>& meshes) {
+        Box box;
+        for (const auto& mesh : meshes) {
+            MeshView view(mesh);
+            forEachPosition(view.mesh(), [&](double x, double y, double z) { box.add(x, y, z); });
+        }
+        return box;
+    }
+
+    // Column-major matrix, see SceneData::Matrix4x4
+    Vec3 transformPoint(const float* m, double x, double y, double z) {
+        return {m[0] * x + m[4] * y + m[8] * z + m[12],
+                m[1] * x + m[5] * y + m[9] * z + m[13],
+                m[2] * x + m[6] * y + m[10] * z + m[14]};
+    }
+
+    Box worldBounds(const Box& local, const float* m) {
+        Box box;
+        if (local.isEmpty())
+            return box;
+        for (int corner = 0; corner < 8; ++corner) {
+            Vec3 p = transformPoint(m, (corner & 1) ? local.hi[0] : local.lo[0],
+                                       (corner & 2) ? local.hi[1] : local.lo[1],
+                                       (corner & 4) ? local.hi[2] : local.lo[2]);
+            box.add(p.x, p.y, p.z);
+        }
+        return box;
+    }
+
+    void collectTriangles(const SceneData::Object& object, const Box& clip, Triangles& triangles) {
+        triangles.clear();
+        const float* m = object.transform.m;
+        for (const auto& mesh : *object.meshes) {
+            MeshView view(mesh);
+            const SceneData::Mesh& data = view.mesh();
+            const bool packed = !data.packedVertices.empty();
+            const size_t nVertices = packed ? data.packedVertices.size() : data.vertices.size();
+            auto position = [&](size_t i, double* out) {
+                Vec3 p = packed ? transformPoint(m, data.packedVertices[i].x, data.packedVertices[i].y, data.packedVertices[i].z)
+                                : transformPoint(m, data.vertices[i].x, data.vertices[i].y, data.vertices[i].z);
+                out[0] = p.x; out[1] = p.y; out[2] = p.z;
+            };
+            double p[9];
+            for (size_t i = 0; i + 2 < nVertices; i += 3) {
+                position(i, p);
+                position(i + 1, p + 3);
+                position(i + 2, p + 6);
+                triangles.add(p, clip);
+            }
+        }
+    }
+
+    /*
+     * Hierarchy of the element boxes, split at the median of the longest axis of the centers.
+     * Nodes are stored in one array, the two children of a node next to each other.
+     */
+    class Bvh {
+    public:
+        void build(const std::vector<Box>& boxes) {
+            m_pBoxes = &boxes;
+            const size_t n = boxes.size();
+            m_order.resize(n);
+            std::iota(m_order.begin(), m_order.end(), 0u);
+            m_centers.resize(n);
+            for (size_t i = 0; i < n; ++i)
+                m_centers[i] = boxes[i].center();
+
+            //median splits with leaves of at most LeafSize elements need less than 2n nodes
+            m_nodes.assign(std::max<size_t>(1, 2 * n), Node());
+            m_nNodes = 1;
+            if (n) {
+                TaskGroup group;
+                buildNode(0, 0, n, group);
+                group.wait();
+            }
+            m_nodes.resize(m_nNodes);
+            m_centers = {};
+        }
+
+        const std::vector<uint32_t>& order() const { return m_order; }
+
+        // visit(element) for every element whose box overlaps box
+        template<typename Visit>
+        void query(const Box& box, Visit&& visit) const {
+            if (m_order.empty())
+                return;
+            uint32_t stack[64];
+            int top = 0;
+            stack[top++] = 0;
+            while (top) {
+                const Node& node = m_nodes[stack[--top]];
+                if (!node.box.overlaps(box))
+                    continue;
+                if (node.count) {
+                    for (uint32_t k = node.first; k < node.first + node.count; ++k)
+                        if ((*m_pBoxes)[m_order[k]].overlaps(box))
+                            visit(m_order[k]);
+                }
+                else {
+                    stack[top++] = node.first;
+                    stack[top++] = node.first + 1;
+                }
+            }
+        }
+
+    private:
+        struct Node {
+            Box box;
+            uint32_t first = 0; // first element of a leaf, first child of an inner node
+            uint32_t count = 0; // elements of a leaf, 0 for an inner node
+        };
+
+        const std::vector<Box>* m_pBoxes = nullptr;
+        std::vector<uint32_t> m_order;
+        std::vector<Vec3> m_centers;
+        std::vector<Node> m_nodes;
+        std::atomic<uint32_t> m_nNodes{0};
+
+        void buildNode(uint32_t index, size_t first, size_t last, TaskGroup& group) {
+            Node& node = m_nodes[index];
+            Box centers;
+            for (size_t k = first; k < last; ++k) {
+                node.box.add((*m_pBoxes)[m_order[k]]);
+                const Vec3& c = m_centers[m_order[k]];
+                centers.add(c.x, c.y, c.z);
+            }
+            if (last - first <= LeafSize) {
+                node.first = static_cast<uint32_t>(first);
+                node.count = static_cast<uint32_t>(last - first);
+                return;
+            }
+
+            int axis = 0;
+            if (centers.extent(1) > centers.extent(axis))
+                axis = 1;
+            if (centers.extent(2) > centers.extent(axis))
+                axis = 2;
+            const size_t mid = first + (last - first) / 2;
+            std::nth_element(m_order.begin() + first, m_order.begin() + mid, m_order.begin() + last, [&](uint32_t a, uint32_t b) {
+                const Vec3& ca = m_centers[a];
+                const Vec3& cb = m_centers[b];
+                return axis == 0 ? ca.x < cb.x : axis == 1 ? ca.y < cb.y : ca.z < cb.z;
+            });
+
+            const uint32_t children = m_nNodes.fetch_add(2);
+            node.first = children;
+            node.count = 0;
+            if (last - first > BuildGrain)
+                group.run([this, children, first, mid, &group]() { buildNode(children, first, mid, group); });
+            else
+                buildNode(children, first, mid, group);
+            buildNode(children + 1, mid, last, group);
+        }
+    };
+
+    // Ericson, Real-Time Collision Detection 5.1.5
+    Vec3 closestOnTriangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c) {
+        const Vec3 ab = b - a, ac = c - a, ap = p - a;
+        const double d1 = dot(ab, ap), d2 = dot(ac, ap);
+        if (d1 <= 0.0 && d2 <= 0.0)
+            return a;
+        const Vec3 bp = p - b;
+        const double d3 = dot(ab, bp), d4 = dot(ac, bp);
+        if (d3 >= 0.0 && d4 <= d3)
+            return b;
+        const double vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+            return a + ab * (d1 / (d1 - d3));
+        const Vec3 cp = p - c;
+        const double d5 = dot(ab, cp), d6 = dot(ac, cp);
+        if (d6 >= 0.0 && d5 <= d6)
+            return c;
+        const double vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+            return a + ac * (d2 / (d2 - d6));
+        const double va = d3 * d6 - d5 * d4;
+        if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        const double denom = 1.0 / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+    // Ericson 5.1.9, the segments are not degenerate
+    void closestOnSegments(const Vec3& p1, const Vec3& q1, const Vec3& p2, const Vec3& q2, Vec3& c1, Vec3& c2) {
+        const Vec3 d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+        const double a = dot(d1, d1), e = dot(d2, d2), f = dot(d2, r);
+        const double c = dot(d1, r), b = dot(d1, d2);
+        const double denom = a * e - b * b;
+        double s = denom > 0.0 ? std::clamp((b * f - c * e) / denom, 0.0, 1.0) : 0.0;
+        double t = (b * s + f) / e;
+        if (t < 0.0) {
+            t = 0.0;
+            s = std::clamp(-c / a, 0.0, 1.0);
+        }
+        else if (t > 1.0) {
+            t = 1.0;
+            s = std::clamp((b - c) / a, 0.0, 1.0);
+        }
+        c1 = p1 + d1 * s;
+        c2 = p2 + d2 * t;
+    }
+
+    // Distance between two triangles which do not cross: reached at a vertex of one of them or between two edges
+    double triangleDistance(const Triangles& A, size_t a, const Triangles& B, size_t b, Vec3& pointA, Vec3& pointB) {
+        const Vec3 ta[3] = {A.a(a), A.b(a), A.c(a)};
+        const Vec3 tb[3] = {B.a(b), B.b(b), B.c(b)};
+        double best = Infinity;
+        auto consider = [&](const Vec3& pa, const Vec3& pb) {
+            const Vec3 delta = pa - pb;
+            const double d2 = dot(delta, delta);
+            if (d2 < best) {
+                best = d2;
+                pointA = pa;
+                pointB = pb;
+            }
+        };
+        for (int i = 0; i < 3; ++i) {
+            consider(ta[i], closestOnTriangle(ta[i], tb[0], tb[1], tb[2]));
+            consider(closestOnTriangle(tb[i], ta[0], ta[1], ta[2]), tb[i]);
+        }
+        Vec3 ca, cb;
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j) {
+                closestOnSegments(ta[i], ta[(i + 1) % 3], tb[j], tb[(j + 1) % 3], ca, cb);
+                consider(ca, cb);
+            }
+        return std::sqrt(best);
+    }
+
+    // Interval of a triangle crossing a plane on the intersection line of direction dir, from the signed distances of its vertices
+    void lineInterval(const Vec3 (&p)[3], const double (&dist)[3], const Vec3& dir, double& lo, double& hi) {
+        lo = Infinity;
+        hi = -Infinity;
+        double s[3];
+        for (int i = 0; i < 3; ++i) {
+            s[i] = dot(p[i], dir);
+            if (dist[i] == 0.0) {
+                lo = std::min(lo, s[i]);
+                hi = std::max(hi, s[i]);
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            const int j = (i + 1) % 3;
+            if (dist[i] * dist[j] < 0.0) {
+                const double sCross = s[i] + (s[j] - s[i]) * dist[i] / (dist[i] - dist[j]);
+                lo = std::min(lo, sCross);
+                hi = std::max(hi, sCross);
+            }
+        }
+    }
+
+    // Moller's interval test, for triangles each crossing the plane of the other; touching within tolerance is not crossing
+    bool trianglesCross(const Triangles& A, size_t a, const Triangles& B, size_t b, double tolerance) {
+        const Vec3 pa[3] = {A.a(a), A.b(a), A.c(a)};
+        const Vec3 pb[3] = {B.a(b), B.b(b), B.c(b)};
+        const Vec3 na = A.normal(a), nb = B.normal(b);
+        auto snap = [tolerance](double value) { return std::abs(value) <= tolerance ? 0.0 : value; };
+        double da[3], db[3];
+        for (int i = 0; i < 3; ++i) {
+            da[i] = snap(dot(nb, pa[i]) - B.d[b]);
+            db[i] = snap(dot(na, pb[i]) - A.d[a]);
+        }
+
+        Vec3 dir = cross(na, nb);
+        const double length = std::sqrt(dot(dir, dir));
+        if (length < 1e-12)
+            return false;
+        dir = dir * (1.0 / length);
+
+        double loA, hiA, loB, hiB;
+        lineInterval(pa, da, dir, loA, hiA);
+        lineInterval(pb, db, dir, loB, hiB);
+        return std::min(hiA, hiB) - std::max(loA, loB) > tolerance;
+    }
+
+    /**
+     * Triangles of A and B crossing each other, with the bounds of the crossing triangles of each side
+     * @param clipA: triangles of A outside of it are skipped
+     * @param R: rejection copy of B
+     * @return number of exact tests
+     */
+    size_t findCrossings(const Triangles& A, const Box& clipA, const Triangles& B, const RejectionTriangles& R, double tolerance,
+                         NarrowScratch& scratch, Box& crossingA, Box& crossingB) {
+        const size_t nB = B.size();
+        scratch.mask.resize(nB);
+        int32_t* __restrict mask = scratch.mask.data();
+        const float* __restrict bax = R.ax.data(); const float* __restrict bay = R.ay.data(); const float* __restrict baz = R.az.data();
+        const float* __restrict bbx = R.bx.data(); const float* __restrict bby = R.by.data(); const float* __restrict bbz = R.bz.data();
+        const float* __restrict bcx = R.cx.data(); const float* __restrict bcy = R.cy.data(); const float* __restrict bcz = R.cz.data();
+        const float* __restrict bnx = R.nx.data(); const float* __restrict bny = R.ny.data(); const float* __restrict bnz = R.nz.data();
+        const float* __restrict bd = R.d.data();
+        const float* __restrict blx = R.lox.data(); const float* __restrict bly = R.loy.data(); const float* __restrict blz = R.loz.data();
+        const float* __restrict bhx = R.hix.data(); const float* __restrict bhy = R.hiy.data(); const float* __restrict bhz = R.hiz.data();
+        const Vec3 o = R.origin;
+        const float slack = R.slack;
+        const float below = float(slack - tolerance), above = float(tolerance - slack);
+
+        size_t nTests = 0;
+        for (size_t a = 0; a < A.size(); ++a) {
+            const Box boxA = A.box(a);
+            if (!boxA.overlaps(clipA))
+                continue;
+            const float alx = float(boxA.lo[0] - o.x) - slack, aly = float(boxA.lo[1] - o.y) - slack, alz = float(boxA.lo[2] - o.z) - slack;
+            const float ahx = float(boxA.hi[0] - o.x) + slack, ahy = float(boxA.hi[1] - o.y) + slack, ahz = float(boxA.hi[2] - o.z) + slack;
+            const float a0x = float(A.ax[a] - o.x), a0y = float(A.ay[a] - o.y), a0z = float(A.az[a] - o.z);
+            const float a1x = float(A.bx[a] - o.x), a1y = float(A.by[a] - o.y), a1z = float(A.bz[a] - o.z);
+            const float a2x = float(A.cx[a] - o.x), a2y = float(A.cy[a] - o.y), a2z = float(A.cz[a] - o.z);
+            const float anx = float(A.nx[a]), any = float(A.ny[a]), anz = float(A.nz[a]);
+            const float ad = float(A.d[a] - dot(A.normal(a), o));
+
+            //rejections without branches: disjoint boxes, then a triangle on one side of the plane of the other
+            for (size_t t = 0; t < nB; ++t) {
+                const int32_t overlap = (alx <= bhx[t]) & (ahx >= blx[t])
+                                      & (aly <= bhy[t]) & (ahy >= bly[t])
+                                      & (alz <= bhz[t]) & (ahz >= blz[t]);
+                const float e0 = anx * bax[t] + any * bay[t] + anz * baz[t] - ad;
+                const float e1 = anx * bbx[t] + any * bby[t] + anz * bbz[t] - ad;
+                const float e2 = anx * bcx[t] + any * bcy[t] + anz * bcz[t] - ad;
+                const float f0 = bnx[t] * a0x + bny[t] * a0y + bnz[t] * a0z - bd[t];
+                const float f1 = bnx[t] * a1x + bny[t] * a1y + bnz[t] * a1z - bd[t];
+                const float f2 = bnx[t] * a2x + bny[t] * a2y + bnz[t] * a2z - bd[t];
+                const int32_t crossesA = (minOf(e0, minOf(e1, e2)) < below) & (maxOf(e0, maxOf(e1, e2)) > above);
+                const int32_t crossesB = (minOf(f0, minOf(f1, f2)) < below) & (maxOf(f0, maxOf(f1, f2)) > above);
+                mask[t] = overlap & crossesA & crossesB;
+            }
+
+            for (size_t t = 0; t < nB; ++t) {
+                if (!mask[t])
+                    continue;
+                nTests++;
+                if (trianglesCross(A, a, B, t, tolerance)) {
+                    crossingA.add(boxA);
+                    crossingB.add(B.box(t));
+                }
+            }
+        }
+        return nTests;
+    }
+
+    /**
+     * Minimum distance between the triangles of A and B, if below limit
+     * @param R: rejection copy of B
+     * @return limit if the triangles are farther apart
+     */
+    double minDistance(const Triangles& A, const Box& clipA, const Triangles& B, const RejectionTriangles& R, double limit,
+                       NarrowScratch& scratch, Vec3& pointA, Vec3& pointB, size_t& nTests) {
+        const size_t nB = B.size();
+        scratch.mask.resize(nB);
+        scratch.gap.resize(nB);
+        int32_t* __restrict mask = scratch.mask.data();
+        float* __restrict gap = scratch.gap.data();
+        const float* __restrict blx = R.lox.data(); const float* __restrict bly = R.loy.data(); const float* __restrict blz = R.loz.data();
+        const float* __restrict bhx = R.hix.data(); const float* __restrict bhy = R.hiy.data(); const float* __restrict bhz = R.hiz.data();
+        const Vec3 o = R.origin;
+        const float slack = R.slack;
+
+        double best = limit;
+        for (size_t a = 0; a < A.size() && best > 0.0; ++a) {
+            const Box boxA = A.box(a);
+            if (!boxA.overlaps(clipA))
+                continue;
+            const float alx = float(boxA.lo[0] - o.x) - slack, aly = float(boxA.lo[1] - o.y) - slack, alz = float(boxA.lo[2] - o.z) - slack;
+            const float ahx = float(boxA.hi[0] - o.x) + slack, ahy = float(boxA.hi[1] - o.y) + slack, ahz = float(boxA.hi[2] - o.z) + slack;
+
+            //the distance between the boxes bounds the distance between the triangles, the widened box keeps it below;
+            //on each axis at most one side of the boxes is apart
+            const float bound = float(best * best);
+            for (size_t t = 0; t < nB; ++t) {
+                const float gx = positivePart(blx[t] - ahx) + positivePart(alx - bhx[t]);
+                const float gy = positivePart(bly[t] - ahy) + positivePart(aly - bhy[t]);
+                const float gz = positivePart(blz[t] - ahz) + positivePart(alz - bhz[t]);
+                gap[t] = gx * gx + gy * gy + gz * gz;
+                mask[t] = gap[t] < bound;
+            }
+
+            Vec3 pa, pb;
+            for (size_t t = 0; t < nB; ++t) {
+                if (!mask[t] || gap[t] >= best * best)
+                    continue;
+                nTests++;
+                const double distance = triangleDistance(A, a, B, t, pa, pb);
+                if (distance < best) {
+                    best = distance;
+                    pointA = pa;
+                    pointB = pb;
+                }
+            }
+        }
+        return best;
+    }
+
+    // Even-odd test of a point against a closed mesh, along a direction unlikely to graze edges
+    bool isInside(const Triangles& solid, const Vec3& point) {
+        const Vec3 dir{0.0137, 0.0071, 0.99988};
+        size_t nHits = 0;
+        for (size_t t = 0; t < solid.size(); ++t) {
+            if (solid.hiz[t] < point.z)
+                continue;
+            //Moller-Trumbore
+            const Vec3 a = solid.a(t);
+            const Vec3 e1 = solid.b(t) - a, e2 = solid.c(t) - a;
+            const Vec3 p = cross(dir, e2);
+            const double det = dot(e1, p);
+            if (std::abs(det) < 1e-18)
+                continue;
+            const double inv = 1.0 / det;
+            const Vec3 s = point - a;
+            const double u = dot(s, p) * inv;
+            if (u < 0.0 || u > 1.0)
+                continue;
+            const Vec3 q = cross(s, e1);
+            const double v = dot(dir, q) * inv;
+            if (v < 0.0 || u + v > 1.0)
+                continue;
+            if (dot(e2, q) * inv > 0.0)
+                nHits++;
+        }
+        return nHits % 2 == 1;
+    }
+
+    /**
+     * Whether the inner element lies inside the outer one, tested on points just inside the inner element
+     * behind its largest faces, so that faces shared by both elements do not make the test ambiguous
+     */
+    bool isContained(const Triangles& inner, const Box& innerBox, const Triangles& outer, double tolerance) {
+        const size_t n = inner.size();
+        if (!n || !outer.size())
+            return false;
+
+        //winding of the inner mesh, from the sign of its volume
+        const Vec3 center = innerBox.center();
+        double volume = 0.0;
+        std::vector<std::pair<double, size_t>> areas(n);
+        for (size_t t = 0; t < n; ++t) {
+            const Vec3 a = inner.a(t) - center, b = inner.b(t) - center, c = inner.c(t) - center;
+            volume += dot(a, cross(b, c));
+            const Vec3 normal = cross(b - a, c - a);
+            areas[t] = {dot(normal, normal), t};
+        }
+        const double orientation = volume < 0.0 ? -1.0 : 1.0;
+
+        const size_t nSamples = std::min(ContainmentSamples, n);
+        std::partial_sort(areas.begin(), areas.begin() + nSamples, areas.end(), std::greater<>());
+        const Vec3 diagonal{innerBox.extent(0), innerBox.extent(1), innerBox.extent(2)};
+        const double inset = std::min(std::max(10.0 * tolerance, 1e-6 * std::sqrt(dot(diagonal, diagonal))), 0.25 * innerBox.minExtent());
+
+        for (size_t k = 0; k < nSamples; ++k) {
+            const size_t t = areas[k].second;
+            const Vec3 centroid = (inner.a(t) + inner.b(t) + inner.c(t)) * (1.0 / 3.0);
+            if (!isInside(outer, centroid - inner.normal(t) * (orientation * inset)))
+                return false;
+        }
+        return true;
+    }
+
+    bool clashOrder(const IfcClashDetector::Clash& a, const IfcClashDetector::Clash& b) {
+        if (a.type != b.type)
+            return a.type == IfcClashDetector::Type::Hard;
+        if (a.penetration != b.penetration)
+            return a.penetration > b.penetration;
+        if (a.distance != b.distance)
+            return a.distance < b.distance;
+        return std::tie(a.guidA, a.guidB) < std::tie(b.guidA, b.guidB);
+    }
+
+    double elapsedMs(std::chrono::steady_clock::time_point& start) {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - start).count();
+        start = now;
+        return ms;
+    }
+}
+
+std::string IfcClashDetector::Stats::toString() const
+{
+    char text[256];
+    std::snprintf(text, sizeof(text),
+                  "%zu elements, %zu candidate pairs, %zu triangle tests, %zu clashes: build %.0f ms, broad phase %.0f ms, narrow phase %.0f ms",
+                  nElements, nCandidatePairs, nTriangleTests, nClashes, buildMs, broadMs, narrowMs);
+    return text;
+}
+
+IfcClashDetector::IfcClashDetector() = default;
+
+IfcClashDetector::IfcClashDetector(const Options& options)
+    : m_options(options)
+{
+}
+
+std::vector<IfcClashDetector::Clash> IfcClashDetector::detect(const std::vector<SceneData::Object>& objects)
+{
+    std::vector<const SceneData::Object*> pObjects;
+    pObjects.reserve(objects.size());
+    for (const auto& object : objects)
+        pObjects.push_back(&object);
+    return run(pObjects, std::vector<uint8_t>(pObjects.size(), 0), false);
+}
+
+std::vector<IfcClashDetector::Clash> IfcClashDetector::detect(const std::vector<SceneData::Object>& objectsA,
+                                                              const std::vector<SceneData::Object>& objectsB)
+{
+    std::vector<const SceneData::Object*> pObjects;
+    std::vector<uint8_t> sets;
+    pObjects.reserve(objectsA.size() + objectsB.size());
+    sets.reserve(objectsA.size() + objectsB.size());
+    for (const auto& object : objectsA) {
+        pObjects.push_back(&object);
+        sets.push_back(0);
+    }
+    for (const auto& object : objectsB) {
+        pObjects.push_back(&object);
+        sets.push_back(1);
+    }
+    return run(pObjects, sets, true);
+}
+
+std::vector<IfcClashDetector::Clash> IfcClashDetector::run(const std::vector<const SceneData::Object*>& objects,
+                                                           const std::vector<uint8_t>& sets, bool crossSetsOnly)
+{
+    m_stats = Stats();
+    auto& scheduler = TaskScheduler::instance();
+    auto isCancelled = [this]() { return m_options.isCancelled && m_options.isCancelled(); };
+    auto start = std::chrono::steady_clock::now();
+
+    //local bounds of the distinct mesh lists: instanced geometry is read once
+    std::vector<const SceneData::Object*> candidates;
+    std::vector<uint8_t> candidateSets;
+    std::vector<uint32_t> meshListOfCandidate;
+    std::vector<const std::vector<SceneData::Mesh>*> meshLists;
+    std::unordered_map<const std::vector<SceneData::Mesh>*, uint32_t> meshListIndices;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        const SceneData::Object* pObject = objects[i];
+        if (!pObject->meshes || pObject->meshes->empty() || m_options.ignoredClasses.count(pObject->type))
+            continue;
+        auto [itList, inserted] = meshListIndices.emplace(pObject->meshes.get(), static_cast<uint32_t>(meshLists.size()));
+        if (inserted)
+            meshLists.push_back(pObject->meshes.get());
+        candidates.push_back(pObject);
+        candidateSets.push_back(sets[i]);
+        meshListOfCandidate.push_back(itList->second);
+    }
+
+    std::vector<Box> localBoxes(meshLists.size());
+    scheduler.parallelFor(0, meshLists.size(), 64, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+            localBoxes[i] = localBounds(*meshLists[i]);
+    });
+
+    std::vector<Box> candidateBoxes(candidates.size());
+    scheduler.parallelFor(0, candidates.size(), BroadGrain, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+            candidateBoxes[i] = worldBounds(localBoxes[meshListOfCandidate[i]], candidates[i]->transform.m);
+    });
+
+    std::vector<const SceneData::Object*> elements;
+    std::vector<uint8_t> elementSets;
+    std::vector<Box> boxes;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (candidateBoxes[i].isEmpty())
+            continue;
+        elements.push_back(candidates[i]);
+        elementSets.push_back(candidateSets[i]);
+        boxes.push_back(candidateBoxes[i]);
+    }
+    m_stats.nElements = elements.size();
+
+    Bvh bvh;
+    bvh.build(boxes);
+    m_stats.buildMs = elapsedMs(start);
+    if (isCancelled())
+        return {};
+
+    //broad phase: each pair is kept by its lower index, elements are queried in hierarchy order for locality;
+    //without clearance the query box is shrunk by the tolerance, boxes which only touch cannot hold a hard clash
+    const double tolerance = m_options.tolerance;
+    const double queryMargin = m_options.clearance > 0.0 ? m_options.clearance : -tolerance;
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    std::mutex mutex;
+    scheduler.parallelFor(0, elements.size(), BroadGrain, [&](size_t first, size_t last) {
+        if (isCancelled())
+            return;
+        std::vector<std::pair<uint32_t, uint32_t>> localPairs;
+        for (size_t k = first; k < last; ++k) {
+            const uint32_t i = bvh.order()[k];
+            bvh.query(boxes[i].expanded(queryMargin), [&](uint32_t j) {
+                if (j <= i || (crossSetsOnly && elementSets[i] == elementSets[j]) || elements[i]->guid == elements[j]->guid)
+                    return;
+                localPairs.emplace_back(i, j);
+            });
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        pairs.insert(pairs.end(), localPairs.begin(), localPairs.end());
+    });
+    m_stats.nCandidatePairs = pairs.size();
+    m_stats.broadMs = elapsedMs(start);
+    if (isCancelled())
+        return {};
+
+    //narrow phase: the pairs of an element follow each other, its triangles are collected once for all of them
+    std::vector<Clash> clashes;
+    std::atomic<size_t> nTriangleTests{0};
+    const double clipMargin = std::max(m_options.clearance, 0.0) + tolerance;
+    scheduler.parallelFor(0, pairs.size(), NarrowGrain, [&](size_t first, size_t last) {
+        if (isCancelled())
+            return;
+        thread_local NarrowScratch scratch;
+        std::vector<Clash> localClashes;
+        size_t nTests = 0;
+        uint32_t cached = UINT32_MAX;
+        Box everything;
+        everything.lo[0] = everything.lo[1] = everything.lo[2] = -Infinity;
+        everything.hi[0] = everything.hi[1] = everything.hi[2] = Infinity;
+
+        for (size_t p = first; p < last; ++p) {
+            const auto [i, j] = pairs[p];
+            if (i != cached) {
+                collectTriangles(*elements[i], everything, scratch.trianglesA);
+                cached = i;
+            }
+            const Triangles& A = scratch.trianglesA;
+            Triangles& B = scratch.trianglesB;
+            collectTriangles(*elements[j], boxes[i].expanded(clipMargin), B);
+            const Box clipA = boxes[j].expanded(clipMargin);
+            const Vec3 origin = boxes[i].center();
+            scratch.rejectionB.assign(B, origin, 0.5 * std::max({boxes[i].extent(0), boxes[i].extent(1), boxes[i].extent(2)}));
+
+            Clash clash;
+            clash.guidA = elements[i]->guid;
+            clash.guidB = elements[j]->guid;
+
+            //interpenetration: any crossing is a hard clash, touching faces were rejected by the tests.
+            //the crossing faces of one side can be flat, eg. the face of a wall crossed by a pipe, the depth is taken
+            //over the crossing faces of both sides within the overlap of the elements
+            Box crossingA, crossingB;
+            nTests += findCrossings(A, boxes[j].expanded(tolerance), B, scratch.rejectionB, tolerance, scratch, crossingA, crossingB);
+            if (!crossingA.isEmpty()) {
+                Box region = crossingA;
+                region.add(crossingB);
+                region = region.intersection(boxes[i].intersection(boxes[j]));
+                const Vec3 center = region.center();
+                clash.penetration = region.isEmpty() ? 0.0 : region.minExtent();
+                clash.position = {center.x, center.y, center.z};
+                localClashes.push_back(std::move(clash));
+                continue;
+            }
+
+            //one inside the other: B was clipped to the box of A, it is complete only if it lies in that box
+            bool contained = false;
+            Box inner;
+            if (boxes[j].contains(boxes[i].expanded(-tolerance))) {
+                collectTriangles(*elements[j], everything, scratch.outer);
+                contained = isContained(A, boxes[i], scratch.outer, tolerance);
+                inner = boxes[i];
+            }
+            else if (boxes[i].contains(boxes[j].expanded(-tolerance))) {
+                contained = isContained(B, boxes[j], A, tolerance);
+                inner = boxes[j];
+            }
+            if (contained) {
+                const Vec3 center = inner.center();
+                clash.penetration = inner.minExtent();
+                clash.position = {center.x, center.y, center.z};
+                localClashes.push_back(std::move(clash));
+                continue;
+            }
+
+            if (m_options.clearance <= 0.0)
+                continue;
+            Vec3 pointA{}, pointB{};
+            const double distance = minDistance(A, clipA, B, scratch.rejectionB, m_options.clearance, scratch, pointA, pointB, nTests);
+            if (distance < m_options.clearance) {
+                const Vec3 center = (pointA + pointB) * 0.5;
+                clash.type = Type::Clearance;
+                clash.distance = distance;
+                clash.position = {center.x, center.y, center.z};
+                localClashes.push_back(std::move(clash));
+            }
+        }
+
+        nTriangleTests += nTests;
+        std::lock_guard<std::mutex> lock(mutex);
+        clashes.insert(clashes.end(), std::make_move_iterator(localClashes.begin()), std::make_move_iterator(localClashes.end()));
+    });
+    if (isCancelled())
+        return {};
+
+    std::sort(clashes.begin(), clashes.end(), clashOrder);
+    m_stats.nTriangleTests = nTriangleTests;
+    m_stats.nClashes = clashes.size();
+    m_stats.narrowMs = elapsedMs(start);
+    return clashes;
+}
+
+std::string IfcClashDetector::toCsv(const std::vector<Clash>& clashes)
+{
+    std::string csv("GuidA,GuidB,Type,Penetration,Distance,X,Y,Z\n");
+    char numbers[160];
+    for (const auto& clash : clashes) {
+        std::snprintf(numbers, sizeof(numbers), ",%.4f,%.4f,%.4f,%.4f,%.4f\n",
+                      clash.penetration, clash.distance, clash.position[0], clash.position[1], clash.position[2]);
+        csv += clash.guidA + "," + clash.guidB + (clash.type == Type::Hard ? ",Hard" : ",Clearance") + numbers;
+    }
+    return csv;
+}
+
+bool IfcClashDetector::writeCsv(const std::string& path, const std::vector<Clash>& clashes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+    file << toCsv(clashes);
+    return bool(file);
+}
@@ -0,0 +1,82 @@
+#ifndef IFCCLASHDETECTOR_H
+#define IFCCLASHDETECTOR_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "SceneData.h"
+
+/*
+ * Clash detection between the elements of a tessellated scene, in world coordinates.
+ * Broad phase: a bounding volume hierarchy over the world boxes of the elements, queried by every element in parallel.
+ * Narrow phase: the candidate pairs are split over the workers; the triangles of each pair, clipped to the box of the
+ * other element, are first rejected in branch free loops over single precision structure of arrays (box overlap and
+ * plane sides, with bounds widened by the rounding error), the few remaining triangle pairs get the exact tests in double.
+ * A hard clash is a pair of elements which interpenetrate, or one lying inside the other; faces which only touch,
+ * eg. a wall standing on a slab, are not clashes. A clearance clash is a pair closer than the clearance without a hard clash.
+ */
+class IfcClashDetector
+{
+public:
+    enum class Type { Hard, Clearance };
+
+    struct Options {
+        double clearance = 0.0;     // clearance distance in model units, 0 for hard clashes only
+        double tolerance = 1e-4;    // penetrations below it are touching contacts
+        std::unordered_set<std::string> ignoredClasses{"IfcOpeningElement", "IfcSpace"};
+        std::function<bool()> isCancelled; // polled between work chunks, an empty result is returned when cancelled
+    };
+
+    struct Clash {
+        std::string guidA;
+        std::string guidB;
+        Type type = Type::Hard;
+        double penetration = 0.0;           // hard: estimated depth, the smallest extent of the crossing faces within the overlap of the element boxes
+        double distance = 0.0;              // clearance: minimum distance between the elements
+        std::array<double, 3> position{};   // center of the clash, eg. to zoom on it
+    };
+
+    struct Stats {
+        size_t nElements = 0;
+        size_t nCandidatePairs = 0;         // pairs of overlapping boxes
+        size_t nTriangleTests = 0;          // exact triangle tests, after the block rejections
+        size_t nClashes = 0;
+        double buildMs = 0.0;
+        double broadMs = 0.0;
+        double narrowMs = 0.0;
+
+        std::string toString() const;
+    };
+
+    IfcClashDetector();
+    explicit IfcClashDetector(const Options& options);
+
+    // Clashes between any two elements of the scene
+    std::vector<Clash> detect(const std::vector<SceneData::Object>& objects);
+
+    // Clashes between an element of objectsA and one of objectsB only, eg. structure against ducts
+    std::vector<Clash> detect(const std::vector<SceneData::Object>& objectsA, const std::vector<SceneData::Object>& objectsB);
+
+    // Figures of the last detection
+    const Stats& stats() const { return m_stats; }
+
+    // One line per clash: GuidA,GuidB,Type,Penetration,Distance,X,Y,Z
+    static std::string toCsv(const std::vector<Clash>& clashes);
+    static bool writeCsv(const std::string& path, const std::vector<Clash>& clashes);
+
+private:
+    Options m_options;
+    Stats m_stats;
+
+    /**
+     * @param objects: elements to test
+     * @param sets: set of each element, with crossSetsOnly pairs are only tested between different sets
+     */
+    std::vector<Clash> run(const std::vector<const SceneData::Object*>& objects, const std::vector<uint8_t>& sets, bool crossSetsOnly);
+};
+
+#endif // IFCCLASHDETECTOR_H
@@ -0,0 +1,326 @@
+#include "IfcPlanSlicer.h"
+#include "MeshView.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+namespace {
+    // Elements copied, and sliced, by one task at least
+    constexpr size_t CopyGrain = 64;
+    constexpr size_t SliceGrain = 32;
+
+    // Sine of the angle below which consecutive segments are merged
+    constexpr double CollinearSine = 1e-9;
+
+    struct Segment {
+        double x0, y0, x1, y1;
+    };
+
+    // Start point of a segment, sorted to find the segment following another one
+    struct Start {
+        double x, y;
+        uint32_t segment;
+
+        bool operator<(const Start& other) const { return x < other.x || (x == other.x && y < other.y); }
+    };
+
+    struct SliceScratch {
+        std::vector<uint8_t> mask;
+        std::vector<Segment> segments;
+        std::vector<Start> starts;
+        std::vector<uint8_t> used;
+    };
+
+    // Column-major matrix, see SceneData::Matrix4x4
+    void transformPoint(const float* m, double x, double y, double z, double* out) {
+        out[0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+        out[1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+        out[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+    }
+
+    template<typename Visit>
+    void forEachPosition(const SceneData::Mesh& mesh, size_t count, Visit&& visit) {
+        if (!mesh.packedVertices.empty())
+            for (size_t i = 0; i < count; ++i)
+                visit(mesh.packedVertices[i].x, mesh.packedVertices[i].y, mesh.packedVertices[i].z);
+        else
+            for (size_t i = 0; i < count; ++i)
+                visit(mesh.vertices[i].x, mesh.vertices[i].y, mesh.vertices[i].z);
+    }
+
+    // Vertices of the whole triangles of the mesh
+    size_t triangleVertexCount(const SceneData::Mesh& mesh) {
+        const size_t count = mesh.packedVertices.empty() ? mesh.vertices.size() : mesh.packedVertices.size();
+        return count - count % 3;
+    }
+
+    // Remove the points lying on the line of their neighbours, triangulated faces cut into many collinear segments
+    void mergeCollinear(std::vector<IfcPlanSlicer::Point>& points, bool closed) {
+        const size_t n = points.size();
+        if (n < 3)
+            return;
+        size_t nKept = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (!closed && (i == 0 || i == n - 1)) {
+                points[nKept++] = points[i];
+                continue;
+            }
+            const auto previous = nKept ? points[nKept - 1] : points[n - 1];
+            const auto& next = points[(i + 1) % n];
+            const double ux = points[i][0] - previous[0], uy = points[i][1] - previous[1];
+            const double vx = next[0] - points[i][0], vy = next[1] - points[i][1];
+            const double lengths = std::sqrt((ux * ux + uy * uy) * (vx * vx + vy * vy));
+            if (lengths == 0.0)
+                continue;
+            //corners and spikes turning back are kept
+            if (std::abs(ux * vy - uy * vx) > CollinearSine * lengths || ux * vx + uy * vy < 0.0)
+                points[nKept++] = points[i];
+        }
+        points.resize(nKept);
+    }
+
+    double signedArea(const std::vector<IfcPlanSlicer::Point>& points) {
+        double twice = 0.0;
+        for (size_t i = 0, n = points.size(); i < n; ++i) {
+            const auto& p = points[i];
+            const auto& q = points[(i + 1) % n];
+            twice += p[0] * q[1] - q[0] * p[1];
+        }
+        return 0.5 * twice;
+    }
+}
+
+void IfcPlanSlicer::setObjects(const std::vector<SceneData::Object>& objects)
+{
+    m_elements.clear();
+    std::vector<const SceneData::Object*> pObjects;
+    size_t nTriangles = 0;
+    for (const auto& object : objects) {
+        if (!object.meshes)
+            continue;
+        size_t n = 0;
+        for (const auto& mesh : *object.meshes)
+            n += mesh.vertexCount() / 3;
+        if (!n)
+            continue;
+        Element element;
+        element.guid = object.guid;
+        element.ifcClass = object.type;
+        element.firstTriangle = nTriangles;
+        element.nTriangles = n;
+        nTriangles += n;
+        m_elements.push_back(std::move(element));
+        pObjects.push_back(&object);
+    }
+
+    //world bounds first: the vertices are stored in floats relative to the center, far from the origin they would lose precision
+    auto& scheduler = TaskScheduler::instance();
+    constexpr double Infinity = std::numeric_limits<double>::infinity();
+    std::vector<std::array<double, 6>> bounds(m_elements.size(), {Infinity, Infinity, Infinity, -Infinity, -Infinity, -Infinity});
+    scheduler.parallelFor(0, m_elements.size(), CopyGrain, [&](size_t first, size_t last) {
+        double p[3];
+        for (size_t e = first; e < last; ++e) {
+            auto& box = bounds[e];
+            const float* m = pObjects[e]->transform.m;
+            for (const auto& mesh : *pObjects[e]->meshes) {
+                MeshView view(mesh);
+                forEachPosition(view.mesh(), triangleVertexCount(view.mesh()), [&](double x, double y, double z) {
+                    transformPoint(m, x, y, z, p);
+                    for (int axis = 0; axis < 3; ++axis) {
+                        box[axis] = std::min(box[axis], p[axis]);
+                        box[axis + 3] = std::max(box[axis + 3], p[axis]);
+                    }
+                });
+            }
+        }
+    });
+
+    std::array<double, 6> total{Infinity, Infinity, Infinity, -Infinity, -Infinity, -Infinity};
+    for (const auto& box : bounds)
+        for (int axis = 0; axis < 3; ++axis) {
+            total[axis] = std::min(total[axis], box[axis]);
+            total[axis + 3] = std::max(total[axis + 3], box[axis + 3]);
+        }
+    if (m_elements.empty())
+        total.fill(0.0);
+    for (int axis = 0; axis < 3; ++axis)
+        m_origin[axis] = 0.5 * (total[axis] + total[axis + 3]);
+    m_minZ = total[2];
+    m_maxZ = total[5];
+
+    m_x.assign(3 * nTriangles, 0.0f);
+    m_y.assign(3 * nTriangles, 0.0f);
+    m_z.assign(3 * nTriangles, 0.0f);
+    scheduler.parallelFor(0, m_elements.size(), CopyGrain, [&](size_t first, size_t last) {
+        double p[3];
+        for (size_t e = first; e < last; ++e) {
+            Element& element = m_elements[e];
+            const float* m = pObjects[e]->transform.m;
+            size_t v = 3 * element.firstTriangle;
+            const size_t end = v + 3 * element.nTriangles;
+            for (const auto& mesh : *pObjects[e]->meshes) {
+                MeshView view(mesh);
+                forEachPosition(view.mesh(), triangleVertexCount(view.mesh()), [&](double x, double y, double z) {
+                    if (v == end)
+                        return;
+                    transformPoint(m, x, y, z, p);
+                    m_x[v] = static_cast<float>(p[0] - m_origin[0]);
+                    m_y[v] = static_cast<float>(p[1] - m_origin[1]);
+                    m_z[v] = static_cast<float>(p[2] - m_origin[2]);
+                    v++;
+                });
+            }
+
+            //range of the stored floats, so that the skipped elements cannot have been cut
+            element.nTriangles = (v - 3 * element.firstTriangle) / 3;
+            element.minZ = std::numeric_limits<float>::infinity();
+            element.maxZ = -std::numeric_limits<float>::infinity();
+            for (size_t i = 3 * element.firstTriangle; i < v; ++i) {
+                element.minZ = std::min(element.minZ, m_z[i]);
+                element.maxZ = std::max(element.maxZ, m_z[i]);
+            }
+        }
+    });
+}
+
+std::vector<IfcPlanSlicer::Section> IfcPlanSlicer::slice(double z) const
+{
+    const float zLocal = static_cast<float>(z - m_origin[2]);
+    std::vector<Section> sections(m_elements.size());
+    TaskScheduler::instance().parallelFor(0, m_elements.size(), SliceGrain, [&](size_t first, size_t last) {
+        for (size_t e = first; e < last; ++e)
+            if (m_elements[e].minZ < zLocal && zLocal <= m_elements[e].maxZ)
+                sections[e] = sliceElement(m_elements[e], zLocal);
+    });
+
+    std::vector<Section> cut;
+    for (auto& section : sections)
+        if (!section.polylines.empty())
+            cut.push_back(std::move(section));
+    return cut;
+}
+
+IfcPlanSlicer::Section IfcPlanSlicer::sliceElement(const Element& element, float z) const
+{
+    Section section;
+    section.guid = element.guid;
+    section.ifcClass = element.ifcClass;
+
+    thread_local SliceScratch scratch;
+    const size_t n = element.nTriangles;
+    const float* __restrict xs = m_x.data() + 3 * element.firstTriangle;
+    const float* __restrict ys = m_y.data() + 3 * element.firstTriangle;
+    const float* __restrict zs = m_z.data() + 3 * element.firstTriangle;
+
+    //triangles with vertices on both sides; vertices on the plane count as above, so that shared edges are cut once
+    scratch.mask.resize(n);
+    uint8_t* __restrict mask = scratch.mask.data();
+    for (size_t t = 0; t < n; ++t) {
+        const int above = int(zs[3 * t] >= z) + int(zs[3 * t + 1] >= z) + int(zs[3 * t + 2] >= z);
+        mask[t] = (above == 1) | (above == 2);
+    }
+
+    //the crossing of an edge is computed from its ordered end points, it is then the same for both triangles of the edge
+    auto crossing = [&](size_t i, size_t j, double& x, double& y) {
+        if (std::tie(xs[j], ys[j], zs[j]) < std::tie(xs[i], ys[i], zs[i]))
+            std::swap(i, j);
+        const double t = (double(z) - zs[i]) / (double(zs[j]) - zs[i]);
+        x = xs[i] + t * (double(xs[j]) - xs[i]);
+        y = ys[i] + t * (double(ys[j]) - ys[i]);
+    };
+
+    auto& segments = scratch.segments;
+    segments.clear();
+    for (size_t t = 0; t < n; ++t) {
+        if (!mask[t])
+            continue;
+        const size_t v = 3 * t;
+        double points[4];
+        int nPoints = 0;
+        for (int k = 0; k < 3 && nPoints < 4; ++k) {
+            const size_t i = v + k, j = v + (k + 1) % 3;
+            if ((zs[i] >= z) != (zs[j] >= z)) {
+                crossing(i, j, points[nPoints], points[nPoints + 1]);
+                nPoints += 2;
+            }
+        }
+
+        //oriented along up x normal: counterclockwise around the material seen from above
+        const double ux = double(xs[v + 1]) - xs[v], uy = double(ys[v + 1]) - ys[v], uz = double(zs[v + 1]) - zs[v];
+        const double wx = double(xs[v + 2]) - xs[v], wy = double(ys[v + 2]) - ys[v], wz = double(zs[v + 2]) - zs[v];
+        const double nx = uy * wz - uz * wy, ny = uz * wx - ux * wz;
+        Segment segment{points[0], points[1], points[2], points[3]};
+        if ((segment.x1 - segment.x0) * -ny + (segment.y1 - segment.y0) * nx < 0.0) {
+            std::swap(segment.x0, segment.x1);
+            std::swap(segment.y0, segment.y1);
+        }
+        if (segment.x0 != segment.x1 || segment.y0 != segment.y1)
+            segments.push_back(segment);
+    }
+    if (segments.empty())
+        return section;
+
+    //stitching: segments sorted by start point, each chain follows the segment starting where the previous one ends
+    auto& starts = scratch.starts;
+    starts.resize(segments.size());
+    for (uint32_t i = 0; i < segments.size(); ++i)
+        starts[i] = {segments[i].x0, segments[i].y0, i};
+    std::sort(starts.begin(), starts.end());
+    auto& used = scratch.used;
+    used.assign(segments.size(), 0);
+
+    auto nextFrom = [&](double x, double y) -> int {
+        const Start key{x, y, 0};
+        for (auto it = std::lower_bound(starts.begin(), starts.end(), key); it != starts.end() && it->x == x && it->y == y; ++it)
+            if (!used[it->segment])
+                return int(it->segment);
+        return -1;
+    };
+
+    double netArea = 0.0;
+    for (uint32_t s = 0; s < segments.size(); ++s) {
+        if (used[s])
+            continue;
+        used[s] = 1;
+        Polyline polyline;
+        polyline.points.reserve(segments.size() - s);
+        polyline.points.push_back({segments[s].x0, segments[s].y0});
+        double x = segments[s].x1, y = segments[s].y1;
+        while (true) {
+            if (x == segments[s].x0 && y == segments[s].y0) {
+                polyline.closed = true;
+                break;
+            }
+            polyline.points.push_back({x, y});
+            int next = nextFrom(x, y);
+            if (next < 0)
+                break;
+            used[next] = 1;
+            x = segments[next].x1;
+            y = segments[next].y1;
+        }
+
+        mergeCollinear(polyline.points, polyline.closed);
+        if (polyline.closed && polyline.points.size() < 3)
+            continue;
+        if (polyline.closed) {
+            polyline.area = signedArea(polyline.points);
+            netArea += polyline.area;
+        }
+        for (auto& point : polyline.points) {
+            point[0] += m_origin[0];
+            point[1] += m_origin[1];
+        }
+        section.polylines.push_back(std::move(polyline));
+    }
+
+    //meshes wound inwards give clockwise outer boundaries
+    if (netArea < 0.0)
+        for (auto& polyline : section.polylines)
+            polyline.area = -polyline.area;
+    section.area = std::abs(netArea);
+    return section;
+}
@@ -0,0 +1,74 @@
+#ifndef IFCPLANSLICER_H
+#define IFCPLANSLICER_H
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "SceneData.h"
+
+/*
+ * Horizontal sections of the elements of a storey, for floor plans and plan-based take-off.
+ * setObjects copies the world triangles of the elements once, relative to the center of the storey;
+ * every slice then only reads these arrays: the elements whose height range contains the cut are
+ * intersected in parallel and their segments stitched into polylines, so that the cut height can be
+ * changed interactively.
+ */
+class IfcPlanSlicer
+{
+public:
+    using Point = std::array<double, 2>;
+
+    struct Polyline {
+        std::vector<Point> points;  // world XY, the first point is not repeated at the end of closed polylines
+        bool closed = false;
+        double area = 0.0;          // signed, positive for outer boundaries and negative for holes; 0 if open
+    };
+
+    struct Section {
+        std::string guid;
+        std::string ifcClass;
+        std::vector<Polyline> polylines;
+        double area = 0.0;          // net cut area: outer boundaries minus holes
+    };
+
+    /**
+     * Copy the world triangles of the elements
+     * @param objects: elements of the storey, see IfcParser::createStoreyPlan
+     */
+    void setObjects(const std::vector<SceneData::Object>& objects);
+
+    size_t elementCount() const { return m_elements.size(); }
+
+    // Height range of the elements, eg. for the range of a cut height slider
+    double minZ() const { return m_minZ; }
+    double maxZ() const { return m_maxZ; }
+
+    /**
+     * Sections of the elements cut by the horizontal plane at z, in world coordinates
+     * @param z: cut plane, the storey elevation plus the cut height, see IfcParser::storeyElevation
+     * @return the cut elements, in the order of the objects
+     */
+    std::vector<Section> slice(double z) const;
+
+private:
+    struct Element {
+        std::string guid;
+        std::string ifcClass;
+        size_t firstTriangle = 0;
+        size_t nTriangles = 0;
+        float minZ = 0.0f;
+        float maxZ = 0.0f;
+    };
+
+    // Vertices of the triangles, 3 per triangle, relative to m_origin
+    std::vector<float> m_x, m_y, m_z;
+    std::vector<Element> m_elements;
+    std::array<double, 3> m_origin{};
+    double m_minZ = 0.0;
+    double m_maxZ = 0.0;
+
+    Section sliceElement(const Element& element, float z) const;
+};
+
+#endif // IFCPLANSLICER_H
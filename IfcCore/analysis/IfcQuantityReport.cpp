@@ -0,0 +1,280 @@
+#include "IfcQuantityReport.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace {
+    const std::string Unassigned("(unassigned)");
+
+    // Past this share of changed elements, a parallel reduction beats updating the totals element by element
+    constexpr size_t IncrementalDivisor = 8;
+
+    // Elements reduced by one task
+    constexpr size_t ReduceGrain = 16384;
+
+    // Index of a name, added if new
+    uint32_t intern(const std::string& text, std::vector<std::string>& names, std::unordered_map<std::string, uint32_t>& indices) {
+        auto [it, inserted] = indices.emplace(text, static_cast<uint32_t>(names.size()));
+        if (inserted)
+            names.push_back(text);
+        return it->second;
+    }
+
+    std::string csvField(const std::string& text) {
+        if (text.find_first_of(",\"\n") == std::string::npos)
+            return text;
+        std::string quoted("\"");
+        for (char c : text)
+            quoted += (c == '"') ? std::string("\"\"") : std::string(1, c);
+        return quoted + "\"";
+    }
+}
+
+const char* IfcQuantityReport::name(Quantity quantity)
+{
+    switch (quantity) {
+    case Volume: return "Volume";
+    case SurfaceArea: return "SurfaceArea";
+    case FootprintArea: return "FootprintArea";
+    default: return "";
+    }
+}
+
+void IfcQuantityReport::build(DataNode::Base* pRoot, const std::unordered_map<std::string, Values>& quantitiesByGuid,
+                              const std::unordered_map<std::string, std::string>& materialsByGuid)
+{
+    *this = IfcQuantityReport();
+    if (!pRoot)
+        return;
+
+    std::unordered_map<std::string, uint32_t> classIndices, materialIndices;
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, uint32_t> groupIndices;
+
+    //storey node -> class nodes -> object nodes, an element contained twice is counted in its first storey
+    //and listed under both, so that either storey hides it
+    std::function<void(DataNode::Base*)> collect = [&](DataNode::Base* pNode) {
+        auto pStoreyNode = pNode->as<DataNode::IfcObject>();
+        if (!pStoreyNode || pStoreyNode->m_ifcClass != "IfcBuildingStorey")
+        {
+            for (const auto& upChild : pNode->getChildren())
+                collect(upChild.get());
+            return;
+        }
+
+        auto storey = static_cast<uint32_t>(m_storeyGuids.size());
+        m_storeyGuids.push_back(pStoreyNode->m_guid);
+        m_storeyNames.push_back(pStoreyNode->m_name);
+        auto& storeyElements = m_elementsByStorey[pStoreyNode->m_guid];
+
+        for (const auto& upClassNode : pNode->getChildren())
+            for (const auto& upChild : upClassNode->getChildren())
+            {
+                auto pObject = upChild->as<DataNode::IfcObject>();
+                if (!pObject)
+                    continue;
+                auto itElement = m_elementByGuid.find(pObject->m_guid);
+                if (itElement != m_elementByGuid.end())
+                {
+                    if (std::find(storeyElements.begin(), storeyElements.end(), itElement->second) == storeyElements.end())
+                        storeyElements.push_back(itElement->second);
+                    continue;
+                }
+                auto itQuantities = quantitiesByGuid.find(pObject->m_guid);
+                if (itQuantities == quantitiesByGuid.end())
+                    continue;
+
+                auto itMaterial = materialsByGuid.find(pObject->m_guid);
+                const std::string& material = itMaterial != materialsByGuid.end() && !itMaterial->second.empty() ? itMaterial->second : Unassigned;
+                Group group{storey, intern(pObject->m_ifcClass, m_classNames, classIndices), intern(material, m_materialNames, materialIndices)};
+                auto [itGroup, inserted] = groupIndices.emplace(std::make_tuple(group.storey, group.ifcClass, group.material),
+                                                                static_cast<uint32_t>(m_groups.size()));
+                if (inserted)
+                    m_groups.push_back(group);
+
+                auto element = static_cast<uint32_t>(m_guids.size());
+                m_guids.push_back(pObject->m_guid);
+                m_groupOfElement.push_back(itGroup->second);
+                m_visible.push_back(1);
+                for (size_t q = 0; q < QuantityCount; ++q)
+                    m_values[q].push_back(itQuantities->second[q]);
+                m_elementByGuid.emplace(pObject->m_guid, element);
+                storeyElements.push_back(element);
+            }
+    };
+    collect(pRoot);
+
+    recompute();
+}
+
+std::vector<std::string> IfcQuantityReport::storeyGuids() const
+{
+    return m_storeyGuids;
+}
+
+void IfcQuantityReport::recompute()
+{
+    const size_t nGroups = m_groups.size();
+    m_totals.assign(nGroups, Values{});
+    m_visibleCounts.assign(nGroups, 0);
+
+    //each chunk reduces into its own totals, merged under the lock once per chunk
+    std::mutex mutex;
+    TaskScheduler::instance().parallelFor(0, m_guids.size(), ReduceGrain, [&](size_t first, size_t last) {
+        std::vector<Values> totals(nGroups, Values{});
+        std::vector<size_t> counts(nGroups, 0);
+        for (size_t q = 0; q < QuantityCount; ++q)
+        {
+            const double* values = m_values[q].data();
+            for (size_t i = first; i < last; ++i)
+                totals[m_groupOfElement[i]][q] += m_visible[i] ? values[i] : 0.0;
+        }
+        for (size_t i = first; i < last; ++i)
+            counts[m_groupOfElement[i]] += m_visible[i];
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t g = 0; g < nGroups; ++g)
+        {
+            for (size_t q = 0; q < QuantityCount; ++q)
+                m_totals[g][q] += totals[g][q];
+            m_visibleCounts[g] += counts[g];
+        }
+    });
+}
+
+void IfcQuantityReport::setElementVisible(uint32_t element, bool visible)
+{
+    if (bool(m_visible[element]) == visible)
+        return;
+    m_visible[element] = visible;
+
+    const uint32_t group = m_groupOfElement[element];
+    const double sign = visible ? 1.0 : -1.0;
+    for (size_t q = 0; q < QuantityCount; ++q)
+        m_totals[group][q] += sign * m_values[q][element];
+    if (visible)
+        m_visibleCounts[group]++;
+    else
+        m_visibleCounts[group]--;
+}
+
+void IfcQuantityReport::setVisible(const std::vector<std::string>& guids, bool visible)
+{
+    std::vector<uint32_t> elements;
+    for (const auto& guid : guids)
+    {
+        auto itElement = m_elementByGuid.find(guid);
+        if (itElement != m_elementByGuid.end())
+        {
+            elements.push_back(itElement->second);
+            continue;
+        }
+        auto itStorey = m_elementsByStorey.find(guid);
+        if (itStorey != m_elementsByStorey.end())
+            elements.insert(elements.end(), itStorey->second.begin(), itStorey->second.end());
+    }
+
+    //in place updates accumulate rounding errors, large changes are reduced again
+    if (elements.size() * IncrementalDivisor < m_guids.size())
+    {
+        for (uint32_t element : elements)
+            setElementVisible(element, visible);
+        return;
+    }
+
+    for (uint32_t element : elements)
+        m_visible[element] = visible;
+    recompute();
+}
+
+void IfcQuantityReport::setAllVisible(bool visible)
+{
+    std::fill(m_visible.begin(), m_visible.end(), visible ? 1 : 0);
+    recompute();
+}
+
+std::vector<IfcQuantityReport::Row> IfcQuantityReport::rows(int groupBy) const
+{
+    //groups are merged on the kept groupings, the dropped ones are set to the same index
+    constexpr uint32_t Dropped = UINT32_MAX;
+    std::map<std::tuple<uint32_t, std::string, std::string>, Row> merged;
+    for (size_t g = 0; g < m_groups.size(); ++g)
+    {
+        if (!m_visibleCounts[g])
+            continue;
+
+        const Group& group = m_groups[g];
+        uint32_t storey = (groupBy & ByStorey) ? group.storey : Dropped;
+        const std::string& ifcClass = (groupBy & ByClass) ? m_classNames[group.ifcClass] : std::string();
+        const std::string& material = (groupBy & ByMaterial) ? m_materialNames[group.material] : std::string();
+
+        Row& row = merged[std::make_tuple(storey, ifcClass, material)];
+        if (storey != Dropped)
+            row.storey = m_storeyNames[storey];
+        row.ifcClass = ifcClass;
+        row.material = material;
+        row.nElements += m_visibleCounts[g];
+        for (size_t q = 0; q < QuantityCount; ++q)
+            row.values[q] += m_totals[g][q];
+    }
+
+    std::vector<Row> result;
+    result.reserve(merged.size());
+    for (auto& pair : merged)
+        result.push_back(std::move(pair.second));
+    return result;
+}
+
+IfcQuantityReport::Row IfcQuantityReport::total() const
+{
+    auto totals = rows(0);
+    return totals.empty() ? Row() : totals.front();
+}
+
+std::string IfcQuantityReport::toCsv(int groupBy) const
+{
+    std::string csv;
+    if (groupBy & ByStorey)
+        csv += "Storey,";
+    if (groupBy & ByClass)
+        csv += "IfcClass,";
+    if (groupBy & ByMaterial)
+        csv += "Material,";
+    csv += "Count";
+    for (size_t q = 0; q < QuantityCount; ++q)
+        csv += std::string(",") + name(static_cast<Quantity>(q));
+    csv += "\n";
+
+    char number[32];
+    for (const auto& row : rows(groupBy))
+    {
+        if (groupBy & ByStorey)
+            csv += csvField(row.storey) + ",";
+        if (groupBy & ByClass)
+            csv += csvField(row.ifcClass) + ",";
+        if (groupBy & ByMaterial)
+            csv += csvField(row.material) + ",";
+        csv += std::to_string(row.nElements);
+        for (double value : row.values)
+        {
+            std::snprintf(number, sizeof(number), ",%.4f", value);
+            csv += number;
+        }
+        csv += "\n";
+    }
+    return csv;
+}
+
+bool IfcQuantityReport::writeCsv(const std::string& path, int groupBy) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+    file << toCsv(groupBy);
+    return bool(file);
+}
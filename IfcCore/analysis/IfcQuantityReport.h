@@ -0,0 +1,96 @@
+#ifndef IFCQUANTITYREPORT_H
+#define IFCQUANTITYREPORT_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DataNode.h"
+
+/*
+ * Quantity totals of the elements of a structure tree, grouped by storey, IFC class and material.
+ * Quantities are stored in columns, one entry per measured element. Totals are kept per
+ * (storey, class, material) group over the visible elements: showing or hiding a few elements
+ * updates them in place, larger changes are reduced again in parallel.
+ */
+class IfcQuantityReport
+{
+public:
+    enum Quantity { Volume, SurfaceArea, FootprintArea, QuantityCount };
+    using Values = std::array<double, QuantityCount>;
+
+    // Grouping of the rows, flags can be combined; 0 gives the grand total
+    enum GroupBy { ByStorey = 1, ByClass = 2, ByMaterial = 4, ByAll = ByStorey | ByClass | ByMaterial };
+
+    struct Row {
+        std::string storey;
+        std::string ifcClass;
+        std::string material;
+        size_t nElements = 0;
+        Values values{};
+    };
+
+    static const char* name(Quantity quantity);
+
+    /**
+     * Collect the elements of the storeys of the tree which have quantities, all visible
+     * @param pRoot: tree of IfcParser::createPreviewTree
+     * @param quantitiesByGuid: measured elements, see IfcElemProcessorQuantity and IfcElemProcessorOCC
+     * @param materialsByGuid: material name of the elements, elements without one are grouped as unassigned
+     */
+    void build(DataNode::Base* pRoot, const std::unordered_map<std::string, Values>& quantitiesByGuid,
+               const std::unordered_map<std::string, std::string>& materialsByGuid);
+
+    size_t elementCount() const { return m_guids.size(); }
+    std::vector<std::string> storeyGuids() const;
+
+    /**
+     * Show or hide elements, eg. from the preview tree checkboxes
+     * @param guids: element or storey GlobalIds, a storey stands for all the elements it contains, including the
+     *               ones counted in another storey; unknown ones are ignored
+     */
+    void setVisible(const std::vector<std::string>& guids, bool visible);
+    void setAllVisible(bool visible);
+
+    // Totals of the visible elements, sorted by storey in tree order, class and material
+    std::vector<Row> rows(int groupBy = ByAll) const;
+    Row total() const;
+
+    // One line per row, the columns of the dropped groupings are left out
+    std::string toCsv(int groupBy = ByAll) const;
+    bool writeCsv(const std::string& path, int groupBy = ByAll) const;
+
+private:
+    struct Group {
+        uint32_t storey;
+        uint32_t ifcClass;
+        uint32_t material;
+    };
+
+    // Columns, indexed by element
+    std::vector<std::string> m_guids;
+    std::vector<uint32_t> m_groupOfElement;
+    std::vector<uint8_t> m_visible;
+    std::array<std::vector<double>, QuantityCount> m_values;
+
+    std::unordered_map<std::string, uint32_t> m_elementByGuid;
+    std::unordered_map<std::string, std::vector<uint32_t>> m_elementsByStorey;
+
+    // Names, referenced by index from the groups; storeys in tree order
+    std::vector<std::string> m_storeyGuids;
+    std::vector<std::string> m_storeyNames;
+    std::vector<std::string> m_classNames;
+    std::vector<std::string> m_materialNames;
+
+    // Totals of the visible elements per group
+    std::vector<Group> m_groups;
+    std::vector<Values> m_totals;
+    std::vector<size_t> m_visibleCounts;
+
+    void recompute();
+    void setElementVisible(uint32_t element, bool visible);
+};
+
+#endif // IFCQUANTITYREPORT_H
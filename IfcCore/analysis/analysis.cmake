@@ -0,0 +1,12 @@
+set(
+    ANALYSIS_SOURCES
+    ${CMAKE_CURRENT_LIST_DIR}/analysis.cmake
+    ${CMAKE_CURRENT_LIST_DIR}/IfcQuantityReport.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcQuantityReport.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcClashDetector.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcClashDetector.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcPlanSlicer.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcPlanSlicer.cpp
+)
+
+source_group(analysis FILES ${ANALYSIS_SOURCES})
@@ -0,0 +1,440 @@
+#include "IfcSceneCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ifcparse/IfcLogger.h>
+
+#include "MeshView.h"
+#include "IfcMemory.h"
+
+namespace {
+    const std::string Prefix("[IfcSceneCache] ");
+    constexpr char Magic[8] = {'I', 'F', 'C', 'S', 'C', 'E', 'N', 'E'};
+    constexpr uint64_t NoMeshSet = std::numeric_limits<uint64_t>::max();
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t fileHash;
+        uint64_t settingsHash;
+        uint64_t objectsOffset;
+        uint64_t objectCount;
+        uint64_t treeOffset;
+        uint64_t fileSize;
+    };
+
+    inline uint64_t mix(uint64_t h, uint64_t word) {
+        h ^= word * 0x9E3779B97F4A7C15ull;
+        h = (h << 31) | (h >> 33);
+        return h * 0xBF58476D1CE4E5B9ull;
+    }
+
+    uint64_t hashBytes(const uint8_t* p, size_t n, uint64_t h) {
+        for (; n >= 8; p += 8, n -= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            h = mix(h, word);
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, p, n);
+        return mix(h, tail ^ (uint64_t(n) << 56));
+    }
+
+    //-------------------- writing -------------------------//
+
+    template<typename T>
+    void writeValue(std::ofstream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void writeString(std::ofstream& out, const std::string& text) {
+        writeValue(out, static_cast<uint32_t>(text.size()));
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    template<typename T>
+    void writeArray(std::ofstream& out, const std::vector<T>& data) {
+        writeValue(out, static_cast<uint64_t>(data.size()));
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(T)));
+    }
+
+    void writeTree(std::ofstream& out, DataNode::Base* pNode) {
+        writeValue(out, static_cast<uint8_t>(pNode->type()));
+        if (auto pObject = pNode->as<DataNode::IfcObject>()) {
+            writeString(out, pObject->m_guid);
+            writeString(out, pObject->m_name);
+            writeString(out, pObject->m_ifcClass);
+        }
+        else if (auto pClass = pNode->as<DataNode::IfcClass>()) {
+            writeString(out, pClass->m_ifcClass);
+            writeValue(out, static_cast<int32_t>(pClass->m_objectsCount));
+        }
+
+        const auto& children = pNode->getChildren();
+        writeValue(out, static_cast<uint32_t>(children.size()));
+        for (const auto& upChild : children)
+            writeTree(out, upChild.get());
+    }
+
+    //-------------------- reading -------------------------//
+
+    // Bounds checked reads from the mapping, a truncated or corrupted cache throws
+    class Cursor {
+    public:
+        Cursor(const uint8_t* pData, size_t size, uint64_t offset) : m_pData(pData), m_size(size), m_offset(offset) {}
+
+        const uint8_t* take(uint64_t n) {
+            if (m_offset > m_size || n > m_size - m_offset)
+                throw std::out_of_range("cache truncated");
+            const uint8_t* p = m_pData + m_offset;
+            m_offset += n;
+            return p;
+        }
+
+        template<typename T>
+        T value() {
+            T v;
+            std::memcpy(&v, take(sizeof(T)), sizeof(T));
+            return v;
+        }
+
+        std::string string() {
+            uint32_t n = value<uint32_t>();
+            return std::string(reinterpret_cast<const char*>(take(n)), n);
+        }
+
+        template<typename T>
+        void array(std::vector<T>& data) {
+            uint64_t n = value<uint64_t>();
+            if (n > m_size / sizeof(T))
+                throw std::out_of_range("cache corrupted");
+            const uint8_t* p = take(n * sizeof(T));
+            data.resize(static_cast<size_t>(n));
+            if (n)
+                std::memcpy(data.data(), p, static_cast<size_t>(n * sizeof(T)));
+        }
+
+    private:
+        const uint8_t* m_pData;
+        size_t m_size;
+        uint64_t m_offset;
+    };
+
+    std::unique_ptr<DataNode::Base> readTreeNode(Cursor& cursor) {
+        std::unique_ptr<DataNode::Base> upNode;
+        switch (static_cast<DataNode::Type>(cursor.value<uint8_t>())) {
+        case DataNode::Type::IfcObject: {
+            auto guid = cursor.string();
+            auto name = cursor.string();
+            auto ifcClass = cursor.string();
+            upNode = std::make_unique<DataNode::IfcObject>(guid, name, ifcClass);
+            break;
+        }
+        case DataNode::Type::IfcClass: {
+            auto ifcClass = cursor.string();
+            upNode = std::make_unique<DataNode::IfcClass>(ifcClass, cursor.value<int32_t>());
+            break;
+        }
+        default:
+            upNode = std::make_unique<DataNode::Base>();
+        }
+
+        uint32_t nChildren = cursor.value<uint32_t>();
+        for (uint32_t i = 0; i < nChildren; ++i)
+            upNode->addChild(readTreeNode(cursor));
+        return upNode;
+    }
+
+    std::shared_ptr<std::vector<SceneData::Mesh>> readMeshSet(Cursor cursor) {
+        std::vector<SceneData::Mesh> meshes(cursor.value<uint32_t>());
+        for (auto& mesh : meshes) {
+            mesh.color = cursor.value<SceneData::ColorRGBA>();
+            cursor.array(mesh.vertices);
+            cursor.array(mesh.normals);
+            cursor.array(mesh.packedVertices);
+        }
+        return IfcMemory::trackMeshes(std::move(meshes));
+    }
+}
+
+//-------------------- IfcSceneCache -------------------------//
+
+uint64_t IfcSceneCache::hashFile(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return 0;
+
+    std::vector<char> buffer(1 << 20);
+    uint64_t h = 0x243F6A8885A308D3ull;
+    while (in) {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        auto n = static_cast<size_t>(in.gcount());
+        if (n == 0)
+            break;
+        h = hashBytes(reinterpret_cast<const uint8_t*>(buffer.data()), n, h);
+    }
+    return h ? h : 1;
+}
+
+uint64_t IfcSceneCache::hashString(const std::string& text)
+{
+    return hashBytes(reinterpret_cast<const uint8_t*>(text.data()), text.size(), 0x13198A2E03707344ull);
+}
+
+//-------------------- IfcSceneCacheWriter -------------------------//
+
+std::unique_ptr<IfcSceneCacheWriter> IfcSceneCacheWriter::create(const std::string& ifcPath, uint64_t fileHash, uint64_t settingsHash)
+{
+    std::string finalPath = IfcSceneCache::cachePath(ifcPath);
+    std::unique_ptr<IfcSceneCacheWriter> upWriter(new IfcSceneCacheWriter(finalPath, finalPath + ".tmp", fileHash, settingsHash));
+    if (!upWriter->m_out) {
+        Logger::Notice(Prefix + "Cannot write " + upWriter->m_tempPath + ", model not cached");
+        return nullptr;
+    }
+    return upWriter;
+}
+
+IfcSceneCacheWriter::IfcSceneCacheWriter(const std::string& finalPath, const std::string& tempPath, uint64_t fileHash, uint64_t settingsHash)
+    : m_finalPath(finalPath)
+    , m_tempPath(tempPath)
+    , m_out(tempPath, std::ios::binary | std::ios::trunc)
+    , m_fileHash(fileHash)
+    , m_settingsHash(settingsHash)
+{
+    // Placeholder, the header is written on commit
+    FileHeader header{};
+    writeValue(m_out, header);
+}
+
+IfcSceneCacheWriter::~IfcSceneCacheWriter()
+{
+    if (m_committed)
+        return;
+    m_out.close();
+    std::error_code ec;
+    std::filesystem::remove(m_tempPath, ec);
+}
+
+uint64_t IfcSceneCacheWriter::writeMeshSet(const std::vector<SceneData::Mesh>& meshes)
+{
+    auto offset = static_cast<uint64_t>(m_out.tellp());
+    writeValue(m_out, static_cast<uint32_t>(meshes.size()));
+    for (const auto& storedMesh : meshes) {
+        MeshView view(storedMesh);
+        writeValue(m_out, view->color);
+        writeArray(m_out, view->vertices);
+        writeArray(m_out, view->normals);
+        writeArray(m_out, view->packedVertices);
+    }
+    return offset;
+}
+
+void IfcSceneCacheWriter::addObjects(const std::vector<SceneData::Object>& objects, bool refined)
+{
+    if (m_failed)
+        return;
+
+    auto& meshSetByGeometryId = m_meshSetByGeometryId[refined ? 1 : 0];
+    for (const auto& object : objects) {
+        uint64_t meshSetOffset = NoMeshSet;
+        if (object.meshes) {
+            auto it = object.geometryId.empty() ? meshSetByGeometryId.end() : meshSetByGeometryId.find(object.geometryId);
+            if (it != meshSetByGeometryId.end())
+                meshSetOffset = it->second;
+            else {
+                meshSetOffset = writeMeshSet(*object.meshes);
+                if (!object.geometryId.empty())
+                    meshSetByGeometryId.emplace(object.geometryId, meshSetOffset);
+            }
+        }
+
+        auto itObject = m_objectIndexByGuid.find(object.guid);
+        if (refined && itObject != m_objectIndexByGuid.end()) {
+            m_objects[itObject->second].meshSetOffset = meshSetOffset;
+            continue;
+        }
+
+        m_objectIndexByGuid.emplace(object.guid, m_objects.size());
+        m_objects.push_back({object.name, object.type, object.geometryId, object.guid, object.transform, meshSetOffset});
+    }
+
+    if (!m_out) {
+        Logger::Error(Prefix + "Failed to write " + m_tempPath);
+        m_failed = true;
+    }
+}
+
+bool IfcSceneCacheWriter::commit(DataNode::Base* pTree)
+{
+    if (m_failed || m_committed || !pTree)
+        return false;
+
+    FileHeader header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = IfcSceneCache::FormatVersion;
+    header.fileHash = m_fileHash;
+    header.settingsHash = m_settingsHash;
+
+    header.objectsOffset = static_cast<uint64_t>(m_out.tellp());
+    header.objectCount = m_objects.size();
+    for (const auto& record : m_objects) {
+        writeString(m_out, record.name);
+        writeString(m_out, record.type);
+        writeString(m_out, record.geometryId);
+        writeString(m_out, record.guid);
+        writeValue(m_out, record.transform.m);
+        writeValue(m_out, record.meshSetOffset);
+    }
+
+    header.treeOffset = static_cast<uint64_t>(m_out.tellp());
+    writeTree(m_out, pTree);
+
+    header.fileSize = static_cast<uint64_t>(m_out.tellp());
+    m_out.seekp(0);
+    writeValue(m_out, header);
+    m_out.close();
+    if (!m_out) {
+        Logger::Error(Prefix + "Failed to write " + m_tempPath);
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(m_tempPath, m_finalPath, ec);
+    if (ec) {
+        Logger::Error(Prefix + "Failed to replace " + m_finalPath + ": " + ec.message());
+        return false;
+    }
+
+    m_committed = true;
+    Logger::Notice(Prefix + "Cached " + std::to_string(m_objects.size()) + " objects in " + m_finalPath);
+    return true;
+}
+
+//-------------------- IfcSceneCacheReader -------------------------//
+
+std::unique_ptr<IfcSceneCacheReader> IfcSceneCacheReader::open(const std::string& ifcPath, uint64_t fileHash, uint64_t settingsHash)
+{
+    std::string path = IfcSceneCache::cachePath(ifcPath);
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file
+    if (p == MAP_FAILED)
+        return nullptr;
+
+    std::unique_ptr<IfcSceneCacheReader> upReader(new IfcSceneCacheReader(static_cast<const uint8_t*>(p), size));
+
+    FileHeader header;
+    std::memcpy(&header, p, sizeof(FileHeader));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+        || header.version != IfcSceneCache::FormatVersion
+        || header.fileHash != fileHash
+        || header.settingsHash != settingsHash
+        || header.fileSize != size)
+    {
+        Logger::Notice(Prefix + path + " is outdated, the model is loaded from the IFC file");
+        return nullptr;
+    }
+
+    upReader->m_objectsOffset = header.objectsOffset;
+    upReader->m_objectCount = header.objectCount;
+    upReader->m_treeOffset = header.treeOffset;
+    return upReader;
+}
+
+IfcSceneCacheReader::IfcSceneCacheReader(const uint8_t* pData, size_t size): m_pData(pData), m_size(size) {}
+
+IfcSceneCacheReader::~IfcSceneCacheReader()
+{
+    ::munmap(const_cast<uint8_t*>(m_pData), m_size);
+}
+
+std::unique_ptr<DataNode::Base> IfcSceneCacheReader::readTree() const
+{
+    try {
+        Cursor cursor(m_pData, m_size, m_treeOffset);
+        return readTreeNode(cursor);
+    }
+    catch (const std::exception& e) {
+        Logger::Error(Prefix + "Failed to read the structure tree: " + e.what());
+        return nullptr;
+    }
+}
+
+size_t IfcSceneCacheReader::readObjects(size_t batchCount, const std::unordered_set<std::string>* pGuids,
+                                        Callback_ObjectsReady onObjectsReady) const
+{
+    batchCount = std::max<size_t>(batchCount, 1);
+    size_t nDelivered = 0;
+    std::shared_ptr<std::vector<SceneData::Object>> spBatch;
+
+    // Instances share their meshes for as long as the consumer keeps them
+    std::unordered_map<uint64_t, std::weak_ptr<std::vector<SceneData::Mesh>>> meshSets;
+
+    try {
+        Cursor cursor(m_pData, m_size, m_objectsOffset);
+        for (uint64_t i = 0; i < m_objectCount; ++i) {
+            SceneData::Object object;
+            object.name = cursor.string();
+            object.type = cursor.string();
+            object.geometryId = cursor.string();
+            object.guid = cursor.string();
+            std::memcpy(object.transform.m, cursor.take(sizeof(object.transform.m)), sizeof(object.transform.m));
+            uint64_t meshSetOffset = cursor.value<uint64_t>();
+
+            if (pGuids && !pGuids->count(object.guid))
+                continue;
+
+            if (meshSetOffset != NoMeshSet) {
+                auto& wpMeshes = meshSets[meshSetOffset];
+                object.meshes = wpMeshes.lock();
+                if (object.meshes) {
+                    IfcMemory::markInstanced(object.meshes);
+                } else {
+                    object.meshes = readMeshSet(Cursor(m_pData, m_size, meshSetOffset));
+                    wpMeshes = object.meshes;
+                }
+            }
+
+            if (!spBatch) {
+                spBatch = std::make_shared<std::vector<SceneData::Object>>();
+                spBatch->reserve(batchCount);
+            }
+            spBatch->push_back(std::move(object));
+            nDelivered++;
+
+            if (spBatch->size() >= batchCount) {
+                if (!onObjectsReady(std::move(spBatch)))
+                    return nDelivered;
+                spBatch = nullptr;
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        Logger::Error(Prefix + "Failed to read the scene objects: " + e.what());
+    }
+
+    if (spBatch && !spBatch->empty())
+        onObjectsReady(std::move(spBatch));
+    return nDelivered;
+}
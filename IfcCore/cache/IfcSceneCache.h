@@ -0,0 +1,117 @@
+#ifndef IFCSCENECACHE_H
+#define IFCSCENECACHE_H
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "DataNode.h"
+#include "SceneData.h"
+
+/*
+ * Binary cache of a loaded model, written next to the IFC file as <file>.ifccache.
+ * It holds the structure tree, the scene objects with their transforms and the meshes,
+ * shared meshes being stored once. A cache is only used if its format version,
+ * the hash of the IFC file and the hash of the geometry settings all match.
+ *
+ * Layout: fixed header | mesh sets | object table | tree
+ */
+class IfcSceneCache
+{
+public:
+    static constexpr uint32_t FormatVersion = 2; // 2: storeys list the openings of their elements
+
+    static std::string cachePath(const std::string& ifcPath) { return ifcPath + ".ifccache"; }
+
+    // Content hash of a file, 0 if it cannot be read
+    static uint64_t hashFile(const std::string& path);
+    static uint64_t hashString(const std::string& text);
+};
+
+/*
+ * Writes a cache while a model is loading: meshes are appended as objects arrive,
+ * the object table and the tree on commit. Nothing replaces an existing cache
+ * until commit succeeds.
+ */
+class IfcSceneCacheWriter
+{
+public:
+    // Null if the temporary cache file cannot be created, eg. read-only directory
+    static std::unique_ptr<IfcSceneCacheWriter> create(const std::string& ifcPath, uint64_t fileHash, uint64_t settingsHash);
+    ~IfcSceneCacheWriter();
+
+    // refined: full quality meshes replacing those of objects added before
+    void addObjects(const std::vector<SceneData::Object>& objects, bool refined);
+
+    bool commit(DataNode::Base* pTree);
+
+private:
+    struct ObjectRecord {
+        std::string name;
+        std::string type;
+        std::string geometryId;
+        std::string guid;
+        SceneData::Matrix4x4 transform;
+        uint64_t meshSetOffset;
+    };
+
+    IfcSceneCacheWriter(const std::string& finalPath, const std::string& tempPath, uint64_t fileHash, uint64_t settingsHash);
+
+    std::string m_finalPath;
+    std::string m_tempPath;
+    std::ofstream m_out;
+    uint64_t m_fileHash;
+    uint64_t m_settingsHash;
+    bool m_committed = false;
+    bool m_failed = false;
+
+    std::vector<ObjectRecord> m_objects;
+    std::unordered_map<std::string, size_t> m_objectIndexByGuid;
+    std::unordered_map<std::string, uint64_t> m_meshSetByGeometryId[2]; // per pass, coarse and refined tessellations differ
+
+    uint64_t writeMeshSet(const std::vector<SceneData::Mesh>& meshes);
+};
+
+/*
+ * Reads a cache through a read-only memory mapping, without touching the IFC file.
+ */
+class IfcSceneCacheReader
+{
+public:
+    using Callback_ObjectsReady = std::function<bool(std::shared_ptr<std::vector<SceneData::Object>> objects)>;
+
+    // Null if there is no cache for these hashes
+    static std::unique_ptr<IfcSceneCacheReader> open(const std::string& ifcPath, uint64_t fileHash, uint64_t settingsHash);
+    ~IfcSceneCacheReader();
+
+    IfcSceneCacheReader(const IfcSceneCacheReader&) = delete;
+    IfcSceneCacheReader& operator=(const IfcSceneCacheReader&) = delete;
+
+    std::unique_ptr<DataNode::Base> readTree() const;
+
+    size_t objectCount() const { return static_cast<size_t>(m_objectCount); }
+
+    /**
+     * Deliver the cached objects in batches
+     * @param pGuids: only the objects with these GUIDs, all if null
+     * @param onObjectsReady: receives each batch, returns false to stop reading
+     * @return number of objects delivered
+     */
+    size_t readObjects(size_t batchCount, const std::unordered_set<std::string>* pGuids, Callback_ObjectsReady onObjectsReady) const;
+
+private:
+    IfcSceneCacheReader(const uint8_t* pData, size_t size);
+
+    const uint8_t* m_pData;
+    size_t m_size;
+    uint64_t m_objectsOffset = 0;
+    uint64_t m_objectCount = 0;
+    uint64_t m_treeOffset = 0;
+};
+
+#endif // IFCSCENECACHE_H
@@ -0,0 +1,8 @@
+set(
+    CACHE_SOURCES
+    ${CMAKE_CURRENT_LIST_DIR}/cache.cmake
+    ${CMAKE_CURRENT_LIST_DIR}/IfcSceneCache.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcSceneCache.cpp
+)
+
+source_group(cache FILES ${CACHE_SOURCES})
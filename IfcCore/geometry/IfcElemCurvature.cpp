@@ -0,0 +1,58 @@
+#include "IfcElemCurvature.h"
+
+#include <ifcparse/IfcFile.h>
+
+namespace {
+    // Curves, surfaces, profiles and solids which are tessellated with deflection
+    const char* const CurvedClasses[] = {
+        "IfcConic", "IfcBSplineCurve", "IfcBSplineSurface",
+        "IfcCircleProfileDef", "IfcEllipseProfileDef", "IfcRoundedRectangleProfileDef",
+        "IfcSweptDiskSolid", "IfcRevolvedAreaSolid", "IfcSurfaceOfRevolution",
+        "IfcCylindricalSurface", "IfcSphericalSurface", "IfcToroidalSurface",
+        "IfcSphere", "IfcRightCircularCylinder", "IfcRightCircularCone"
+    };
+}
+
+bool IfcElemCurvature::isCurved(IfcUtil::IfcBaseEntity* pProduct)
+{
+    if(!pProduct)
+        return false;
+
+    //filters may be evaluated by the iterator threads
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto [it, inserted] = m_curvedById.try_emplace(pProduct->id(), false);
+    if(inserted)
+        it->second = isCurved(m_ifcFile, pProduct);
+    return it->second;
+}
+
+size_t IfcElemCurvature::curvedCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t nCurved = 0;
+    for(const auto& [id, curved] : m_curvedById)
+        nCurved += curved;
+    return nCurved;
+}
+
+bool IfcElemCurvature::isCurved(IfcParse::IfcFile& ifcFile, IfcUtil::IfcBaseEntity* pProduct)
+{
+    if(!pProduct)
+        return false;
+
+    auto representation = pProduct->get("Representation");
+    if(representation.isNull())
+        return false;
+
+    //all the instances the representation refers to, including mapped representations
+    IfcUtil::IfcBaseClass* pRepresentation = representation;
+    auto instances = ifcFile.traverse(pRepresentation);
+    for(auto pInstance : *instances)
+    {
+        const auto& decl = pInstance->declaration();
+        for(const auto& curvedClass : CurvedClasses)
+            if(decl.is(curvedClass))
+                return true;
+    }
+    return false;
+}
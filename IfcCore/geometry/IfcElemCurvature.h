@@ -0,0 +1,36 @@
+#ifndef IFCELEMCURVATURE_H
+#define IFCELEMCURVATURE_H
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+
+namespace IfcParse { class IfcFile; }
+namespace IfcUtil { class IfcBaseEntity; }
+
+/*
+ * Tells whether the shape representation of a product contains curved geometry,
+ * ie. whether its tessellation depends on the linear and angular deflection.
+ * An instance remembers the answer by product, for a load whose iterators (eg. one per priority tier)
+ * each filter every product of the file.
+ */
+class IfcElemCurvature
+{
+public:
+    explicit IfcElemCurvature(IfcParse::IfcFile& ifcFile): m_ifcFile(ifcFile) {}
+
+    // Cached isCurved, the representation of a product is traversed once
+    bool isCurved(IfcUtil::IfcBaseEntity* pProduct);
+
+    static bool isCurved(IfcParse::IfcFile& ifcFile, IfcUtil::IfcBaseEntity* pProduct);
+
+    // Products found curved so far, 0 when the load selected none
+    size_t curvedCount();
+
+private:
+    IfcParse::IfcFile& m_ifcFile;
+    std::unordered_map<unsigned, bool> m_curvedById; // by instance id of the product
+    std::mutex m_mutex;
+};
+
+#endif // IFCELEMCURVATURE_H
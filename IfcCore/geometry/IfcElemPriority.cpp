@@ -0,0 +1,41 @@
+#include "IfcElemPriority.h"
+
+#include <ifcparse/IfcBaseClass.h>
+
+namespace {
+    // declaration().is() also matches subtypes, eg. IfcWallStandardCase is an IfcWall
+    const char* const Tier0Classes[] = {
+        "IfcWall", "IfcCurtainWall", "IfcSlab", "IfcRoof",
+        "IfcColumn", "IfcBeam", "IfcMember", "IfcPlate",
+        "IfcFooting", "IfcPile"
+    };
+
+    const char* const Tier1Classes[] = {
+        "IfcWindow", "IfcDoor", "IfcStair", "IfcStairFlight",
+        "IfcRamp", "IfcRampFlight", "IfcRailing", "IfcCovering",
+        "IfcChimney", "IfcShadingDevice", "IfcBuildingElementProxy"
+    };
+}
+
+int IfcElemPriority::tier(IfcUtil::IfcBaseEntity* pProduct)
+{
+    if(!pProduct)
+        return TierCount - 1;
+
+    const auto& decl = pProduct->declaration();
+
+    for(const auto& ifcClass : Tier0Classes)
+        if(decl.is(ifcClass))
+            return 0;
+
+    for(const auto& ifcClass : Tier1Classes)
+        if(decl.is(ifcClass))
+            return 1;
+
+    return TierCount - 1;
+}
+
+bool IfcElemPriority::isHiddenByDefault(const std::string& ifcClass)
+{
+    return ifcClass == "IfcOpeningElement" || ifcClass == "IfcSpace";
+}
@@ -0,0 +1,24 @@
+#ifndef IFCELEMPRIORITY_H
+#define IFCELEMPRIORITY_H
+
+#include <string>
+
+namespace IfcUtil { class IfcBaseEntity; }
+
+/*
+ * Cheap load priority of IFC products, based on their class only.
+ * Tier 0 is the building envelope and structure, which makes a model recognizable,
+ * tier 1 the secondary building elements, the last tier everything else (fittings, furniture ...)
+ */
+class IfcElemPriority
+{
+public:
+    static constexpr int TierCount = 3;
+
+    static int tier(IfcUtil::IfcBaseEntity* pProduct);
+
+    // Classes which are not displayed by default, thus not counted as visible volume
+    static bool isHiddenByDefault(const std::string& ifcClass);
+};
+
+#endif // IFCELEMPRIORITY_H
@@ -8,6 +8,8 @@ public:
     virtual ~IfcElemProcessorBase() = default;
     virtual bool process(const IfcGeom::Element* pElement) = 0;
     virtual void onStart() {}
+    // All the elements of one iterator were processed, eg. one priority tier
+    virtual void onPassFinished() {}
     virtual void onFinish(bool success, const std::string& message) {}
 };
 
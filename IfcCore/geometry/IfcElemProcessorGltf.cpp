@@ -0,0 +1,418 @@
+#include "IfcElemProcessorGltf.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace {
+    const std::string Prefix("[ElemProcessorGltf] ");
+
+    constexpr uint32_t GlbMagic = 0x46546C67;     // "glTF"
+    constexpr uint32_t GlbVersion = 2;
+    constexpr uint32_t ChunkJson = 0x4E4F534A;    // "JSON"
+    constexpr uint32_t ChunkBin = 0x004E4942;     // "BIN\0"
+    constexpr int ComponentFloat = 5126;
+    constexpr int ComponentUnsignedInt = 5125;
+    constexpr int TargetArrayBuffer = 34962;
+    constexpr int TargetElementArrayBuffer = 34963;
+
+    std::string jsonString(const std::string& text) {
+        std::string out = "\"";
+        for (unsigned char c : text) {
+            switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                }
+                else
+                    out += static_cast<char>(c);
+            }
+        }
+        return out + "\"";
+    }
+
+    // Round trip precision: node translations of georeferenced models are in the millions of meters
+    std::string jsonNumber(double value) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.17g", value);
+        return text;
+    }
+
+    template<typename Values>
+    std::string jsonArray(const Values& values) {
+        std::string out = "[";
+        for (size_t i = 0; i < values.size(); ++i)
+            out += (i ? "," : "") + jsonNumber(values[i]);
+        return out + "]";
+    }
+
+    void writeUint32(std::ofstream& out, uint32_t value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value)); // glb is little endian, as the supported platforms
+    }
+}
+
+bool IfcElemProcessorGltf::Spool::open(const std::string& spoolPath) {
+    path = spoolPath;
+    out.open(path, std::ios::binary | std::ios::trunc);
+    size = 0;
+    count = 0;
+    return out.is_open();
+}
+
+void IfcElemProcessorGltf::Spool::write(const void* pData, size_t nBytes) {
+    out.write(static_cast<const char*>(pData), static_cast<std::streamsize>(nBytes));
+    size += nBytes;
+}
+
+void IfcElemProcessorGltf::Spool::appendJson(const std::string& element) {
+    if (count++)
+        write(",", 1);
+    write(element.data(), element.size());
+}
+
+bool IfcElemProcessorGltf::Spool::copyTo(std::ofstream& target) {
+    out.close();
+    if (size == 0)
+        return true;
+    std::ifstream in(path, std::ios::binary);
+    target << in.rdbuf();
+    return in.good() || in.eof();
+}
+
+void IfcElemProcessorGltf::Spool::remove() {
+    if (out.is_open())
+        out.close();
+    if (!path.empty())
+        std::remove(path.c_str());
+}
+
+IfcElemProcessorGltf::IfcElemProcessorGltf(const std::string& outputPath): m_outputPath(outputPath)
+{
+}
+
+IfcElemProcessorGltf::~IfcElemProcessorGltf() {
+    removeSpools();
+}
+
+void IfcElemProcessorGltf::onStart() {
+    m_failed = false;
+    m_written = false;
+    m_meshByGeometryId.clear();
+    m_materialByColor.clear();
+    m_materials.clear();
+
+    bool opened = m_vertexData.open(m_outputPath + ".vertices.tmp")
+               && m_indexData.open(m_outputPath + ".indices.tmp")
+               && m_nodes.open(m_outputPath + ".nodes.tmp")
+               && m_meshes.open(m_outputPath + ".meshes.tmp")
+               && m_accessors.open(m_outputPath + ".accessors.tmp")
+               && m_rootChildren.open(m_outputPath + ".children.tmp");
+    if (!opened)
+    {
+        Logger::Error(Prefix + "Failed to create temporary files next to " + m_outputPath);
+        m_failed = true;
+    }
+}
+
+void IfcElemProcessorGltf::onFinish(bool success, const std::string& message) {
+    if (success && !m_failed)
+    {
+        m_written = writeGlb();
+        if (m_written)
+            Logger::Notice(Prefix + "Exported " + std::to_string(m_nodes.count) + " nodes, "
+                           + std::to_string(m_meshes.count) + " meshes to " + m_outputPath);
+    }
+    else
+        Logger::Error(Prefix + "Export to " + m_outputPath + " abandoned: " + (m_failed ? "write error" : message));
+    removeSpools();
+}
+
+bool IfcElemProcessorGltf::process(const IfcGeom::Element* pElement) {
+    if (m_failed)
+        return false;
+
+    const auto* triElem = dynamic_cast<const IfcGeom::TriangulationElement*>(pElement);
+    if(!triElem)
+    {
+        Logger::Error(Prefix + "null or not triangulation element");
+        return false;
+    }
+
+    // Instances of an already exported geometry only add a node
+    const auto& geometryId = triElem->geometry().id();
+    auto itMesh = m_meshByGeometryId.find(geometryId);
+    size_t meshIndex;
+    if (itMesh != m_meshByGeometryId.end())
+        meshIndex = itMesh->second;
+    else
+    {
+        const auto& spGeomTri = triElem->geometry_pointer();
+        const std::vector<int>& indicesFaces = spGeomTri->faces();
+        const std::vector<int>& materialIds = spGeomTri->material_ids();
+        if (indicesFaces.empty() || indicesFaces.size() % 3 != 0 || indicesFaces.size() / 3 > materialIds.size())
+        {
+            Logger::Error(Prefix + "Failed: incomplete faces for " + triElem->guid());
+            return false;
+        }
+
+        std::vector<SceneData::ColorRGBA> materialColors;
+        for (const auto& pMaterial : spGeomTri->materials())
+        {
+            SceneData::ColorRGBA color;
+            if (pMaterial)
+            {
+                float alpha = 1.0f - pMaterial->transparency;
+                color = {(float)pMaterial->diffuse.r(), (float)pMaterial->diffuse.g(), (float)pMaterial->diffuse.b(),
+                         std::isnan(alpha) ? 1.0f : alpha};
+            }
+            materialColors.push_back(color);
+        }
+
+        meshIndex = addMesh(spGeomTri->verts(), spGeomTri->normals(), indicesFaces, materialIds, materialColors);
+        m_meshByGeometryId.emplace(geometryId, meshIndex);
+    }
+
+    // glTF matrices are column major
+    std::array<double, 16> matrix;
+    const auto& transform4x4 = triElem->transformation().data()->components();
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+            matrix[col * 4 + row] = transform4x4(row, col);
+
+    addNode(triElem->name(), triElem->type(), triElem->guid(), matrix, meshIndex);
+
+    if (!m_vertexData.out || !m_indexData.out || !m_nodes.out || !m_meshes.out || !m_accessors.out || !m_rootChildren.out)
+    {
+        Logger::Error(Prefix + "Failed to write temporary files next to " + m_outputPath);
+        m_failed = true;
+        return false;
+    }
+    return true;
+}
+
+size_t IfcElemProcessorGltf::addMesh(const std::vector<double>& coordsVertices, const std::vector<double>& coordsNormals,
+                                     const std::vector<int>& indicesFaces, const std::vector<int>& materialIds,
+                                     const std::vector<SceneData::ColorRGBA>& materialColors) {
+    const size_t nVerts = coordsVertices.size() / 3;
+
+    // Positions, with the bounds required by glTF
+    std::array<double, 3> minBound, maxBound;
+    minBound.fill(std::numeric_limits<double>::max());
+    maxBound.fill(std::numeric_limits<double>::lowest());
+    std::vector<float> values(coordsVertices.size());
+    for (size_t i = 0; i < coordsVertices.size(); ++i)
+    {
+        values[i] = static_cast<float>(coordsVertices[i]);
+        minBound[i % 3] = std::min(minBound[i % 3], double(values[i]));
+        maxBound[i % 3] = std::max(maxBound[i % 3], double(values[i]));
+    }
+    size_t positionAccessor = addAccessor(false, m_vertexData.size, nVerts, "VEC3",
+                                          ",\"min\":" + jsonArray(minBound) + ",\"max\":" + jsonArray(maxBound));
+    m_vertexData.write(values.data(), values.size() * sizeof(float));
+
+    // Normals, renormalized as glTF requires unit length
+    std::string attributes = "{\"POSITION\":" + std::to_string(positionAccessor);
+    if (coordsNormals.size() == coordsVertices.size())
+    {
+        for (size_t i = 0; i < nVerts; ++i)
+        {
+            double x = coordsNormals[3 * i], y = coordsNormals[3 * i + 1], z = coordsNormals[3 * i + 2];
+            double length = std::sqrt(x * x + y * y + z * z);
+            if (length > 0.0)
+            {
+                x /= length;
+                y /= length;
+                z /= length;
+            }
+            else
+                z = 1.0;
+            values[3 * i] = float(x);
+            values[3 * i + 1] = float(y);
+            values[3 * i + 2] = float(z);
+        }
+        size_t normalAccessor = addAccessor(false, m_vertexData.size, nVerts, "VEC3", "");
+        m_vertexData.write(values.data(), values.size() * sizeof(float));
+        attributes += ",\"NORMAL\":" + std::to_string(normalAccessor);
+    }
+    attributes += "}";
+
+    // One primitive per material, sharing the vertex accessors
+    std::map<int, std::vector<uint32_t>> groupedFaces;
+    for (size_t face = 0; face < indicesFaces.size() / 3; ++face)
+        for (int i = 0; i < 3; ++i)
+            groupedFaces[materialIds[face]].push_back(static_cast<uint32_t>(indicesFaces[3 * face + i]));
+
+    std::string primitives;
+    for (const auto& group : groupedFaces)
+    {
+        const std::vector<uint32_t>& indices = group.second;
+        size_t indexAccessor = addAccessor(true, m_indexData.size, indices.size(), "SCALAR", "");
+        m_indexData.write(indices.data(), indices.size() * sizeof(uint32_t));
+
+        int matId = group.first;
+        SceneData::ColorRGBA color;
+        if (matId >= 0 && size_t(matId) < materialColors.size())
+            color = materialColors[matId];
+
+        primitives += (primitives.empty() ? "" : ",");
+        primitives += "{\"attributes\":" + attributes + ",\"indices\":" + std::to_string(indexAccessor)
+                    + ",\"material\":" + std::to_string(material(color)) + "}";
+    }
+
+    m_meshes.appendJson("{\"primitives\":[" + primitives + "]}");
+    return m_meshes.count - 1;
+}
+
+size_t IfcElemProcessorGltf::addAccessor(bool indices, uint64_t byteOffset, size_t count, const std::string& type, const std::string& bounds) {
+    // Buffer view 0 holds the vertex data, 1 the indices
+    m_accessors.appendJson("{\"bufferView\":" + std::string(indices ? "1" : "0")
+                           + ",\"byteOffset\":" + std::to_string(byteOffset)
+                           + ",\"componentType\":" + std::to_string(indices ? ComponentUnsignedInt : ComponentFloat)
+                           + ",\"count\":" + std::to_string(count)
+                           + ",\"type\":\"" + type + "\"" + bounds + "}");
+    return m_accessors.count - 1;
+}
+
+size_t IfcElemProcessorGltf::material(const SceneData::ColorRGBA& color) {
+    std::array<float, 4> key{color.r, color.g, color.b, color.a};
+    auto it = m_materialByColor.find(key);
+    if (it != m_materialByColor.end())
+        return it->second;
+
+    std::string json = "{\"pbrMetallicRoughness\":{\"baseColorFactor\":" + jsonArray(key)
+                     + ",\"metallicFactor\":0,\"roughnessFactor\":0.9},\"doubleSided\":true";
+    if (color.a < 1.0f)
+        json += ",\"alphaMode\":\"BLEND\"";
+    m_materials.push_back(json + "}");
+    m_materialByColor.emplace(key, m_materials.size() - 1);
+    return m_materials.size() - 1;
+}
+
+void IfcElemProcessorGltf::addNode(const std::string& name, const std::string& type, const std::string& guid,
+                                   const std::array<double, 16>& columnMajorMatrix, size_t meshIndex) {
+    static const std::array<double, 16> Identity{1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1};
+
+    std::string json = "{\"name\":" + jsonString(name) + ",\"mesh\":" + std::to_string(meshIndex);
+    if (columnMajorMatrix != Identity)
+        json += ",\"matrix\":" + jsonArray(columnMajorMatrix);
+    json += ",\"extras\":{\"guid\":" + jsonString(guid) + ",\"ifcClass\":" + jsonString(type) + "}}";
+
+    m_rootChildren.appendJson(std::to_string(m_nodes.count));
+    m_nodes.appendJson(json);
+}
+
+bool IfcElemProcessorGltf::writeGlb() {
+    // The JSON chunk is the spooled arrays between fixed parts, its length is known before it is written
+    struct Part {
+        std::string text;
+        Spool* pSpool;
+    };
+    std::vector<Part> parts;
+    auto text = [&parts](const std::string& t) { parts.push_back({t, nullptr}); };
+    auto spool = [&parts](Spool& s) { parts.push_back({{}, &s}); };
+
+    const uint64_t binSize = m_vertexData.size + m_indexData.size;
+    const size_t rootNode = m_nodes.count;
+
+    // Z up to Y up: -90 degrees around X
+    text("{\"asset\":{\"version\":\"2.0\",\"generator\":\"IfcViewer\"},\"scene\":0,\"scenes\":[{\"nodes\":["
+         + std::to_string(rootNode) + "]}],\"nodes\":[");
+    spool(m_nodes);
+    text(std::string(m_nodes.count ? "," : "") + "{\"name\":\"IfcModel\",\"rotation\":[-0.707106781,0,0,0.707106781]");
+    if (m_rootChildren.count)
+    {
+        text(",\"children\":[");
+        spool(m_rootChildren);
+        text("]");
+    }
+    text("}]");
+
+    if (m_meshes.count)
+    {
+        text(",\"meshes\":[");
+        spool(m_meshes);
+        text("],\"accessors\":[");
+        spool(m_accessors);
+
+        std::string materials;
+        for (const auto& material : m_materials)
+            materials += (materials.empty() ? "" : ",") + material;
+        text("],\"materials\":[" + materials + "]");
+
+        std::string bufferViews = "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + std::to_string(m_vertexData.size)
+                                + ",\"byteStride\":12,\"target\":" + std::to_string(TargetArrayBuffer) + "}";
+        if (m_indexData.size)
+            bufferViews += ",{\"buffer\":0,\"byteOffset\":" + std::to_string(m_vertexData.size)
+                         + ",\"byteLength\":" + std::to_string(m_indexData.size)
+                         + ",\"target\":" + std::to_string(TargetElementArrayBuffer) + "}";
+        text(",\"bufferViews\":[" + bufferViews + "],\"buffers\":[{\"byteLength\":" + std::to_string(binSize) + "}]");
+    }
+    text("}");
+
+    uint64_t jsonSize = 0;
+    for (auto& part : parts)
+    {
+        if (part.pSpool)
+        {
+            part.pSpool->out.flush();
+            jsonSize += part.pSpool->size;
+        }
+        else
+            jsonSize += part.text.size();
+    }
+    const uint64_t jsonPadding = (4 - jsonSize % 4) % 4;
+    const uint64_t totalSize = 12 + 8 + jsonSize + jsonPadding + (binSize ? 8 + binSize : 0);
+    if (totalSize > std::numeric_limits<uint32_t>::max())
+    {
+        Logger::Error(Prefix + "Model exceeds the 4 GB limit of a .glb file");
+        return false;
+    }
+
+    std::ofstream out(m_outputPath, std::ios::binary | std::ios::trunc);
+    writeUint32(out, GlbMagic);
+    writeUint32(out, GlbVersion);
+    writeUint32(out, static_cast<uint32_t>(totalSize));
+
+    writeUint32(out, static_cast<uint32_t>(jsonSize + jsonPadding));
+    writeUint32(out, ChunkJson);
+    bool copied = true;
+    for (auto& part : parts)
+    {
+        if (part.pSpool)
+            copied = part.pSpool->copyTo(out) && copied;
+        else
+            out << part.text;
+    }
+    out << std::string(jsonPadding, ' ');
+
+    // Vertex and index data are multiples of 4 bytes, no padding needed
+    if (binSize)
+    {
+        writeUint32(out, static_cast<uint32_t>(binSize));
+        writeUint32(out, ChunkBin);
+        copied = m_vertexData.copyTo(out) && copied;
+        copied = m_indexData.copyTo(out) && copied;
+    }
+
+    out.close();
+    if (!copied || !out)
+    {
+        Logger::Error(Prefix + "Failed to write " + m_outputPath);
+        std::remove(m_outputPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void IfcElemProcessorGltf::removeSpools() {
+    for (Spool* pSpool : {&m_vertexData, &m_indexData, &m_nodes, &m_meshes, &m_accessors, &m_rootChildren})
+        pSpool->remove();
+}
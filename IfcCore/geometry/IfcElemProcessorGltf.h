@@ -0,0 +1,80 @@
+#ifndef IFCELEMPROCESSORGLTF_H
+#define IFCELEMPROCESSORGLTF_H
+
+#include <array>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IfcElemProcessorBase.h"
+#include "SceneData.h"
+
+/*
+ * Exports the elements to a binary glTF 2.0 file (.glb) while they are tessellated.
+ * Vertex data and JSON are appended to temporary files next to the output as elements arrive,
+ * and assembled into the .glb on finish: memory use does not grow with the vertex count.
+ * Elements sharing a geometry id are nodes instancing the same glTF mesh.
+ * Each node carries its IFC GlobalId, class and name in its extras.
+ * The model is Z up, a root node rotates it to the Y up convention of glTF.
+ */
+class IfcElemProcessorGltf : public IfcElemProcessorBase
+{
+public:
+    explicit IfcElemProcessorGltf(const std::string& outputPath);
+    ~IfcElemProcessorGltf() override;
+
+    bool process(const IfcGeom::Element* pElement) override;
+    void onStart() override;
+    void onFinish(bool success, const std::string& message) override;
+
+    // True once the .glb file has been written
+    bool isWritten() const { return m_written; }
+    size_t nodeCount() const { return m_nodes.count; }
+    size_t meshCount() const { return m_meshes.count; }
+
+private:
+    // Temporary file receiving one part of the output
+    struct Spool {
+        std::string path;
+        std::ofstream out;
+        uint64_t size = 0;
+        size_t count = 0; // JSON array elements appended
+
+        bool open(const std::string& spoolPath);
+        void write(const void* pData, size_t nBytes);
+        void appendJson(const std::string& element); // comma separated array element
+        bool copyTo(std::ofstream& target);
+        void remove();
+    };
+
+    std::string m_outputPath;
+    bool m_failed = false;
+    bool m_written = false;
+
+    Spool m_vertexData;  // positions and normals, float VEC3
+    Spool m_indexData;   // uint32 triangle indices
+    Spool m_nodes;       // element nodes
+    Spool m_meshes;
+    Spool m_accessors;
+    Spool m_rootChildren; // indices of the element nodes
+
+    std::unordered_map<std::string, size_t> m_meshByGeometryId;
+    std::map<std::array<float, 4>, size_t> m_materialByColor;
+    std::vector<std::string> m_materials;
+
+    // Write the geometry as a glTF mesh, one primitive per material, return its index
+    size_t addMesh(const std::vector<double>& coordsVertices, const std::vector<double>& coordsNormals,
+                   const std::vector<int>& indicesFaces, const std::vector<int>& materialIds,
+                   const std::vector<SceneData::ColorRGBA>& materialColors);
+    size_t addAccessor(bool indices, uint64_t byteOffset, size_t count, const std::string& type, const std::string& bounds);
+    size_t material(const SceneData::ColorRGBA& color);
+    void addNode(const std::string& name, const std::string& type, const std::string& guid,
+                 const std::array<double, 16>& columnMajorMatrix, size_t meshIndex);
+
+    bool writeGlb();
+    void removeSpools();
+};
+
+#endif // IFCELEMPROCESSORGLTF_H
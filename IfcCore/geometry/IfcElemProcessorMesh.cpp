@@ -1,11 +1,14 @@
 #include "IfcElemProcessorMesh.h"
+#include "IfcTrace.h"
+#include "IfcMemory.h"
+#include "MeshCodec.h"
 
 void IfcElemProcessorMesh::onStart() {
     m_lastGeometryId.clear();
-    if(m_spLastCreatedMeshes)
-        m_spLastCreatedMeshes->clear();
-    if(m_spSceneObjects)
-        m_spSceneObjects->clear();
+    m_spLastCreatedMeshes = nullptr;
+    m_spSceneObjects = std::make_shared<std::vector<SceneData::Object>>();
+    m_residentBytes = 0;
+    m_nSpilledMeshes = 0;
 }
 
 void IfcElemProcessorMesh::onFinish(bool success, const std::string& message) {
@@ -13,7 +16,7 @@ void IfcElemProcessorMesh::onFinish(bool success, const std::string& message) {
 
 bool IfcElemProcessorMesh::process(const IfcGeom::Element* pElement) {
 
-    std::string Prefix("[ElemProcessorMesh] ");
+    static const std::string Prefix("[ElemProcessorMesh] ");
     const auto* triElem = dynamic_cast<const IfcGeom::TriangulationElement*>(pElement);
     if(!triElem)
     {
@@ -28,12 +31,6 @@ bool IfcElemProcessorMesh::process(const IfcGeom::Element* pElement) {
     currentObject.geometryId = triElem->geometry().id();
     currentObject.guid = triElem->guid();
 
-    Logger::Notice(Prefix + "Iteratoring geom "
-                   + currentObject.type
-                   + ":" + currentObject.name
-                   + " geometryId :" + currentObject.geometryId
-                   + " guid: " + currentObject.guid );
-
     //Transformation
     SceneData::Matrix4x4 matrix;
     const auto& transform4x4 = triElem->transformation().data()->components();
@@ -42,18 +39,15 @@ bool IfcElemProcessorMesh::process(const IfcGeom::Element* pElement) {
             matrix.m[row * 4 + col] = transform4x4(row,col);
     currentObject.transform = std::move(matrix);
 
-    std::string m("----matrix----");
-    for(int i=0; i<16; ++i)
-        m+= std::to_string(matrix.m[i]) + ",";
-    m+="\n";
-    Logger::Notice(Prefix + m);
-
+    //element and its translation, nothing is formatted here
+    IFC_TRACE(Debug, "mesh.element", currentObject.guid, {matrix.m[3], matrix.m[7], matrix.m[11]});
 
     // If it's the same geometry, reuse it
     const auto & curGeometryId = triElem->geometry().id();
     if(curGeometryId == m_lastGeometryId)
     {
-        Logger::Notice(Prefix + "same geometry ID, reuse last created meshes");
+        IFC_TRACE(Debug, "mesh.instance", currentObject.guid);
+        IfcMemory::markInstanced(m_spLastCreatedMeshes);
         currentObject.meshes = m_spLastCreatedMeshes;
         m_spSceneObjects->push_back(std::move(currentObject));
         return true;
@@ -97,30 +91,43 @@ bool IfcElemProcessorMesh::process(const IfcGeom::Element* pElement) {
     }
 
     //Create mesh for each group of faces
-    std::shared_ptr<std::vector<SceneData::Mesh>> spCurrentMeshes = std::make_shared<std::vector<SceneData::Mesh>>();
+    std::vector<SceneData::Mesh> currentMeshes;
     for (const auto& group : groupedFaces)
     {
         int matId = group.first;
         const std::vector<int>& vertIndices = group.second;
         auto nVerts = vertIndices.size();
 
-        std::vector<SceneData::Vec3f> vertices, normals;
-        vertices.reserve(nVerts);
-        normals.reserve(nVerts);
-        for (int index : vertIndices)
+        SceneData::Mesh mesh;
+        if (m_vertexLayout == SceneData::VertexLayout::Packed)
         {
-            int coordIndex = 3 * index; // This is the start index of the coordinates
-            vertices.push_back(SceneData::Vec3f(coordsVertices[coordIndex],
-                                                coordsVertices[coordIndex + 1],
-                                                coordsVertices[coordIndex + 2]));
-            normals.push_back(SceneData::Vec3f(coordsNormals[coordIndex],
-                                               coordsNormals[coordIndex + 1],
-                                               coordsNormals[coordIndex + 2]));
+            mesh.packedVertices.reserve(nVerts);
+            for (int index : vertIndices)
+            {
+                int coordIndex = 3 * index; // This is the start index of the coordinates
+                mesh.packedVertices.push_back(SceneData::packVertex(
+                    SceneData::Vec3f(coordsVertices[coordIndex], coordsVertices[coordIndex + 1], coordsVertices[coordIndex + 2]),
+                    SceneData::Vec3f(coordsNormals[coordIndex], coordsNormals[coordIndex + 1], coordsNormals[coordIndex + 2])));
+            }
+        }
+        else
+        {
+            std::vector<SceneData::Vec3f> vertices, normals;
+            vertices.reserve(nVerts);
+            normals.reserve(nVerts);
+            for (int index : vertIndices)
+            {
+                int coordIndex = 3 * index; // This is the start index of the coordinates
+                vertices.push_back(SceneData::Vec3f(coordsVertices[coordIndex],
+                                                    coordsVertices[coordIndex + 1],
+                                                    coordsVertices[coordIndex + 2]));
+                normals.push_back(SceneData::Vec3f(coordsNormals[coordIndex],
+                                                   coordsNormals[coordIndex + 1],
+                                                   coordsNormals[coordIndex + 2]));
+            }
+            mesh.vertices = std::move(vertices);
+            mesh.normals = std::move(normals);
         }
-
-        SceneData::Mesh mesh;
-        mesh.vertices = std::move(vertices);
-        mesh.normals = std::move(normals);
 
         if (const auto& pMaterial = materials[matId])
         {
@@ -140,9 +147,22 @@ bool IfcElemProcessorMesh::process(const IfcGeom::Element* pElement) {
             Logger::Warning("Warning: Null material style pointer for material ID :" + std::to_string(matId));
         }
 
-        spCurrentMeshes->push_back(std::move(mesh));
+        if (m_compressMeshes)
+            MeshCodec::compress(mesh);
+
+        // Over budget, the mesh goes out of core; it stays in memory if it cannot be written
+        size_t meshBytes = MeshCodec::vertexBytes(mesh);
+        if (m_spSpillFile && m_residentBytes + meshBytes > m_memoryBudget && m_spSpillFile->spill(mesh))
+            m_nSpilledMeshes++;
+        else
+            m_residentBytes += meshBytes;
+
+        currentMeshes.push_back(std::move(mesh));
     }
 
+    // Counted in IfcMemory for as long as the meshes are referenced
+    auto spCurrentMeshes = IfcMemory::trackMeshes(std::move(currentMeshes));
+
     m_lastGeometryId = curGeometryId;
     m_spLastCreatedMeshes = spCurrentMeshes;
 
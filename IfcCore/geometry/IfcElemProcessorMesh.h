@@ -3,6 +3,7 @@
 
 #include "IfcElemProcessorBase.h"
 #include "SceneData.h"
+#include "MeshSpillFile.h"
 
 class IfcElemProcessorMesh : public IfcElemProcessorBase
 {
@@ -13,7 +14,26 @@ public:
 
     inline std::shared_ptr<std::vector<SceneData::Object>> getSceneObjects() {return m_spSceneObjects;}
 
+    void setVertexLayout(SceneData::VertexLayout layout) { m_vertexLayout = layout; }
+
+    // Keep the meshes encoded with MeshCodec, read them through MeshView
+    void setMeshCompression(bool enabled) { m_compressMeshes = enabled; }
+
+    // Meshes created once budgetBytes of vertex data are resident go to the spill file, read them through MeshView
+    void setMemoryBudget(size_t budgetBytes, std::shared_ptr<MeshSpillFile> spSpillFile) {
+        m_memoryBudget = budgetBytes;
+        m_spSpillFile = std::move(spSpillFile);
+    }
+    size_t spilledMeshCount() const { return m_nSpilledMeshes; }
+
 private:
+    SceneData::VertexLayout m_vertexLayout = SceneData::VertexLayout::Separate;
+    bool m_compressMeshes = false;
+
+    size_t m_memoryBudget = 0;
+    size_t m_residentBytes = 0;
+    size_t m_nSpilledMeshes = 0;
+    std::shared_ptr<MeshSpillFile> m_spSpillFile = nullptr;
     std::string m_lastGeometryId;
     std::shared_ptr<std::vector<SceneData::Mesh>> m_spLastCreatedMeshes = nullptr;
     std::shared_ptr<std::vector<SceneData::Object>> m_spSceneObjects = nullptr;
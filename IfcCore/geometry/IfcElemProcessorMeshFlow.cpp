@@ -1,4 +1,9 @@
 #include "IfcElemProcessorMeshFlow.h"
+#include "IfcTrace.h"
+#include "IfcMemory.h"
+#include "IfcProfiler.h"
+#include "TaskScheduler.h"
+#include <algorithm>
 
 IfcElemProcessorMeshFlow::IfcElemProcessorMeshFlow(Callback_ObjectReady onObjectReady, Callback_ParseFinished onParseFinished)
     : m_func_onObjectReady(onObjectReady)
@@ -6,22 +11,135 @@ IfcElemProcessorMeshFlow::IfcElemProcessorMeshFlow(Callback_ObjectReady onObject
 {
 }
 
+IfcElemProcessorMeshFlow::IfcElemProcessorMeshFlow(Callback_ObjectsReady onObjectsReady, Callback_ParseFinished onParseFinished,
+                                                   size_t batchCount, int batchWindowMs)
+    : m_func_onObjectsReady(onObjectsReady)
+    , m_func_onParseFinished(onParseFinished)
+    , m_batchCount(std::max<size_t>(batchCount, 1))
+    , m_batchWindow(batchWindowMs)
+{
+}
+
+IfcElemProcessorMeshFlow::~IfcElemProcessorMeshFlow() {
+    //pending timed flushes must not reach the processor anymore
+    if(m_spBatching)
+    {
+        std::lock_guard<std::mutex> delivery(m_spBatching->deliveryMutex);
+        m_spBatching->finished = true;
+    }
+}
+
 void IfcElemProcessorMeshFlow::onStart() {
     m_lastGeometryId.clear();
-    if(m_spLastCreatedMeshes)
-        m_spLastCreatedMeshes->clear();
+    m_spLastCreatedMeshes = nullptr;
+    m_spBatch = nullptr;
+
+    //the processor no longer moves once the load started
+    m_spBatching = nullptr;
+    if(m_func_onObjectsReady)
+    {
+        m_spBatching = std::make_shared<Batching>();
+        m_spBatching->pFlow = this;
+    }
+}
+
+void IfcElemProcessorMeshFlow::onPassFinished() {
+    if(!m_spBatching)
+        return;
+    std::lock_guard<std::mutex> delivery(m_spBatching->deliveryMutex);
+    flushBatch();
 }
 
 void IfcElemProcessorMeshFlow::onFinish(bool success, const std::string& message) {
+    if(m_spBatching)
+    {
+        //waits for a timed flush being delivered, the later ones find the load finished
+        std::lock_guard<std::mutex> delivery(m_spBatching->deliveryMutex);
+        m_spBatching->finished = true;
+        flushBatch();
+    }
     m_func_onParseFinished(success, message);
 }
 
+std::shared_ptr<std::vector<SceneData::Object>> IfcElemProcessorMeshFlow::takeBatch(bool dueOnly) {
+    std::lock_guard<std::mutex> lock(m_spBatching->batchMutex);
+    if(!m_spBatch || m_spBatch->empty())
+        return nullptr;
+    if(dueOnly && std::chrono::steady_clock::now() - m_batchStart < m_batchWindow)
+        return nullptr;
+
+    // The batch is handed over, a new one is started with the next object
+    auto spBatch = std::move(m_spBatch);
+    m_spBatch = nullptr;
+    return spBatch;
+}
+
+void IfcElemProcessorMeshFlow::flushBatch() {
+    if(auto spBatch = takeBatch(false))
+        deliverBatch(std::move(spBatch));
+}
+
+void IfcElemProcessorMeshFlow::deliverBatch(std::shared_ptr<std::vector<SceneData::Object>> spBatch) {
+    IFC_PROFILE_SCOPE("Deliver batch", "geometry"); // includes waiting for a full stream
+    m_func_onObjectsReady(std::move(spBatch));
+}
+
+void IfcElemProcessorMeshFlow::flushDueBatch(const std::shared_ptr<Batching>& spBatching) {
+    //the batch this flush was armed for may be gone already, a later batch is only taken once due
+    std::lock_guard<std::mutex> delivery(spBatching->deliveryMutex);
+    if(spBatching->finished)
+        return;
+    auto* pFlow = spBatching->pFlow;
+    if(auto spBatch = pFlow->takeBatch(true))
+        pFlow->deliverBatch(std::move(spBatch));
+}
+
+void IfcElemProcessorMeshFlow::deliver(SceneData::Object&& object) {
+
+    if(m_func_onObjectReady)
+    {
+        m_func_onObjectReady(std::make_shared<SceneData::Object>(std::move(object)));
+        return;
+    }
+
+    std::shared_ptr<std::vector<SceneData::Object>> spFull;
+    bool newBatch = false;
+    {
+        std::lock_guard<std::mutex> lock(m_spBatching->batchMutex);
+        newBatch = !m_spBatch;
+        if(newBatch)
+        {
+            m_spBatch = std::make_shared<std::vector<SceneData::Object>>();
+            m_spBatch->reserve(m_batchCount);
+            m_batchStart = std::chrono::steady_clock::now();
+        }
+        m_spBatch->push_back(std::move(object));
+
+        if(m_spBatch->size() >= m_batchCount || std::chrono::steady_clock::now() - m_batchStart >= m_batchWindow)
+        {
+            spFull = std::move(m_spBatch);
+            m_spBatch = nullptr;
+        }
+    }
+
+    if(spFull)
+    {
+        std::lock_guard<std::mutex> delivery(m_spBatching->deliveryMutex);
+        deliverBatch(std::move(spFull));
+    }
+    else if(newBatch && m_batchWindow.count() > 0)
+    {
+        //flush the batch when its window elapses, even if the iterator is still busy with a slow element
+        TaskScheduler::instance().submitAfter(m_batchWindow, [spBatching = m_spBatching]() { flushDueBatch(spBatching); });
+    }
+}
+
 bool IfcElemProcessorMeshFlow::process(const IfcGeom::Element* pElement) {
 
     if(!pElement)
         return false;
 
-    std::string Prefix("[ProcessorMesh] ");
+    static const std::string Prefix("[ProcessorMesh] ");
     const auto* triElem = dynamic_cast<const IfcGeom::TriangulationElement*>(pElement);
     if(!triElem)
     {
@@ -29,18 +147,12 @@ bool IfcElemProcessorMeshFlow::process(const IfcGeom::Element* pElement) {
         return false;
     }
 
-    auto spCurrentObject = std::make_shared<SceneData::Object>();
+    SceneData::Object currentObject;
     //basic infos
-    spCurrentObject->name = triElem->name();
-    spCurrentObject->type = triElem->type();
-    spCurrentObject->geometryId = triElem->geometry().id();
-    spCurrentObject->guid = triElem->guid();
-
-    Logger::Notice(Prefix + "Iteratoring geom "
-                   + spCurrentObject->type
-                   + ":" + spCurrentObject->name
-                   + " geometryId :" + spCurrentObject->geometryId
-                   + " guid: " + spCurrentObject->guid );
+    currentObject.name = triElem->name();
+    currentObject.type = triElem->type();
+    currentObject.geometryId = triElem->geometry().id();
+    currentObject.guid = triElem->guid();
 
     //Transformation
     SceneData::Matrix4x4 matrix;
@@ -48,23 +160,20 @@ bool IfcElemProcessorMeshFlow::process(const IfcGeom::Element* pElement) {
     for (int row = 0; row < 4; row++)
         for (int col = 0; col < 4; col++)
             matrix.m[row * 4 + col] = transform4x4(row,col);
-    spCurrentObject->transform = std::move(matrix);
-
-    std::string m("----matrix----");
-    for(int i=0; i<16; ++i)
-        m+= std::to_string(matrix.m[i]) + ",";
-    m+="\n";
-    Logger::Notice(Prefix + m);
+    currentObject.transform = std::move(matrix);
 
+    //element and its translation, nothing is formatted here
+    IFC_TRACE(Debug, "mesh.element", currentObject.guid, {matrix.m[3], matrix.m[7], matrix.m[11]});
 
     // If it's the same geometry, reuse it
     const auto & curGeometryId = triElem->geometry().id();
     if(curGeometryId == m_lastGeometryId && m_spLastCreatedMeshes)
     {
-        Logger::Notice(Prefix + "same geometry ID, reuse last created meshes");
-        spCurrentObject->meshes = m_spLastCreatedMeshes;
+        IFC_TRACE(Debug, "mesh.instance", currentObject.guid);
+        IfcMemory::markInstanced(m_spLastCreatedMeshes);
+        currentObject.meshes = m_spLastCreatedMeshes;
 
-        m_func_onObjectReady(spCurrentObject);
+        deliver(std::move(currentObject));
         return true;
     }
 
@@ -106,30 +215,43 @@ bool IfcElemProcessorMeshFlow::process(const IfcGeom::Element* pElement) {
     }
 
     //Create mesh for each group of faces
-    std::shared_ptr<std::vector<SceneData::Mesh>> spCurrentMeshes = std::make_shared<std::vector<SceneData::Mesh>>();
+    std::vector<SceneData::Mesh> currentMeshes;
     for (const auto& group : groupedFaces)
     {
         int matId = group.first;
         const std::vector<int>& vertIndices = group.second;
         auto nVerts = vertIndices.size();
 
-        std::vector<SceneData::Vec3f> vertices, normals;
-        vertices.reserve(nVerts);
-        normals.reserve(nVerts);
-        for (int index : vertIndices)
+        SceneData::Mesh mesh;
+        if (m_vertexLayout == SceneData::VertexLayout::Packed)
         {
-            int coordIndex = 3 * index; // This is the start index of the coordinates
-            vertices.push_back(SceneData::Vec3f(coordsVertices[coordIndex],
-                                                coordsVertices[coordIndex + 1],
-                                                coordsVertices[coordIndex + 2]));
-            normals.push_back(SceneData::Vec3f(coordsNormals[coordIndex],
-                                               coordsNormals[coordIndex + 1],
-                                               coordsNormals[coordIndex + 2]));
+            mesh.packedVertices.reserve(nVerts);
+            for (int index : vertIndices)
+            {
+                int coordIndex = 3 * index; // This is the start index of the coordinates
+                mesh.packedVertices.push_back(SceneData::packVertex(
+                    SceneData::Vec3f(coordsVertices[coordIndex], coordsVertices[coordIndex + 1], coordsVertices[coordIndex + 2]),
+                    SceneData::Vec3f(coordsNormals[coordIndex], coordsNormals[coordIndex + 1], coordsNormals[coordIndex + 2])));
+            }
+        }
+        else
+        {
+            std::vector<SceneData::Vec3f> vertices, normals;
+            vertices.reserve(nVerts);
+            normals.reserve(nVerts);
+            for (int index : vertIndices)
+            {
+                int coordIndex = 3 * index; // This is the start index of the coordinates
+                vertices.push_back(SceneData::Vec3f(coordsVertices[coordIndex],
+                                                    coordsVertices[coordIndex + 1],
+                                                    coordsVertices[coordIndex + 2]));
+                normals.push_back(SceneData::Vec3f(coordsNormals[coordIndex],
+                                                   coordsNormals[coordIndex + 1],
+                                                   coordsNormals[coordIndex + 2]));
+            }
+            mesh.vertices = std::move(vertices);
+            mesh.normals = std::move(normals);
         }
-
-        SceneData::Mesh mesh;
-        mesh.vertices = std::move(vertices);
-        mesh.normals = std::move(normals);
 
         if (const auto& pMaterial = materials[matId])
         {
@@ -149,13 +271,16 @@ bool IfcElemProcessorMeshFlow::process(const IfcGeom::Element* pElement) {
             Logger::Warning("Warning: Null material style pointer for material ID :" + std::to_string(matId));
         }
 
-        spCurrentMeshes->push_back(std::move(mesh));
+        currentMeshes.push_back(std::move(mesh));
     }
 
+    // Counted in IfcMemory for as long as the meshes are referenced
+    auto spCurrentMeshes = IfcMemory::trackMeshes(std::move(currentMeshes));
+
     m_lastGeometryId = curGeometryId;
     m_spLastCreatedMeshes = spCurrentMeshes;
-    spCurrentObject->meshes = spCurrentMeshes;
+    currentObject.meshes = spCurrentMeshes;
 
-    m_func_onObjectReady(spCurrentObject);
+    deliver(std::move(currentObject));
     return true;
 }
@@ -1,6 +1,9 @@
 #ifndef IFCPROCESSOR_MESHFLOW_H
 #define IFCPROCESSOR_MESHFLOW_H
 
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include "IfcElemProcessorBase.h"
 #include "SceneData.h"
 
@@ -9,19 +12,58 @@ class IfcElemProcessorMeshFlow : public IfcElemProcessorBase
 public:
     // Define callback types
     using Callback_ObjectReady = std::function<void(std::shared_ptr<SceneData::Object> objectData)>;
+    using Callback_ObjectsReady = std::function<void(std::shared_ptr<std::vector<SceneData::Object>> objectsData)>;
     using Callback_ParseFinished = std::function<void(bool success, const std::string& message)>;
 
+    // Deliver each object as soon as it is ready
     IfcElemProcessorMeshFlow(Callback_ObjectReady onObjectReady, Callback_ParseFinished onParseFinished);
 
+    /**
+     * Deliver objects in batches, flushed when batchCount objects are ready or when the oldest one waited batchWindowMs,
+     * also while the iterator is busy with a slow element: a partial batch may then be delivered from a timed task
+     * of the TaskScheduler. Deliveries never overlap, the iterator keeps filling the next batch meanwhile.
+     */
+    IfcElemProcessorMeshFlow(Callback_ObjectsReady onObjectsReady, Callback_ParseFinished onParseFinished,
+                             size_t batchCount, int batchWindowMs);
+    IfcElemProcessorMeshFlow(IfcElemProcessorMeshFlow&&) = default;
+    ~IfcElemProcessorMeshFlow() override;
+
     bool process(const IfcGeom::Element* pElement) override;
     void onStart() override;
+    void onPassFinished() override;
     void onFinish(bool success, const std::string& message) override;
 
+    void setVertexLayout(SceneData::VertexLayout layout) { m_vertexLayout = layout; }
+
 private:
+    SceneData::VertexLayout m_vertexLayout = SceneData::VertexLayout::Separate;
 
     Callback_ObjectReady m_func_onObjectReady;
+    Callback_ObjectsReady m_func_onObjectsReady;
     Callback_ParseFinished m_func_onParseFinished;
 
+    size_t m_batchCount = 1;
+    std::chrono::milliseconds m_batchWindow{0};
+    std::chrono::steady_clock::time_point m_batchStart;
+    std::shared_ptr<std::vector<SceneData::Object>> m_spBatch = nullptr;
+
+    // Shared with the timed flushes of the load, which may run after the processor finished
+    struct Batching {
+        IfcElemProcessorMeshFlow* pFlow = nullptr;
+        std::mutex batchMutex;    // guards the batch being filled, never held while delivering
+        std::mutex deliveryMutex; // one delivery at a time, and none once finished
+        bool finished = false;    // guarded by deliveryMutex
+    };
+    std::shared_ptr<Batching> m_spBatching;
+
+    void deliver(SceneData::Object&& object);
+    // The batch being filled if any, only once its window elapsed if dueOnly
+    std::shared_ptr<std::vector<SceneData::Object>> takeBatch(bool dueOnly);
+    // Deliver the batch being filled, the delivery mutex held
+    void flushBatch();
+    void deliverBatch(std::shared_ptr<std::vector<SceneData::Object>> spBatch);
+    static void flushDueBatch(const std::shared_ptr<Batching>& spBatching);
+
     std::string m_lastGeometryId;
     std::shared_ptr<std::vector<SceneData::Mesh>> m_spLastCreatedMeshes = nullptr;
 };
@@ -0,0 +1,335 @@
+#include "IfcElemProcessorNetQuantity.h"
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const std::string Prefix("[ElemProcessorNetQuantity] ");
+
+    // Distance below which a point lies on a plane, in meters
+    constexpr double Tolerance = 1e-6;
+
+    // Faces of a convex solid beyond which clipping is not worth it, the Boolean subtraction is used instead
+    constexpr size_t MaxPlanes = 64;
+
+    using Point = std::array<double, 3>;
+    using Plane = std::array<double, 4>;
+
+    // Sums over clipped polygons: 6 x signed volume against the reference point, 2 x area and 2 x up/down projected areas
+    struct Integrals {
+        double volume6 = 0.0;
+        double area2 = 0.0;
+        double up2 = 0.0;
+        double down2 = 0.0;
+    };
+
+    inline double distance(const Plane& plane, const Point& p) {
+        return plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] - plane[3];
+    }
+
+    // Sutherland-Hodgman: keep the part of the polygon where distance <= offset for all planes
+    void clipPolygon(std::vector<Point>& polygon, std::vector<Point>& scratch, const std::vector<Plane>& planes, double offset) {
+        for (const auto& plane : planes)
+        {
+            scratch.clear();
+            const size_t n = polygon.size();
+            for (size_t i = 0; i < n; ++i)
+            {
+                const Point& current = polygon[i];
+                const Point& next = polygon[(i + 1) % n];
+                double dCurrent = distance(plane, current) - offset;
+                double dNext = distance(plane, next) - offset;
+                if (dCurrent <= 0.0)
+                    scratch.push_back(current);
+                if ((dCurrent <= 0.0) != (dNext <= 0.0))
+                {
+                    double t = dCurrent / (dCurrent - dNext);
+                    scratch.push_back({current[0] + t * (next[0] - current[0]),
+                                       current[1] + t * (next[1] - current[1]),
+                                       current[2] + t * (next[2] - current[2])});
+                }
+            }
+            polygon.swap(scratch);
+            if (polygon.size() < 3)
+                return;
+        }
+    }
+
+    void accumulate(const std::vector<Point>& polygon, const Point& reference, double orientation, Integrals& integrals) {
+        if (polygon.size() < 3)
+            return;
+
+        double nx = 0.0, ny = 0.0, nz = 0.0;
+        const Point& p0 = polygon[0];
+        const double ax = p0[0] - reference[0], ay = p0[1] - reference[1], az = p0[2] - reference[2];
+        for (size_t i = 1; i + 1 < polygon.size(); ++i)
+        {
+            const Point& p1 = polygon[i];
+            const Point& p2 = polygon[i + 1];
+            const double bx = p1[0] - reference[0], by = p1[1] - reference[1], bz = p1[2] - reference[2];
+            const double cx = p2[0] - reference[0], cy = p2[1] - reference[1], cz = p2[2] - reference[2];
+            integrals.volume6 += orientation * (ax * (by * cz - bz * cy) + ay * (bz * cx - bx * cz) + az * (bx * cy - by * cx));
+
+            const double ux = p1[0] - p0[0], uy = p1[1] - p0[1], uz = p1[2] - p0[2];
+            const double wx = p2[0] - p0[0], wy = p2[1] - p0[1], wz = p2[2] - p0[2];
+            nx += uy * wz - uz * wy;
+            ny += uz * wx - ux * wz;
+            nz += ux * wy - uy * wx;
+        }
+        nz *= orientation;
+        integrals.area2 += std::sqrt(nx * nx + ny * ny + nz * nz);
+        integrals.up2 += std::max(nz, 0.0);
+        integrals.down2 += std::max(-nz, 0.0);
+    }
+
+    // Boundary of a solid, clipped to the inside of a convex one
+    Integrals clipBoundary(const std::vector<double>& triangles, double orientation, const std::vector<Plane>& planes,
+                           double offset, const Point& reference) {
+        Integrals integrals;
+        std::vector<Point> polygon, scratch;
+        for (size_t t = 0; t + 8 < triangles.size(); t += 9)
+        {
+            polygon.assign({Point{triangles[t], triangles[t + 1], triangles[t + 2]},
+                            Point{triangles[t + 3], triangles[t + 4], triangles[t + 5]},
+                            Point{triangles[t + 6], triangles[t + 7], triangles[t + 8]}});
+            clipPolygon(polygon, scratch, planes, offset);
+            accumulate(polygon, reference, orientation, integrals);
+        }
+        return integrals;
+    }
+
+    bool boundsOverlap(const std::array<double, 6>& a, const std::array<double, 6>& b) {
+        for (int k = 0; k < 3; ++k)
+            if (a[k] > b[k + 3] + Tolerance || b[k] > a[k + 3] + Tolerance)
+                return false;
+        return true;
+    }
+}
+
+IfcElemProcessorNetQuantity::IfcElemProcessorNetQuantity(std::unordered_map<std::string, std::vector<std::string>> openingsByHost)
+    : m_openingsByHost(std::move(openingsByHost))
+{
+    for (const auto& [host, openings] : m_openingsByHost)
+    {
+        m_isHostByGuid[host] = true;
+        for (const auto& opening : openings)
+            m_isHostByGuid.emplace(opening, false);
+    }
+}
+
+void IfcElemProcessorNetQuantity::onStart() {
+    IfcElemProcessorQuantity::onStart();
+    m_solidsByGuid.clear();
+    m_booleanHosts.clear();
+}
+
+bool IfcElemProcessorNetQuantity::process(const IfcGeom::Element* pElement) {
+    if (!IfcElemProcessorQuantity::process(pElement))
+        return false;
+
+    //only hosts and openings are kept, the gross quantities of the others are final
+    const auto* triElem = static_cast<const IfcGeom::TriangulationElement*>(pElement);
+    if (!m_isHostByGuid.count(triElem->guid()))
+        return true;
+
+    std::array<double, 16> matrix;
+    const auto& transform4x4 = triElem->transformation().data()->components();
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+            matrix[row * 4 + col] = transform4x4(row, col);
+
+    const auto& spGeomTri = triElem->geometry_pointer();
+    m_solidsByGuid[triElem->guid()] = makeSolid(spGeomTri->verts(), spGeomTri->faces(), matrix);
+    return true;
+}
+
+void IfcElemProcessorNetQuantity::onFinish(bool success, const std::string& message) {
+    struct Job {
+        const std::string* pGuid;
+        const Solid* pHost;
+        std::vector<const Solid*> openings;
+        Quantities* pQuantities;
+        bool needsBoolean = false;
+    };
+
+    std::vector<Job> jobs;
+    for (const auto& [host, openings] : m_openingsByHost)
+    {
+        auto itHost = m_solidsByGuid.find(host);
+        auto itQuantities = m_quantitiesByGuid.find(host);
+        if (itHost == m_solidsByGuid.end() || itQuantities == m_quantitiesByGuid.end())
+            continue;
+
+        Job job{&host, &itHost->second, {}, &itQuantities->second};
+        for (const auto& opening : openings)
+        {
+            auto itOpening = m_solidsByGuid.find(opening);
+            if (itOpening != m_solidsByGuid.end())
+                job.openings.push_back(&itOpening->second);
+        }
+        if (!job.openings.empty())
+            jobs.push_back(std::move(job));
+    }
+
+    //hosts are independent, each job writes its own quantities
+    TaskScheduler::instance().parallelFor(0, jobs.size(), 16, [this, &jobs](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+        {
+            Quantities net = *jobs[i].pQuantities;
+            if (subtractOpenings(*jobs[i].pHost, jobs[i].openings, net))
+                *jobs[i].pQuantities = net;
+            else
+                jobs[i].needsBoolean = true;
+        }
+    });
+    for (const auto& job : jobs)
+        if (job.needsBoolean)
+            m_booleanHosts.push_back(*job.pGuid);
+
+    //openings are voids, not quantities
+    for (const auto& [guid, isHost] : m_isHostByGuid)
+        if (!isHost)
+            m_quantitiesByGuid.erase(guid);
+    m_solidsByGuid.clear();
+
+    Logger::Notice(Prefix + std::to_string(jobs.size() - m_booleanHosts.size()) + " hosts made net by clipping, "
+                   + std::to_string(m_booleanHosts.size()) + " need the Boolean subtraction");
+    IfcElemProcessorQuantity::onFinish(success, message);
+}
+
+IfcElemProcessorNetQuantity::Solid IfcElemProcessorNetQuantity::makeSolid(const std::vector<double>& coordsVertices,
+                                                                          const std::vector<int>& indicesFaces,
+                                                                          const std::array<double, 16>& m) {
+    Solid solid;
+    const size_t nVerts = coordsVertices.size() / 3;
+    if (!nVerts || indicesFaces.size() < 3)
+        return solid;
+
+    std::vector<double> world(3 * nVerts);
+    for (size_t i = 0; i < nVerts; ++i)
+    {
+        const double lx = coordsVertices[3 * i], ly = coordsVertices[3 * i + 1], lz = coordsVertices[3 * i + 2];
+        world[3 * i] = m[0] * lx + m[1] * ly + m[2] * lz + m[3];
+        world[3 * i + 1] = m[4] * lx + m[5] * ly + m[6] * lz + m[7];
+        world[3 * i + 2] = m[8] * lx + m[9] * ly + m[10] * lz + m[11];
+    }
+
+    solid.bounds = {world[0], world[1], world[2], world[0], world[1], world[2]};
+    for (size_t i = 1; i < nVerts; ++i)
+        for (int k = 0; k < 3; ++k)
+        {
+            solid.bounds[k] = std::min(solid.bounds[k], world[3 * i + k]);
+            solid.bounds[k + 3] = std::max(solid.bounds[k + 3], world[3 * i + k]);
+        }
+
+    solid.triangles.reserve(3 * indicesFaces.size());
+    for (size_t f = 0; f + 2 < indicesFaces.size(); f += 3)
+        for (int corner = 0; corner < 3; ++corner)
+            for (int k = 0; k < 3; ++k)
+                solid.triangles.push_back(world[3 * indicesFaces[f + corner] + k]);
+
+    const Point center{0.5 * (solid.bounds[0] + solid.bounds[3]), 0.5 * (solid.bounds[1] + solid.bounds[4]), 0.5 * (solid.bounds[2] + solid.bounds[5])};
+    Integrals integrals;
+    std::vector<Point> triangle(3);
+    for (size_t t = 0; t + 8 < solid.triangles.size(); t += 9)
+    {
+        for (int corner = 0; corner < 3; ++corner)
+            triangle[corner] = {solid.triangles[t + 3 * corner], solid.triangles[t + 3 * corner + 1], solid.triangles[t + 3 * corner + 2]};
+        accumulate(triangle, center, 1.0, integrals);
+    }
+    solid.orientation = integrals.volume6 < 0.0 ? -1.0 : 1.0;
+    solid.volume = std::abs(integrals.volume6) / 6.0;
+    solid.area = 0.5 * integrals.area2;
+    solid.downArea = 0.5 * (solid.orientation > 0.0 ? integrals.down2 : integrals.up2);
+
+    //face planes, oriented outwards; the solid is convex if no vertex lies outside of them
+    for (size_t t = 0; t + 8 < solid.triangles.size(); t += 9)
+    {
+        const double* p = &solid.triangles[t];
+        const double ux = p[3] - p[0], uy = p[4] - p[1], uz = p[5] - p[2];
+        const double wx = p[6] - p[0], wy = p[7] - p[1], wz = p[8] - p[2];
+        double nx = uy * wz - uz * wy, ny = uz * wx - ux * wz, nz = ux * wy - uy * wx;
+        const double length = std::sqrt(nx * nx + ny * ny + nz * nz);
+        if (length < Tolerance * Tolerance)
+            continue;
+        nx *= solid.orientation / length;
+        ny *= solid.orientation / length;
+        nz *= solid.orientation / length;
+        const Plane plane{nx, ny, nz, nx * p[0] + ny * p[1] + nz * p[2]};
+
+        bool known = std::any_of(solid.planes.begin(), solid.planes.end(), [&plane](const Plane& other) {
+            return std::abs(other[0] - plane[0]) < 1e-9 && std::abs(other[1] - plane[1]) < 1e-9
+                && std::abs(other[2] - plane[2]) < 1e-9 && std::abs(other[3] - plane[3]) < Tolerance;
+        });
+        if (known)
+            continue;
+        if (solid.planes.size() == MaxPlanes)
+        {
+            solid.planes.clear();
+            return solid;
+        }
+        solid.planes.push_back(plane);
+    }
+    for (const auto& plane : solid.planes)
+        for (size_t i = 0; i < nVerts; ++i)
+            if (distance(plane, {world[3 * i], world[3 * i + 1], world[3 * i + 2]}) > Tolerance)
+            {
+                solid.planes.clear();
+                return solid;
+            }
+    return solid;
+}
+
+bool IfcElemProcessorNetQuantity::subtractOpenings(const Solid& host, const std::vector<const Solid*>& openings, Quantities& quantities) const {
+    if (host.planes.empty())
+        return false;
+
+    const Point reference{0.5 * (host.bounds[0] + host.bounds[3]), 0.5 * (host.bounds[1] + host.bounds[4]), 0.5 * (host.bounds[2] + host.bounds[5])};
+    double volume = 0.0, removedArea = 0.0, revealArea = 0.0, removedUp = 0.0, revealUp = 0.0;
+
+    for (const Solid* pOpening : openings)
+    {
+        const Solid& opening = *pOpening;
+        if (!boundsOverlap(host.bounds, opening.bounds))
+            continue;
+
+        //fully inside: subtracted whole, no host face is touched
+        bool inside = true;
+        for (size_t t = 0; inside && t + 2 < opening.triangles.size(); t += 3)
+            for (const auto& plane : host.planes)
+                if (distance(plane, {opening.triangles[t], opening.triangles[t + 1], opening.triangles[t + 2]}) > -Tolerance)
+                {
+                    inside = false;
+                    break;
+                }
+        if (inside)
+        {
+            volume += opening.volume;
+            revealArea += opening.area;
+            revealUp += opening.downArea;
+            continue;
+        }
+
+        if (opening.planes.empty())
+            return false;
+
+        //faces on the boundary of both solids are counted once: kept on the opening side, dropped on the host side
+        Integrals openingInHost = clipBoundary(opening.triangles, opening.orientation, host.planes, Tolerance, reference);
+        Integrals hostInOpening = clipBoundary(host.triangles, host.orientation, opening.planes, -Tolerance, reference);
+        volume += (openingInHost.volume6 + hostInOpening.volume6) / 6.0;
+
+        //surfaces of the net shape: host faces flush with the opening are removed, opening faces on the host boundary are no reveal
+        Integrals removed = clipBoundary(host.triangles, host.orientation, opening.planes, Tolerance, reference);
+        Integrals reveal = clipBoundary(opening.triangles, opening.orientation, host.planes, -Tolerance, reference);
+        removedArea += 0.5 * removed.area2;
+        removedUp += 0.5 * removed.up2;
+        revealArea += 0.5 * reveal.area2;
+        revealUp += 0.5 * reveal.down2;
+    }
+
+    quantities.grossVolume = std::max(0.0, quantities.grossVolume - volume);
+    quantities.surfaceArea = std::max(0.0, quantities.surfaceArea - removedArea + revealArea);
+    quantities.footprintArea = std::max(0.0, quantities.footprintArea - removedUp + revealUp);
+    return true;
+}
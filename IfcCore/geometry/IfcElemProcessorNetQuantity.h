@@ -0,0 +1,60 @@
+#ifndef IFCELEMPROCESSORNETQUANTITY_H
+#define IFCELEMPROCESSORNETQUANTITY_H
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IfcElemProcessorQuantity.h"
+
+/*
+ * Net quantities of the elements voided by openings (IfcRelVoidsElement), without Boolean operations.
+ * The geometry is loaded with the opening subtractions disabled (IfcGeometryParser::Options::subtractOpenings),
+ * every element is measured gross, then each opening clipped against its host is subtracted from it:
+ * - volume: the volume of the intersection
+ * - surface area: the host faces inside the opening are removed, the opening faces inside the host are added as reveals
+ * - footprint area: the same, on the upward facing parts
+ * Disjoint openings are skipped and openings lying fully inside their host are subtracted whole, without clipping.
+ * Otherwise host and opening are clipped against each other, which is exact for convex shapes; hosts with a
+ * non convex shape or opening are left gross and listed by booleanHosts(), see IfcParser::createQuantityReport.
+ * Openings overlapping each other are subtracted twice. The hosts are processed in parallel in onFinish.
+ */
+class IfcElemProcessorNetQuantity : public IfcElemProcessorQuantity
+{
+public:
+    // Opening GUIDs by host GUID, see IfcParser::openingsByHost
+    explicit IfcElemProcessorNetQuantity(std::unordered_map<std::string, std::vector<std::string>> openingsByHost);
+
+    bool process(const IfcGeom::Element* pElement) override;
+    void onStart() override;
+    void onFinish(bool success, const std::string& message) override;
+
+    // Hosts still gross after onFinish, their net quantities need the Boolean subtraction of the openings
+    const std::vector<std::string>& booleanHosts() const { return m_booleanHosts; }
+
+private:
+    // World triangles of a host or an opening with what the clipping needs
+    struct Solid {
+        std::vector<double> triangles;              // 9 coordinates per triangle
+        std::array<double, 6> bounds{};             // min xyz, max xyz
+        std::vector<std::array<double, 4>> planes;  // outward normal and offset of the faces, empty if not convex
+        double orientation = 1.0;                   // -1 if the triangles wind inwards
+        double volume = 0.0;
+        double area = 0.0;
+        double downArea = 0.0;                      // downward facing area, projected on the XY plane
+    };
+
+    std::unordered_map<std::string, std::vector<std::string>> m_openingsByHost;
+    std::unordered_map<std::string, bool> m_isHostByGuid; // hosts and openings, whose triangles are kept
+    std::unordered_map<std::string, Solid> m_solidsByGuid;
+    std::vector<std::string> m_booleanHosts;
+
+    static Solid makeSolid(const std::vector<double>& coordsVertices, const std::vector<int>& indicesFaces,
+                           const std::array<double, 16>& rowMajorMatrix);
+
+    // Subtract the openings from the gross quantities, false if the host needs the Boolean subtraction
+    bool subtractOpenings(const Solid& host, const std::vector<const Solid*>& openings, Quantities& quantities) const;
+};
+
+#endif // IFCELEMPROCESSORNETQUANTITY_H
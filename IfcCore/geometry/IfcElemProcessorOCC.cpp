@@ -1,5 +1,155 @@
 #include "IfcElemProcessorOCC.h"
+#include "TaskScheduler.h"
+
+#include <cmath>
+
+#include <ifcgeom/kernels/opencascade/OpenCascadeConversionResult.h>
+
+#include <BRep_Builder.hxx>
+#include <BRepGProp.hxx>
+#include <BRepGProp_Face.hxx>
+#include <GProp_GProps.hxx>
+#include <Standard_Failure.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+#include <gp_Trsf.hxx>
+
+namespace {
+    const std::string Prefix("[ElemProcessorOCC] ");
+
+    // cos(45 degrees): steeper faces are sides
+    constexpr double HorizontalCos = 0.70710678118654752;
+
+    template<typename Matrix>
+    gp_Trsf toTrsf(const Matrix& m) {
+        gp_Trsf trsf;
+        trsf.SetValues(m(0, 0), m(0, 1), m(0, 2), m(0, 3),
+                       m(1, 0), m(1, 1), m(1, 2), m(1, 3),
+                       m(2, 0), m(2, 1), m(2, 2), m(2, 3));
+        return trsf;
+    }
+}
+
+IfcElemProcessorOCC::IfcElemProcessorOCC() = default;
+
+IfcElemProcessorOCC::~IfcElemProcessorOCC() {
+    //tasks refer to the processor
+    m_upTasks.reset();
+}
+
+void IfcElemProcessorOCC::onStart() {
+    m_upTasks = std::make_unique<TaskGroup>();
+    m_nFailures = 0;
+    m_quantitiesByGuid.clear();
+}
+
+void IfcElemProcessorOCC::onFinish(bool success, const std::string& message) {
+    if(m_upTasks)
+    {
+        m_upTasks->wait();
+        m_upTasks.reset();
+    }
+    Logger::Notice(Prefix + std::to_string(m_quantitiesByGuid.size()) + " elements measured, "
+                   + std::to_string(m_nFailures) + " failed");
+}
 
 bool IfcElemProcessorOCC::process(const IfcGeom::Element* pElement) {
+    const auto* brepElem = dynamic_cast<const IfcGeom::BRepElement*>(pElement);
+    if(!brepElem)
+    {
+        m_nFailures++;
+        Logger::Error(Prefix + "null or not B-rep element, see IfcGeometryParser::Output::BRep");
+        return false;
+    }
+    if(!m_upTasks)
+        onStart();
+
+    //the element is only valid until the iterator moves on: the shapes are taken by handle, in world coordinates
+    TopoDS_Compound compound;
+    BRep_Builder builder;
+    builder.MakeCompound(compound);
+    try {
+        gp_Trsf elementTrsf = toTrsf(brepElem->transformation().data()->components());
+        for(const auto& part : brepElem->geometry())
+        {
+            const auto* pShape = dynamic_cast<const IfcGeom::OpenCascadeShape*>(&*part.Shape());
+            if(!pShape)
+            {
+                m_nFailures++;
+                Logger::Error(Prefix + "not an OpenCASCADE shape: " + brepElem->guid());
+                return false;
+            }
+            const TopoDS_Shape& shape = *pShape;
+            gp_Trsf partTrsf = elementTrsf.Multiplied(toTrsf(part.Placement()->ccomponents()));
+            builder.Add(compound, shape.Moved(TopLoc_Location(partTrsf)));
+        }
+    }
+    catch(const Standard_Failure& e) {
+        m_nFailures++;
+        Logger::Error(Prefix + "invalid placement of " + brepElem->guid() + ": " + e.GetMessageString());
+        return false;
+    }
+
+    //throttle the iterator rather than piling up shapes, helping only with the measurements
+    m_upTasks->waitUntilPending(m_maxPending - 1);
+    m_upTasks->run([this, compound, guid = brepElem->guid(), ifcClass = brepElem->type(), name = brepElem->name()]() {
+        try {
+            Quantities quantities = measure(compound);
+            quantities.ifcClass = ifcClass;
+            quantities.name = name;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quantitiesByGuid[guid] = std::move(quantities);
+        }
+        catch(const Standard_Failure& e) {
+            m_nFailures++;
+            Logger::Error(Prefix + "failed to measure " + guid + ": " + e.GetMessageString());
+        }
+        catch(const std::exception& e) {
+            m_nFailures++;
+            Logger::Error(Prefix + "failed to measure " + guid + ": " + e.what());
+        }
+    });
     return true;
 }
+
+IfcElemProcessorOCC::Quantities IfcElemProcessorOCC::measure(const TopoDS_Shape& shape) {
+    Quantities quantities;
+
+    GProp_GProps volumeProps;
+    BRepGProp::VolumeProperties(shape, volumeProps);
+    //the sign follows the orientation of the shells
+    quantities.volume = std::abs(volumeProps.Mass());
+
+    for(TopExp_Explorer explorer(shape, TopAbs_FACE); explorer.More(); explorer.Next())
+    {
+        const TopoDS_Face& face = TopoDS::Face(explorer.Current());
+        GProp_GProps faceProps;
+        BRepGProp::SurfaceProperties(face, faceProps);
+        double area = faceProps.Mass();
+        quantities.surfaceArea += area;
+
+        //outward normal at the middle of the parameter range, exact for the planar faces
+        BRepGProp_Face propFace(face);
+        double u1, u2, v1, v2;
+        propFace.Bounds(u1, u2, v1, v2);
+        gp_Pnt point;
+        gp_Vec normal;
+        propFace.Normal(0.5 * (u1 + u2), 0.5 * (v1 + v2), point, normal);
+        double length = normal.Magnitude();
+        double nz = length > 0.0 ? normal.Z() / length : 0.0;
+
+        //projected on the XY plane like the mesh footprint, approximated by the middle normal on curved faces
+        if(nz > 0.0)
+            quantities.footprintArea += area * nz;
+
+        if(nz >= HorizontalCos)
+            quantities.topArea += area;
+        else if(nz <= -HorizontalCos)
+            quantities.bottomArea += area;
+        else
+            quantities.sideArea += area;
+    }
+    return quantities;
+}
@@ -1,12 +1,62 @@
 #ifndef IFCPROCESSOR_OCC_H
 #define IFCPROCESSOR_OCC_H
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 #include "IfcElemProcessorBase.h"
 
+class TaskGroup;
+class TopoDS_Shape;
+
+/*
+ * Exact quantities from the OpenCASCADE B-rep of each element, keyed by GUID.
+ * Needs the iterator to output the native shapes, see IfcGeometryParser::Output::BRep.
+ * The element shapes are handed to the TaskScheduler, the iterator keeps producing while
+ * BRepGProp integrates the previous elements. Faces are split by the slope of their normal:
+ * top and bottom within 45 degrees of the vertical, sides otherwise.
+ */
 class IfcElemProcessorOCC : public IfcElemProcessorBase
 {
 public:
+    struct Quantities {
+        std::string ifcClass;
+        std::string name;
+        double volume = 0.0;
+        double surfaceArea = 0.0;
+        double topArea = 0.0;
+        double bottomArea = 0.0;
+        double sideArea = 0.0;
+        double footprintArea = 0.0; // up-facing faces projected on the XY plane
+    };
+
+    IfcElemProcessorOCC();
+    ~IfcElemProcessorOCC() override;
+
     bool process(const IfcGeom::Element* pElement) override;
+    void onStart() override;
+    void onFinish(bool success, const std::string& message) override;
+
+    // Elements waiting for or under computation, the iterator helps with them once reached
+    void setMaxPendingElements(int maxPending) { m_maxPending = maxPending > 0 ? maxPending : 1; }
+
+    // Complete once onFinish was called
+    inline const std::unordered_map<std::string, Quantities>& quantitiesByGuid() const { return m_quantitiesByGuid; }
+    int failureCount() const { return m_nFailures; }
+
+    // Volume, areas by orientation and footprint, in the units of the shape
+    static Quantities measure(const TopoDS_Shape& shape);
+
+private:
+    std::unique_ptr<TaskGroup> m_upTasks;
+    int m_maxPending = 256;
+    std::atomic<int> m_nFailures{0};
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Quantities> m_quantitiesByGuid;
 };
 
 #endif // IFCPROCESSOR_OCC_H
@@ -0,0 +1,35 @@
+#include "IfcElemProcessorStats.h"
+
+void IfcElemProcessorStats::onStart() {
+    m_statsByClass.clear();
+    m_start = m_last = std::chrono::steady_clock::now();
+    m_totalMs = 0.0;
+}
+
+void IfcElemProcessorStats::onFinish(bool success, const std::string& message) {
+    m_totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+bool IfcElemProcessorStats::process(const IfcGeom::Element* pElement) {
+
+    auto now = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - m_last).count();
+    m_last = now;
+
+    if(!pElement)
+        return false;
+
+    auto& stats = m_statsByClass[pElement->type()];
+    stats.ms += ms;
+
+    const auto* triElem = dynamic_cast<const IfcGeom::TriangulationElement*>(pElement);
+    if(!triElem || triElem->geometry().faces().empty())
+    {
+        stats.nFailures++;
+        return false;
+    }
+
+    stats.nElements++;
+    stats.nTriangles += triElem->geometry().faces().size() / 3;
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef IFCELEMPROCESSORSTATS_H
+#define IFCELEMPROCESSORSTATS_H
+
+#include <chrono>
+#include <map>
+#include "IfcElemProcessorBase.h"
+
+/*
+ * Collects per IFC class statistics of the tessellation, without keeping any geometry.
+ * The time of an element is the time elapsed since the previous one was handed over,
+ * ie. the time the iterator took to deliver it.
+ */
+class IfcElemProcessorStats : public IfcElemProcessorBase
+{
+public:
+    struct ClassStats {
+        int nElements = 0;
+        int nFailures = 0;
+        size_t nTriangles = 0;
+        double ms = 0.0;
+    };
+
+    bool process(const IfcGeom::Element* pElement) override;
+    void onStart() override;
+    void onFinish(bool success, const std::string& message) override;
+
+    inline const std::map<std::string, ClassStats>& statsByClass() const { return m_statsByClass; }
+    inline std::map<std::string, ClassStats>& statsByClass() { return m_statsByClass; }
+    inline double totalMs() const { return m_totalMs; }
+
+private:
+    std::map<std::string, ClassStats> m_statsByClass;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_last;
+    double m_totalMs = 0.0;
+};
+
+#endif // IFCELEMPROCESSORSTATS_H
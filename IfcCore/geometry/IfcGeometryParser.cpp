@@ -1,8 +1,55 @@
 #include "IfcGeometryParser.h"
-#include <thread>
+#include <cstdio>
+#include <memory>
+#include <unordered_set>
 #include <ifcgeom/Iterator.h>
 
-void IfcGeometryParser::parse(IfcParse::IfcFile& ifcFile, IfcElemProcessorBase& elemProcessor) {
+#include "IfcElemPriority.h"
+#include "IfcLoadProgress.h"
+#include "TaskScheduler.h"
+#include "IfcProfiler.h"
+#include "IfcTrace.h"
+
+namespace {
+    using ProductIds = std::unordered_set<unsigned>; // instance ids
+
+    // Products with a representation accepted by all the filters, split in windows of windowSize products
+    std::vector<std::shared_ptr<const ProductIds>> productWindows(IfcParse::IfcFile& ifcFile,
+                                                                  const std::vector<IfcGeom::filter_t>& filters, size_t windowSize)
+    {
+        std::vector<std::shared_ptr<const ProductIds>> windows;
+        auto products = ifcFile.instances_by_type("IfcProduct");
+        if(!products)
+            return windows;
+
+        std::shared_ptr<ProductIds> spWindow;
+        for(auto pInstance : *products)
+        {
+            auto pProduct = pInstance->as<IfcUtil::IfcBaseEntity>();
+            if(!pProduct || pProduct->get("Representation").isNull())
+                continue;
+
+            bool accepted = true;
+            for(const auto& filter : filters)
+                accepted = accepted && filter(pProduct);
+            if(!accepted)
+                continue;
+
+            if(!spWindow || spWindow->size() == windowSize)
+            {
+                spWindow = std::make_shared<ProductIds>();
+                spWindow->reserve(windowSize);
+                windows.push_back(spWindow);
+            }
+            spWindow->insert(pProduct->id());
+        }
+        return windows;
+    }
+}
+
+IfcGeometryParser::IfcGeometryParser(const Options& options): m_options(options) {}
+
+bool IfcGeometryParser::parse(IfcParse::IfcFile& ifcFile, IfcElemProcessorBase& elemProcessor) {
     std::string Prefix("[IfcGeometryParser] ");
     //Logger::SetOutput(&std::cout, &std::cerr);
     Logger::Notice(Prefix + "parseGeometry begins");
@@ -10,36 +57,159 @@ void IfcGeometryParser::parse(IfcParse::IfcFile& ifcFile, IfcElemProcessorBase&
     if(!ifcFile.good())
     {
         Logger::Error(Prefix + "Failed to parse ifc file");
-        return;
+        return false;
+    }
+
+    IFC_PROFILE_SCOPE("Geometry parse", "geometry");
+
+    int nTotal = 0, nSuccess = 0;
+    IfcLoadProgress progress;
+    progress.start();
+
+    elemProcessor.onStart();
+
+    auto cancelled = [this]() { return m_options.isCancelled && m_options.isCancelled(); };
+
+    bool kernelAvailable = true;
+    if(m_options.order == Order::Priority)
+    {
+        //one iterator per priority tier, so that each tier is completely delivered before the next one starts
+        for(int tier = 0; tier < IfcElemPriority::TierCount && kernelAvailable && !cancelled(); ++tier)
+        {
+            std::vector<IfcGeom::filter_t> filters = m_options.filters;
+            filters.push_back([tier](IfcUtil::IfcBaseEntity* pProduct) { return IfcElemPriority::tier(pProduct) == tier; });
+            kernelAvailable = iterate(ifcFile, elemProcessor, filters, progress, nTotal, nSuccess);
+            elemProcessor.onPassFinished();
+        }
+    }
+    else
+        kernelAvailable = iterate(ifcFile, elemProcessor, m_options.filters, progress, nTotal, nSuccess);
+
+    //no volume is sampled from BRep output or empty meshes
+    char sTiming[128];
+    const double msUntilVolume = progress.msUntilVolumeFraction(0.9);
+    if(msUntilVolume < 0.0)
+        std::snprintf(sTiming, sizeof(sTiming), " in %.0f ms", progress.elapsedMs());
+    else
+        std::snprintf(sTiming, sizeof(sTiming), " in %.0f ms, 90%% of visible volume after %.0f ms",
+                      progress.elapsedMs(), msUntilVolume);
+    std::string sProfile = IfcProfiler::isEnabled() ? "; " + IfcProfiler::summary() : std::string();
+
+    if(!kernelAvailable)
+        elemProcessor.onFinish(false, "Geometry kernel " + m_options.kernel + " not available");
+    else if(cancelled())
+        elemProcessor.onFinish(false, "Geometry loading cancelled");
+    else if(!nSuccess)
+        elemProcessor.onFinish(false, "No geometry loaded");
+    else
+        elemProcessor.onFinish(true, std::to_string(nSuccess) + "/" + std::to_string(nTotal) + " geometry loaded" + sTiming + sProfile);
+
+    return kernelAvailable;
+}
+
+bool IfcGeometryParser::iterate(IfcParse::IfcFile& ifcFile, IfcElemProcessorBase& elemProcessor,
+                                const std::vector<IfcGeom::filter_t>& filters,
+                                IfcLoadProgress& progress, int& nTotal, int& nSuccess)
+{
+    if(!m_options.windowSize)
+        return iterateOnce(ifcFile, elemProcessor, filters, progress, nTotal, nSuccess);
+
+    //the filters were applied to the windows, the iterator of a window is created once the previous one is processed
+    std::vector<std::shared_ptr<const ProductIds>> windows;
+    {
+        IFC_PROFILE_SCOPE("Product windows", "geometry");
+        windows = productWindows(ifcFile, filters, m_options.windowSize);
+    }
+    for(const auto& spWindow : windows)
+    {
+        if(m_options.isCancelled && m_options.isCancelled())
+            break;
+        std::vector<IfcGeom::filter_t> windowFilters{[spWindow](IfcUtil::IfcBaseEntity* pProduct) { return spWindow->count(pProduct->id()) > 0; }};
+        if(!iterateOnce(ifcFile, elemProcessor, windowFilters, progress, nTotal, nSuccess))
+            return false;
     }
+    return true;
+}
+
+bool IfcGeometryParser::iterateOnce(IfcParse::IfcFile& ifcFile, IfcElemProcessorBase& elemProcessor,
+                                    const std::vector<IfcGeom::filter_t>& filters,
+                                    IfcLoadProgress& progress, int& nTotal, int& nSuccess)
+{
+    std::string Prefix("[IfcGeometryParser] ");
 
     ifcopenshell::geometry::Settings settings;
     settings.set("use-world-coords", false);
     settings.set("weld-vertices", false);
     settings.set("apply-default-materials", true);
+    settings.set("disable-opening-subtractions", !m_options.subtractOpenings);
+    if(m_options.output == Output::BRep)
+        settings.get<ifcopenshell::geometry::settings::IteratorOutput>().value = ifcopenshell::geometry::settings::NATIVE;
+    if(m_options.linearDeflection)
+        settings.set("mesher-linear-deflection", *m_options.linearDeflection);
+    if(m_options.angularDeflection)
+        settings.set("mesher-angular-deflection", *m_options.angularDeflection);
 
-    int num_thread = std::thread::hardware_concurrency();
+    //the iterator runs its own threads, keep them within the IfcCore budget
+    int num_thread = m_options.numThreads > 0 ? m_options.numThreads : TaskScheduler::instance().workerCount();
     Logger::Notice(Prefix + "num_thread:" + std::to_string(num_thread));
 
-    IfcGeom::Iterator it = IfcGeom::Iterator("opencascade", settings, &ifcFile, num_thread);
-    if(!it.initialize())
-    {
-        Logger::Error(Prefix + "Failed to initialize geometry iterator");
-        return;
+    //the kernel may not be built into IfcOpenShell
+    std::unique_ptr<IfcGeom::Iterator> upIterator;
+    try {
+        upIterator = std::make_unique<IfcGeom::Iterator>(m_options.kernel, settings, &ifcFile, filters, num_thread);
+    }
+    catch(const std::exception& e) {
+        Logger::Error(Prefix + "Failed to create geometry kernel " + m_options.kernel + ": " + e.what());
+        return false;
     }
 
-    int nTotal = 0, nSuccess = 0;
+    auto& it = *upIterator;
+    bool initialized;
+    {
+        IFC_PROFILE_SCOPE("Iterator initialize", "geometry");
+        initialized = it.initialize();
+    }
+    if(!initialized)
+    {
+        //with filters, an empty selection is not an error
+        if(filters.empty())
+            Logger::Error(Prefix + "Failed to initialize geometry iterator");
+        else
+            Logger::Notice(Prefix + "No geometry selected by filters");
+        return true;
+    }
 
-    elemProcessor.onStart();
+    //the span covers the interval between two handovers of the iterator, it includes more than the tessellation
+    const bool profiling = IfcProfiler::isEnabled();
+    uint64_t handedOverNs = profiling ? IfcTrace::nowNs() : 0;
     do {
+        if(m_options.isCancelled && m_options.isCancelled())
+            break;
+
         nTotal++;
-        if(elemProcessor.process(it.get()))
-            nSuccess++;
+        const IfcGeom::Element* pElement = it.get();
+        if(profiling && pElement)
+        {
+            uint64_t nowNs = IfcTrace::nowNs();
+            const auto* triElem = dynamic_cast<const IfcGeom::TriangulationElement*>(pElement);
+            size_t nTriangles = triElem ? triElem->geometry().faces().size() / 3 : 0;
+            IfcProfiler::addSpan("Handover interval", "geometry", pElement->type(), handedOverNs, nowNs);
+            IfcProfiler::addElement(pElement->type(), (nowNs - handedOverNs) * 1e-6, nTriangles);
+        }
+
+        {
+            static const std::string NoType;
+            IFC_PROFILE_SCOPE("Process", "geometry", pElement ? pElement->type() : NoType);
+            if(elemProcessor.process(pElement))
+            {
+                nSuccess++;
+                progress.record(pElement);
+            }
+        }
+        if(profiling)
+            handedOverNs = IfcTrace::nowNs();
 
     } while (it.next());
 
-    if(!nSuccess)
-        elemProcessor.onFinish(false, "No geometry loaded");
-    else
-        elemProcessor.onFinish(true, std::to_string(nSuccess) + "/" + std::to_string(nTotal) + " geometry loaded");
+    return true;
 }
@@ -1,13 +1,75 @@
 #ifndef IFCGEOMETRYPARSER_H
 #define IFCGEOMETRYPARSER_H
 
+#include <functional>
+#include <optional>
+#include <string>
 #include <ifcparse/IfcFile.h>
+#include <ifcgeom/IfcGeomFilter.h>
 #include "IfcElemProcessorBase.h"
 
+class IfcLoadProgress;
+
 class IfcGeometryParser
 {
 public:
-    void parse(IfcParse::IfcFile& ifcFile, IfcElemProcessorBase& elemProcessor);
+    // Order in which the elements are handed to the processor
+    enum class Order {
+        Iterator,   // as produced by the geometry iterator
+        Priority    // building envelope and structure first, see IfcElemPriority
+    };
+
+    // Geometry handed to the processor
+    enum class Output {
+        Triangulation,  // IfcGeom::TriangulationElement
+        BRep            // IfcGeom::BRepElement with the native kernel shapes, eg. for IfcElemProcessorOCC
+    };
+
+    struct Options {
+        Order order = Order::Iterator;
+        Output output = Output::Triangulation;
+        std::vector<IfcGeom::filter_t> filters; // a product is loaded only if accepted by all filters
+
+        // Tessellation quality of curved geometry, unset values keep the IfcOpenShell defaults
+        std::optional<double> linearDeflection;
+        std::optional<double> angularDeflection; // radians
+
+        // IfcOpenShell geometry kernel, eg. "opencascade", "cgal", "hybrid-cgal-simple-opencascade"
+        std::string kernel = "opencascade";
+
+        // Boolean subtraction of the openings from their host elements, see IfcElemProcessorNetQuantity otherwise
+        bool subtractOpenings = true;
+
+        // Geometry iterator threads, 0 to follow the worker budget of the TaskScheduler
+        int numThreads = 0;
+
+        // Products per geometry iterator, 0 for one iterator over all of them. The iterator threads tessellate
+        // the whole selection of an iterator whether process() keeps up or not, windows bound what they get ahead
+        // of a processor which blocks, eg. on a full IfcGeometryStream. Each window initializes its own iterator
+        size_t windowSize = 0;
+
+        // Polled between elements, the load stops early once it returns true
+        std::function<bool()> isCancelled;
+    };
+
+    IfcGeometryParser() = default;
+    explicit IfcGeometryParser(const Options& options);
+
+    // Return false if the file or the geometry kernel is not usable
+    bool parse(IfcParse::IfcFile& ifcFile, IfcElemProcessorBase& elemProcessor);
+
+private:
+    Options m_options;
+
+    // Run the geometry iterators over the products accepted by the filters, one per window of products,
+    // return false if the kernel is not available
+    bool iterate(IfcParse::IfcFile& ifcFile, IfcElemProcessorBase& elemProcessor,
+                 const std::vector<IfcGeom::filter_t>& filters,
+                 IfcLoadProgress& progress, int& nTotal, int& nSuccess);
+    // Run one geometry iterator
+    bool iterateOnce(IfcParse::IfcFile& ifcFile, IfcElemProcessorBase& elemProcessor,
+                     const std::vector<IfcGeom::filter_t>& filters,
+                     IfcLoadProgress& progress, int& nTotal, int& nSuccess);
 };
 
 #endif
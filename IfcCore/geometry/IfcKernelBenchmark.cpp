@@ -0,0 +1,168 @@
+#include "IfcKernelBenchmark.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <sstream>
+
+namespace {
+    std::string lowerCase(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+        return text;
+    }
+
+    // Context types the geometry iterator tessellates, a sub-context has the type of its parent
+    bool isModelContext(IfcUtil::IfcBaseClass* pContext)
+    {
+        for(auto pEntity = pContext ? pContext->as<IfcUtil::IfcBaseEntity>() : nullptr; pEntity; )
+        {
+            auto contextType = pEntity->get("ContextType");
+            if(!contextType.isNull())
+            {
+                std::string sType = contextType;
+                auto type = lowerCase(sType);
+                return type == "model" || type == "design" || type == "model view" || type == "detail view";
+            }
+            if(!pEntity->declaration().is("IfcGeometricRepresentationSubContext"))
+                return false;
+            IfcUtil::IfcBaseClass* pParent = pEntity->get("ParentContext");
+            pEntity = pParent ? pParent->as<IfcUtil::IfcBaseEntity>() : nullptr;
+        }
+        return false;
+    }
+
+    // Body geometry in a 3D model context, the products whose axis, footprint or annotation
+    // representations are all they have are not delivered by the iterator
+    bool hasBodyRepresentation(IfcUtil::IfcBaseEntity* pProduct)
+    {
+        auto representation = pProduct->get("Representation");
+        if(representation.isNull())
+            return false;
+        IfcUtil::IfcBaseClass* pRepresentation = representation;
+        auto pProductShape = pRepresentation->as<IfcUtil::IfcBaseEntity>();
+        if(!pProductShape)
+            return false;
+
+        aggregate_of_instance::ptr shapes = pProductShape->get("Representations");
+        if(!shapes)
+            return false;
+        for(auto pInstance : *shapes)
+        {
+            auto pShape = pInstance->as<IfcUtil::IfcBaseEntity>();
+            if(!pShape)
+                continue;
+            auto identifier = pShape->get("RepresentationIdentifier");
+            if(!identifier.isNull())
+            {
+                std::string sIdentifier = identifier;
+                auto id = lowerCase(sIdentifier);
+                if(id != "body" && id != "facetation")
+                    continue;
+            }
+            if(isModelContext(pShape->get("ContextOfItems")))
+                return true;
+        }
+        return false;
+    }
+}
+
+std::vector<std::string> IfcKernelBenchmark::knownKernels()
+{
+    return {"opencascade", "cgal", "cgal-simple", "hybrid-cgal-simple-opencascade"};
+}
+
+std::map<std::string, int> IfcKernelBenchmark::expectedProductsByClass(IfcParse::IfcFile& ifcFile, const IfcGeometryParser::Options& options)
+{
+    std::map<std::string, int> expected;
+
+    auto products = ifcFile.instances_by_type("IfcProduct");
+    if(!products)
+        return expected;
+
+    for(auto pInstance : *products)
+    {
+        auto pProduct = pInstance->as<IfcUtil::IfcBaseEntity>();
+        if(!pProduct || !hasBodyRepresentation(pProduct))
+            continue;
+
+        bool accepted = true;
+        for(const auto& filter : options.filters)
+            accepted = accepted && filter(pProduct);
+
+        if(accepted)
+            expected[pProduct->declaration().name()]++;
+    }
+    return expected;
+}
+
+std::vector<IfcKernelBenchmark::Result> IfcKernelBenchmark::run(IfcParse::IfcFile& ifcFile, const IfcGeometryParser::Options& options, const std::vector<std::string>& kernels)
+{
+    std::string Prefix("[IfcKernelBenchmark] ");
+    auto expected = expectedProductsByClass(ifcFile, options);
+
+    std::vector<Result> results;
+    for(const auto& kernel : kernels)
+    {
+        Logger::Notice(Prefix + "kernel " + kernel);
+
+        auto kernelOptions = options;
+        kernelOptions.kernel = kernel;
+
+        IfcElemProcessorStats elemProcessor;
+        Result result;
+        result.kernel = kernel;
+        result.available = IfcGeometryParser(kernelOptions).parse(ifcFile, elemProcessor);
+        result.totalMs = elemProcessor.totalMs();
+        result.statsByClass = elemProcessor.statsByClass();
+
+        //products the iterator did not deliver are failures too
+        if(result.available)
+            for(const auto& [ifcClass, nExpected] : expected)
+            {
+                auto& stats = result.statsByClass[ifcClass];
+                int nMissing = nExpected - stats.nElements - stats.nFailures;
+                if(nMissing > 0)
+                    stats.nFailures += nMissing;
+            }
+
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+std::string IfcKernelBenchmark::toString(const std::vector<Result>& results)
+{
+    std::ostringstream out;
+    char line[256];
+
+    for(const auto& result : results)
+    {
+        if(!result.available)
+        {
+            out << result.kernel << ": not available\n";
+            continue;
+        }
+
+        int nElements = 0, nFailures = 0;
+        size_t nTriangles = 0;
+        for(const auto& [ifcClass, stats] : result.statsByClass)
+        {
+            nElements += stats.nElements;
+            nFailures += stats.nFailures;
+            nTriangles += stats.nTriangles;
+        }
+
+        std::snprintf(line, sizeof(line), "%s: %.0f ms, %d elements, %zu triangles, %d failures\n",
+                      result.kernel.c_str(), result.totalMs, nElements, nTriangles, nFailures);
+        out << line;
+
+        for(const auto& [ifcClass, stats] : result.statsByClass)
+        {
+            std::snprintf(line, sizeof(line), "    %-32s %10.1f ms %8d elements %12zu triangles %6d failures\n",
+                          ifcClass.c_str(), stats.ms, stats.nElements, stats.nTriangles, stats.nFailures);
+            out << line;
+        }
+    }
+    return out.str();
+}
@@ -0,0 +1,37 @@
+#ifndef IFCKERNELBENCHMARK_H
+#define IFCKERNELBENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <ifcparse/IfcFile.h>
+
+#include "IfcGeometryParser.h"
+#include "IfcElemProcessorStats.h"
+
+/*
+ * Tessellates the same file with several geometry kernels and compares
+ * time, triangle count and failure count per IFC class.
+ */
+class IfcKernelBenchmark
+{
+public:
+    struct Result {
+        std::string kernel;
+        bool available = false;
+        double totalMs = 0.0;
+        std::map<std::string, IfcElemProcessorStats::ClassStats> statsByClass;
+    };
+
+    // Kernels which IfcOpenShell may be built with
+    static std::vector<std::string> knownKernels();
+
+    std::vector<Result> run(IfcParse::IfcFile& ifcFile, const IfcGeometryParser::Options& options, const std::vector<std::string>& kernels);
+
+    static std::string toString(const std::vector<Result>& results);
+
+private:
+    // Number of products per class with a body representation the iterator tessellates, to count the elements the kernel failed on
+    static std::map<std::string, int> expectedProductsByClass(IfcParse::IfcFile& ifcFile, const IfcGeometryParser::Options& options);
+};
+
+#endif // IFCKERNELBENCHMARK_H
@@ -0,0 +1,83 @@
+#include "IfcLoadProgress.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "IfcElemPriority.h"
+
+void IfcLoadProgress::start()
+{
+    m_start = std::chrono::steady_clock::now();
+    m_samples.clear();
+    m_totalVolume = 0.0;
+}
+
+double IfcLoadProgress::elapsedMs() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void IfcLoadProgress::record(const IfcGeom::Element* pElement)
+{
+    const auto* triElem = dynamic_cast<const IfcGeom::TriangulationElement*>(pElement);
+    if(!triElem || IfcElemPriority::isHiddenByDefault(triElem->type()))
+        return;
+
+    const std::vector<double>& coords = triElem->geometry().verts();
+    if(coords.size() < 3)
+        return;
+
+    //local bounding box
+    double lo[3], hi[3];
+    std::fill(lo, lo + 3, std::numeric_limits<double>::max());
+    std::fill(hi, hi + 3, std::numeric_limits<double>::lowest());
+    for(size_t i = 0; i + 2 < coords.size(); i += 3)
+        for(int k = 0; k < 3; ++k)
+        {
+            lo[k] = std::min(lo[k], coords[i + k]);
+            hi[k] = std::max(hi[k], coords[i + k]);
+        }
+
+    //world bounding box of the 8 transformed corners
+    const auto& transform4x4 = triElem->transformation().data()->components();
+    double wlo[3], whi[3];
+    std::fill(wlo, wlo + 3, std::numeric_limits<double>::max());
+    std::fill(whi, whi + 3, std::numeric_limits<double>::lowest());
+    for(int corner = 0; corner < 8; ++corner)
+    {
+        const double p[3] = {
+            (corner & 1) ? hi[0] : lo[0],
+            (corner & 2) ? hi[1] : lo[1],
+            (corner & 4) ? hi[2] : lo[2]
+        };
+        for(int row = 0; row < 3; ++row)
+        {
+            double w = transform4x4(row, 3);
+            for(int col = 0; col < 3; ++col)
+                w += transform4x4(row, col) * p[col];
+            wlo[row] = std::min(wlo[row], w);
+            whi[row] = std::max(whi[row], w);
+        }
+    }
+
+    double volume = (whi[0] - wlo[0]) * (whi[1] - wlo[1]) * (whi[2] - wlo[2]);
+    m_samples.push_back({elapsedMs(), volume});
+    m_totalVolume += volume;
+}
+
+double IfcLoadProgress::msUntilVolumeFraction(double fraction) const
+{
+    if(m_samples.empty())
+        return -1.0;
+
+    //samples are recorded in time order
+    const double target = fraction * m_totalVolume;
+    double accumulated = 0.0;
+    for(const auto& sample : m_samples)
+    {
+        accumulated += sample.volume;
+        if(accumulated >= target)
+            return sample.ms;
+    }
+    return m_samples.back().ms;
+}
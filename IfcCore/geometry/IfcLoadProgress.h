@@ -0,0 +1,35 @@
+#ifndef IFCLOADPROGRESS_H
+#define IFCLOADPROGRESS_H
+
+#include <chrono>
+#include <vector>
+#include <ifcgeom/IfcGeomElement.h>
+
+/*
+ * Records when each element became available and its visible volume
+ * (world bounding box volume), to measure how fast a progressive load
+ * reaches a recognizable model.
+ */
+class IfcLoadProgress
+{
+public:
+    void start();
+    void record(const IfcGeom::Element* pElement);
+
+    double elapsedMs() const;
+
+    // Time in ms at which the given fraction of the total visible volume was loaded, -1 if nothing was recorded
+    double msUntilVolumeFraction(double fraction) const;
+
+private:
+    struct Sample {
+        double ms;
+        double volume;
+    };
+
+    std::chrono::steady_clock::time_point m_start;
+    std::vector<Sample> m_samples;
+    double m_totalVolume = 0.0;
+};
+
+#endif // IFCLOADPROGRESS_H
@@ -6,10 +6,32 @@ set(
     ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorMesh.cpp
     ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorMeshFlow.h
     ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorMeshFlow.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorGltf.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorGltf.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorQuantity.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorQuantity.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorNetQuantity.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorNetQuantity.cpp
     ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorOCC.h
     ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorOCC.cpp
     ${CMAKE_CURRENT_LIST_DIR}/IfcGeometryParser.h
     ${CMAKE_CURRENT_LIST_DIR}/IfcGeometryParser.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemPriority.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemPriority.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcLoadProgress.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcLoadProgress.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemCurvature.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemCurvature.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorStats.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorStats.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcKernelBenchmark.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcKernelBenchmark.cpp
+)
+
+# sqrt may set errno otherwise, which keeps the per triangle loop of the quantities from vectorizing
+set_source_files_properties(
+    ${CMAKE_CURRENT_LIST_DIR}/IfcElemProcessorQuantity.cpp
+    PROPERTIES COMPILE_OPTIONS "$<$<NOT:$<CXX_COMPILER_ID:MSVC>>:-fno-math-errno>"
 )
 
 source_group(geometry FILES ${GEOMETRY_SOURCES})
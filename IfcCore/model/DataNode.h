@@ -1,6 +1,7 @@
 #ifndef DATANODE_H
 #define DATANODE_H
 
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <boost/optional/optional.hpp>
@@ -0,0 +1,269 @@
+#include "MeshCodec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <set>
+#include <unordered_map>
+
+namespace {
+    constexpr uint8_t FormatVersion = 1;
+    constexpr uint8_t FlagPacked = 1;  // decodes to packedVertices
+    constexpr uint8_t FlagNormals = 2; // separate layout with normals
+
+    // Grid positions and vertex counts whose deltas still fit the 32-bit zigzag
+    constexpr double MaxSteps = double(std::numeric_limits<int32_t>::max() - 1);
+
+    struct Header {
+        uint8_t version;
+        uint8_t flags;
+        uint32_t vertexCount;
+        uint32_t uniqueCount;
+        float origin[3];
+        float step;
+    };
+
+    // Quantized vertex: grid position and octahedral normal
+    struct QVertex {
+        uint32_t v[5];
+        bool operator==(const QVertex& o) const { return std::memcmp(v, o.v, sizeof(v)) == 0; }
+    };
+
+    struct QVertexHash {
+        size_t operator()(const QVertex& q) const {
+            size_t h = 1469598103934665603ull;
+            for (uint32_t x : q.v)
+                h = (h ^ x) * 1099511628211ull;
+            return h;
+        }
+    };
+
+    inline uint32_t zigzag(int64_t x) { return static_cast<uint32_t>((static_cast<uint64_t>(x) << 1) ^ static_cast<uint64_t>(x >> 63)); }
+    inline int64_t unzigzag(uint32_t x) { return static_cast<int64_t>(x >> 1) ^ -static_cast<int64_t>(x & 1); }
+
+    inline void writeVarint(std::vector<uint8_t>& out, uint32_t x) {
+        while (x >= 0x80) {
+            out.push_back(static_cast<uint8_t>(x | 0x80));
+            x >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(x));
+    }
+
+    inline uint32_t readVarint(const uint8_t*& p) {
+        if (*p < 0x80)
+            return *p++; // single byte, the common case of small deltas
+        uint32_t x = *p & 0x7f;
+        int shift = 7;
+        while (*p++ & 0x80) {
+            x |= static_cast<uint32_t>(*p & 0x7f) << shift;
+            shift += 7;
+        }
+        return x;
+    }
+}
+
+void MeshCodec::compress(SceneData::Mesh& mesh, const Options& options)
+{
+    const size_t nVerts = mesh.vertexCount();
+    if (mesh.isSpilled() || mesh.isEncoded() || nVerts == 0)
+        return;
+
+    const bool packed = mesh.layout() == SceneData::VertexLayout::Packed;
+    const bool hasNormals = packed || mesh.normals.size() == nVerts;
+
+    auto position = [&](size_t i) {
+        return packed ? SceneData::Vec3f{mesh.packedVertices[i].x, mesh.packedVertices[i].y, mesh.packedVertices[i].z}
+                      : mesh.vertices[i];
+    };
+
+    Header header{FormatVersion, static_cast<uint8_t>((packed ? FlagPacked : 0) | (hasNormals ? FlagNormals : 0)),
+                  static_cast<uint32_t>(nVerts), 0, {}, options.positionPrecision};
+    float maxima[3];
+    std::fill(header.origin, header.origin + 3, std::numeric_limits<float>::max());
+    std::fill(maxima, maxima + 3, std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < nVerts; ++i) {
+        auto p = position(i);
+        header.origin[0] = std::min(header.origin[0], p.x);
+        header.origin[1] = std::min(header.origin[1], p.y);
+        header.origin[2] = std::min(header.origin[2], p.z);
+        maxima[0] = std::max(maxima[0], p.x);
+        maxima[1] = std::max(maxima[1], p.y);
+        maxima[2] = std::max(maxima[2], p.z);
+    }
+
+    // Extents beyond the grid would wrap silently, such meshes stay uncompressed
+    if (!(header.step > 0.0f) || double(nVerts) >= MaxSteps)
+        return;
+    for (int k = 0; k < 3; ++k)
+        if (!((double(maxima[k]) - double(header.origin[k])) / header.step < MaxSteps))
+            return;
+
+    // Quantize and merge identical vertices of the triangle soup
+    std::vector<QVertex> uniques;
+    std::vector<uint32_t> indices;
+    indices.reserve(nVerts);
+    std::unordered_map<QVertex, uint32_t, QVertexHash> indexOf;
+    indexOf.reserve(nVerts);
+    for (size_t i = 0; i < nVerts; ++i) {
+        auto p = position(i);
+        SceneData::PackedVertex n = packed ? mesh.packedVertices[i]
+                                           : SceneData::packVertex(p, hasNormals ? mesh.normals[i] : SceneData::Vec3f{});
+        QVertex q{{static_cast<uint32_t>(std::lround((p.x - header.origin[0]) / header.step)),
+                   static_cast<uint32_t>(std::lround((p.y - header.origin[1]) / header.step)),
+                   static_cast<uint32_t>(std::lround((p.z - header.origin[2]) / header.step)),
+                   static_cast<uint16_t>(n.nx), static_cast<uint16_t>(n.ny)}};
+        auto inserted = indexOf.emplace(q, static_cast<uint32_t>(uniques.size()));
+        if (inserted.second)
+            uniques.push_back(q);
+        indices.push_back(inserted.first->second);
+    }
+    header.uniqueCount = static_cast<uint32_t>(uniques.size());
+
+    std::vector<uint8_t> bytes(sizeof(Header));
+    std::memcpy(bytes.data(), &header, sizeof(Header));
+    bytes.reserve(sizeof(Header) + uniques.size() * 8 + indices.size());
+
+    // Unique vertices, each component as a delta to the previous vertex
+    const int nComponents = hasNormals ? 5 : 3;
+    QVertex previous{};
+    for (const QVertex& q : uniques) {
+        for (int k = 0; k < nComponents; ++k)
+            writeVarint(bytes, zigzag(int64_t(q.v[k]) - int64_t(previous.v[k])));
+        previous = q;
+    }
+
+    // Indices: 0 for the next new vertex (the common case), otherwise the delta to the previous index plus one
+    uint32_t nextNew = 0;
+    int64_t previousIndex = 0;
+    for (uint32_t index : indices) {
+        if (index == nextNew) {
+            bytes.push_back(0);
+            ++nextNew;
+        } else {
+            writeVarint(bytes, zigzag(int64_t(index) - previousIndex) + 1);
+        }
+        previousIndex = index;
+    }
+
+    bytes.shrink_to_fit();
+    mesh.encoded = std::move(bytes);
+    mesh.encodedVertexCount = nVerts;
+    mesh.vertices = {};
+    mesh.normals = {};
+    mesh.packedVertices = {};
+}
+
+SceneData::Mesh MeshCodec::decompress(const SceneData::Mesh& mesh)
+{
+    if (mesh.encoded.empty())
+        return mesh;
+
+    SceneData::Mesh out;
+    out.color = mesh.color;
+
+    Header header;
+    std::memcpy(&header, mesh.encoded.data(), sizeof(Header));
+    const uint8_t* p = mesh.encoded.data() + sizeof(Header);
+    const bool packed = header.flags & FlagPacked;
+    const bool hasNormals = header.flags & FlagNormals;
+
+    std::vector<SceneData::PackedVertex> uniques(header.uniqueCount);
+    int64_t q[5] = {0, 0, 0, 0, 0};
+    for (auto& v : uniques) {
+        q[0] += unzigzag(readVarint(p));
+        q[1] += unzigzag(readVarint(p));
+        q[2] += unzigzag(readVarint(p));
+        v.x = header.origin[0] + float(q[0]) * header.step;
+        v.y = header.origin[1] + float(q[1]) * header.step;
+        v.z = header.origin[2] + float(q[2]) * header.step;
+        if (hasNormals) {
+            q[3] += unzigzag(readVarint(p));
+            q[4] += unzigzag(readVarint(p));
+            v.nx = static_cast<int16_t>(static_cast<uint16_t>(q[3]));
+            v.ny = static_cast<int16_t>(static_cast<uint16_t>(q[4]));
+        }
+    }
+
+    // Expand the index list into the triangle soup
+    auto expand = [&](auto&& emit) {
+        uint32_t nextNew = 0;
+        int64_t previousIndex = 0;
+        for (uint32_t i = 0; i < header.vertexCount; ++i) {
+            uint32_t code = readVarint(p);
+            int64_t index = code == 0 ? nextNew++ : previousIndex + unzigzag(code - 1);
+            previousIndex = index;
+            emit(i, static_cast<size_t>(index));
+        }
+    };
+
+    if (packed) {
+        out.packedVertices.resize(header.vertexCount);
+        SceneData::PackedVertex* pOut = out.packedVertices.data();
+        expand([&](uint32_t i, size_t index) { pOut[i] = uniques[index]; });
+    }
+    else {
+        // Normals are decoded once per distinct vertex
+        std::vector<SceneData::Vec3f> uniqueNormals;
+        if (hasNormals) {
+            uniqueNormals.reserve(uniques.size());
+            for (const auto& v : uniques)
+                uniqueNormals.push_back(SceneData::unpackNormal(v));
+            out.normals.resize(header.vertexCount);
+        }
+        out.vertices.resize(header.vertexCount);
+        SceneData::Vec3f* pVertices = out.vertices.data();
+        SceneData::Vec3f* pNormals = out.normals.data();
+        expand([&](uint32_t i, size_t index) {
+            const SceneData::PackedVertex& v = uniques[index];
+            pVertices[i] = {v.x, v.y, v.z};
+            if (hasNormals)
+                pNormals[i] = uniqueNormals[index];
+        });
+    }
+    return out;
+}
+
+size_t MeshCodec::vertexBytes(const SceneData::Mesh& mesh)
+{
+    return mesh.encoded.size()
+         + mesh.packedVertices.size() * sizeof(SceneData::PackedVertex)
+         + (mesh.vertices.size() + mesh.normals.size()) * sizeof(SceneData::Vec3f);
+}
+
+MeshCodec::Report MeshCodec::measure(const std::vector<SceneData::Object>& objects)
+{
+    Report report;
+
+    // Instances share their meshes, each one is measured once
+    std::set<const std::vector<SceneData::Mesh>*> visited;
+    for (const auto& object : objects) {
+        if (!object.meshes || !visited.insert(object.meshes.get()).second)
+            continue;
+
+        for (const auto& mesh : *object.meshes) {
+            if (mesh.encoded.empty())
+                continue;
+
+            auto start = std::chrono::steady_clock::now();
+            SceneData::Mesh decoded = decompress(mesh);
+            report.decodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            report.nMeshes++;
+            report.nTriangles += decoded.vertexCount() / 3;
+            report.rawBytes += vertexBytes(decoded);
+            report.compressedBytes += mesh.encoded.size();
+        }
+    }
+    return report;
+}
+
+std::string MeshCodec::Report::toString() const
+{
+    char text[256];
+    std::snprintf(text, sizeof(text),
+                  "%zu meshes, %zu triangles: %.1f bytes/triangle compressed, %.1f raw, decode %.2f GB/s",
+                  nMeshes, nTriangles, compressedBytesPerTriangle(), rawBytesPerTriangle(), decodeGBps());
+    return text;
+}
@@ -0,0 +1,53 @@
+#ifndef MESHCODEC_H
+#define MESHCODEC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SceneData.h"
+
+/*
+ * Compact storage of SceneData meshes kept resident on the CPU side.
+ * Positions are quantized on a fixed grid, normals octahedral encoded,
+ * duplicated vertices of the triangle soup are merged into an index list,
+ * and everything is written as zigzag delta varints. Decoding is a single
+ * sequential pass over the bytes.
+ */
+class MeshCodec
+{
+public:
+    struct Options {
+        float positionPrecision = 1e-4f; // quantization step of the positions, in model units (0.1 mm for meters)
+    };
+
+    // Replace the vertex arrays of the mesh by its encoded form, no-op if already encoded, spilled, empty,
+    // or larger than 2^31 quantization steps
+    static void compress(SceneData::Mesh& mesh, const Options& options);
+    static void compress(SceneData::Mesh& mesh) { compress(mesh, Options()); }
+
+    // Decode an encoded mesh held in memory into the layout it was built with
+    static SceneData::Mesh decompress(const SceneData::Mesh& mesh);
+
+    // Bytes used in memory by the vertex data of the mesh, in its current form
+    static size_t vertexBytes(const SceneData::Mesh& mesh);
+
+    struct Report {
+        size_t nMeshes = 0;
+        size_t nTriangles = 0;
+        size_t rawBytes = 0;        // decoded vertex data
+        size_t compressedBytes = 0; // encoded vertex data
+        double decodeMs = 0.0;
+
+        double rawBytesPerTriangle() const { return nTriangles ? double(rawBytes) / nTriangles : 0.0; }
+        double compressedBytesPerTriangle() const { return nTriangles ? double(compressedBytes) / nTriangles : 0.0; }
+        double decodeGBps() const { return decodeMs > 0.0 ? rawBytes / (decodeMs * 1e6) : 0.0; }
+
+        std::string toString() const;
+    };
+
+    // Decode every distinct encoded mesh of the objects once, to measure memory per triangle and decode throughput
+    static Report measure(const std::vector<SceneData::Object>& objects);
+};
+
+#endif // MESHCODEC_H
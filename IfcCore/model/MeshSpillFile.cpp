@@ -0,0 +1,153 @@
+#include "MeshSpillFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <ifcparse/IfcLogger.h>
+
+namespace {
+    const std::string Prefix("[MeshSpillFile] ");
+
+    template<typename T>
+    size_t byteSize(const std::vector<T>& data) { return data.size() * sizeof(T); }
+}
+
+std::shared_ptr<MeshSpillFile> MeshSpillFile::create(const std::string& directory)
+{
+    std::error_code ec;
+    std::filesystem::path dir = directory.empty() ? std::filesystem::temp_directory_path(ec) : std::filesystem::path(directory);
+    std::string path = (dir / "ifcengine-spill-XXXXXX").string();
+
+    int fd = ::mkstemp(path.data());
+    if (fd < 0) {
+        Logger::Error(Prefix + "Failed to create scratch file in " + dir.string() + ": " + std::strerror(errno));
+        return nullptr;
+    }
+
+    // The data lives as long as the descriptor, nothing is left behind after a crash
+    ::unlink(path.c_str());
+    return std::shared_ptr<MeshSpillFile>(new MeshSpillFile(fd, path));
+}
+
+MeshSpillFile::MeshSpillFile(int fd, std::string path): m_fd(fd), m_path(std::move(path)) {}
+
+MeshSpillFile::~MeshSpillFile()
+{
+    if (m_pMapped)
+        ::munmap(m_pMapped, m_mappedSize);
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+uint64_t MeshSpillFile::size() const
+{
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    return m_size;
+}
+
+bool MeshSpillFile::write(const void* pData, size_t nBytes)
+{
+    const auto* p = static_cast<const uint8_t*>(pData);
+    while (nBytes > 0) {
+        ssize_t n = ::pwrite(m_fd, p, nBytes, static_cast<off_t>(m_size));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            Logger::Error(Prefix + "Failed to write scratch file " + m_path + ": " + std::strerror(errno));
+            return false;
+        }
+        p += n;
+        nBytes -= static_cast<size_t>(n);
+        m_size += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool MeshSpillFile::spill(SceneData::Mesh& mesh)
+{
+    if (mesh.isSpilled())
+        return true;
+
+    SceneData::SpillRef ref;
+    ref.file = shared_from_this();
+    ref.nVertices = mesh.vertices.size();
+    ref.nNormals = mesh.normals.size();
+    ref.nPacked = mesh.packedVertices.size();
+    ref.nEncoded = mesh.encoded.size();
+
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        ref.offset = m_size;
+        if (!write(mesh.vertices.data(), byteSize(mesh.vertices))
+            || !write(mesh.normals.data(), byteSize(mesh.normals))
+            || !write(mesh.packedVertices.data(), byteSize(mesh.packedVertices))
+            || !write(mesh.encoded.data(), byteSize(mesh.encoded)))
+        {
+            // The partial record is unreferenced, later records are appended after it
+            return false;
+        }
+    }
+
+    mesh.vertices = {};
+    mesh.normals = {};
+    mesh.packedVertices = {};
+    mesh.encoded = {};
+    mesh.spill = std::move(ref);
+    return true;
+}
+
+bool MeshSpillFile::ensureMapped(uint64_t end)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mapMutex);
+    if (end <= m_mappedSize)
+        return true;
+
+    // Map everything written so far, the mapping only grows
+    uint64_t fileSize = size();
+    void* p = ::mmap(nullptr, static_cast<size_t>(fileSize), PROT_READ, MAP_SHARED, m_fd, 0);
+    if (p == MAP_FAILED) {
+        Logger::Error(Prefix + "Failed to map scratch file " + m_path + ": " + std::strerror(errno));
+        return false;
+    }
+    if (m_pMapped)
+        ::munmap(m_pMapped, m_mappedSize);
+    m_pMapped = static_cast<uint8_t*>(p);
+    m_mappedSize = fileSize;
+    return true;
+}
+
+SceneData::Mesh MeshSpillFile::load(const SceneData::Mesh& mesh)
+{
+    if (!mesh.isSpilled())
+        return mesh;
+
+    const SceneData::SpillRef& ref = mesh.spill;
+    SceneData::Mesh out;
+    out.color = mesh.color;
+    out.encodedVertexCount = mesh.encodedVertexCount;
+
+    const uint64_t total = ref.nVertices * sizeof(SceneData::Vec3f) + ref.nNormals * sizeof(SceneData::Vec3f)
+                         + ref.nPacked * sizeof(SceneData::PackedVertex) + ref.nEncoded;
+    if (total == 0 || !ensureMapped(ref.offset + total))
+        return out;
+
+    std::shared_lock<std::shared_mutex> lock(m_mapMutex);
+    const uint8_t* p = m_pMapped + ref.offset;
+    auto copyOut = [&p](auto& data, size_t count) {
+        if (count == 0)
+            return;
+        data.resize(count);
+        std::memcpy(data.data(), p, byteSize(data));
+        p += byteSize(data);
+    };
+    copyOut(out.vertices, ref.nVertices);
+    copyOut(out.normals, ref.nNormals);
+    copyOut(out.packedVertices, ref.nPacked);
+    copyOut(out.encoded, ref.nEncoded);
+    return out;
+}
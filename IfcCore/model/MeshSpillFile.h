@@ -0,0 +1,55 @@
+#ifndef MESHSPILLFILE_H
+#define MESHSPILLFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+
+#include "SceneData.h"
+
+/*
+ * Scratch file holding the vertex data of meshes moved out of memory.
+ * Meshes are appended to the file and read back through a shared memory
+ * mapping, so the OS pages them in on access and drops them under pressure.
+ * The file is deleted as soon as it is created and disappears with the last reference.
+ */
+class MeshSpillFile : public std::enable_shared_from_this<MeshSpillFile>
+{
+public:
+    // Create the scratch file in the given directory, the system temp directory if empty; null on failure
+    static std::shared_ptr<MeshSpillFile> create(const std::string& directory = {});
+
+    ~MeshSpillFile();
+
+    MeshSpillFile(const MeshSpillFile&) = delete;
+    MeshSpillFile& operator=(const MeshSpillFile&) = delete;
+
+    // Move the vertex data of the mesh to the file, return false (mesh unchanged) if it could not be written
+    bool spill(SceneData::Mesh& mesh);
+
+    // Copy of a spilled mesh with its vertex data back in memory, in the form it was spilled (possibly encoded)
+    SceneData::Mesh load(const SceneData::Mesh& mesh);
+
+    uint64_t size() const;
+
+private:
+    MeshSpillFile(int fd, std::string path);
+
+    int m_fd = -1;
+    std::string m_path;
+
+    mutable std::mutex m_writeMutex;
+    uint64_t m_size = 0;
+
+    // Readers copy from the mapping under a shared lock, it is remapped when the file has grown
+    mutable std::shared_mutex m_mapMutex;
+    uint8_t* m_pMapped = nullptr;
+    uint64_t m_mappedSize = 0;
+
+    bool write(const void* pData, size_t nBytes);
+    bool ensureMapped(uint64_t end);
+};
+
+#endif // MESHSPILLFILE_H
@@ -0,0 +1,43 @@
+#ifndef MESHVIEW_H
+#define MESHVIEW_H
+
+#include "SceneData.h"
+#include "MeshCodec.h"
+#include "MeshSpillFile.h"
+
+/*
+ * Read access to the vertex data of a mesh whatever its storage.
+ * In-memory uncompressed meshes are referenced, spilled ones are paged back in
+ * and compressed ones decoded into the view, which then owns the arrays until it is destroyed.
+ */
+class MeshView
+{
+public:
+    explicit MeshView(const SceneData::Mesh& mesh)
+        : m_pMesh(&mesh)
+    {
+        if (mesh.isSpilled()) {
+            m_decoded = mesh.spill.file->load(mesh);
+            if (!m_decoded.encoded.empty())
+                m_decoded = MeshCodec::decompress(m_decoded);
+            m_pMesh = &m_decoded;
+        }
+        else if (mesh.isEncoded()) {
+            m_decoded = MeshCodec::decompress(mesh);
+            m_pMesh = &m_decoded;
+        }
+    }
+
+    MeshView(const MeshView&) = delete;
+    MeshView& operator=(const MeshView&) = delete;
+
+    // Mesh with its vertices, normals or packedVertices filled
+    const SceneData::Mesh& mesh() const { return *m_pMesh; }
+    const SceneData::Mesh* operator->() const { return m_pMesh; }
+
+private:
+    const SceneData::Mesh* m_pMesh;
+    SceneData::Mesh m_decoded;
+};
+
+#endif // MESHVIEW_H
@@ -3,6 +3,12 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+class MeshSpillFile;
 
 class SceneData {
 public:
@@ -19,14 +25,93 @@ public:
         float a = 1.0f;
     };
 
+    // Memory layout of the mesh vertices
+    enum class VertexLayout {
+        Separate,   // vertices and normals arrays, 24 bytes per vertex
+        Packed      // packedVertices, interleaved position and octahedral normal, 16 bytes per vertex
+    };
+
+    // Position in local coordinates and unit normal encoded on the octahedron as two snorm16
+    struct PackedVertex {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+        int16_t nx = 0;
+        int16_t ny = 0;
+    };
+    static_assert(sizeof(PackedVertex) == 16, "PackedVertex is uploaded as is to the GPU");
+
+    // Location of the vertex data of a mesh moved to a MeshSpillFile, with the array sizes it had
+    struct SpillRef {
+        std::shared_ptr<MeshSpillFile> file;
+        uint64_t offset = 0;
+        size_t nVertices = 0;
+        size_t nNormals = 0;
+        size_t nPacked = 0;
+        size_t nEncoded = 0;
+    };
+
     // Represents a mesh with a single material
     // Vertices are ordered to form triangles (e.g., v0,v1,v2, v3,v4,v5, ...)
+    // Depending on the layout, either vertices and normals or packedVertices are filled
+    // A compressed mesh holds its vertex data in encoded only, a spilled one in a scratch file;
+    // read them through MeshView
     struct Mesh {
         std::vector<Vec3f> vertices;  // Local coordinates
         std::vector<Vec3f> normals;   // Per-vertex normals, same count as vertices
+        std::vector<PackedVertex> packedVertices;
+        std::vector<uint8_t> encoded;
+        size_t encodedVertexCount = 0;
+        SpillRef spill;
         ColorRGBA color;
+
+        bool isSpilled() const { return spill.file != nullptr; }
+        bool isEncoded() const { return isSpilled() ? spill.nEncoded > 0 : !encoded.empty(); }
+        VertexLayout layout() const {
+            return (isSpilled() ? spill.nPacked : packedVertices.size()) ? VertexLayout::Packed : VertexLayout::Separate;
+        }
+        size_t vertexCount() const {
+            if (isEncoded())
+                return encodedVertexCount;
+            if (isSpilled())
+                return spill.nPacked ? spill.nPacked : spill.nVertices;
+            return packedVertices.empty() ? vertices.size() : packedVertices.size();
+        }
     };
 
+    static PackedVertex packVertex(const Vec3f& position, const Vec3f& normal) {
+        PackedVertex v;
+        v.x = position.x;
+        v.y = position.y;
+        v.z = position.z;
+
+        // Project on the octahedron |x|+|y|+|z| = 1, fold the lower half over the upper one
+        float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        float ox = l1 > 0.0f ? normal.x / l1 : 0.0f;
+        float oy = l1 > 0.0f ? normal.y / l1 : 0.0f;
+        if (l1 > 0.0f && normal.z < 0.0f) {
+            float fx = (1.0f - std::abs(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - std::abs(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+            ox = fx;
+            oy = fy;
+        }
+        auto toSnorm16 = [](float f) { return static_cast<int16_t>(std::lround(std::clamp(f, -1.0f, 1.0f) * 32767.0f)); };
+        v.nx = toSnorm16(ox);
+        v.ny = toSnorm16(oy);
+        return v;
+    }
+
+    static Vec3f unpackNormal(const PackedVertex& v) {
+        float x = std::max(v.nx / 32767.0f, -1.0f);
+        float y = std::max(v.ny / 32767.0f, -1.0f);
+        float z = 1.0f - std::abs(x) - std::abs(y);
+        float t = std::max(-z, 0.0f);
+        x += x >= 0.0f ? -t : t;
+        y += y >= 0.0f ? -t : t;
+        float len = std::sqrt(x * x + y * y + z * z);
+        return len > 0.0f ? Vec3f{x / len, y / len, z / len} : Vec3f{0.0f, 0.0f, 1.0f};
+    }
+
     // Represents a 4x4 transformation matrix (column-major)
     // m[12], m[13], m[14] are the translation components (dx, dy, dz)
     struct Matrix4x4 {
@@ -4,6 +4,11 @@ set(
     ${CMAKE_CURRENT_LIST_DIR}/DataNode.h
     ${CMAKE_CURRENT_LIST_DIR}/TreeNode.h
     ${CMAKE_CURRENT_LIST_DIR}/SceneData.h
+    ${CMAKE_CURRENT_LIST_DIR}/MeshCodec.h
+    ${CMAKE_CURRENT_LIST_DIR}/MeshCodec.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/MeshSpillFile.h
+    ${CMAKE_CURRENT_LIST_DIR}/MeshSpillFile.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/MeshView.h
 )
 
 source_group(model FILES ${MODEL_SOURCES})
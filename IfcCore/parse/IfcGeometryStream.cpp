@@ -0,0 +1,62 @@
+#include "IfcGeometryStream.h"
+
+#include <chrono>
+
+#include "TaskScheduler.h"
+
+IfcGeometryStream::IfcGeometryStream(size_t maxQueuedEvents): m_spState(std::make_shared<State>(maxQueuedEvents)) {}
+
+IfcGeometryStream::~IfcGeometryStream()
+{
+    //the load notices it between elements, which may take the tessellation of one: not waited for here
+    if(m_producerTask.valid())
+        cancel();
+}
+
+std::optional<IfcGeometryStream::Event> IfcGeometryStream::next()
+{
+    return m_spState->queue.pop();
+}
+
+std::optional<IfcGeometryStream::Event> IfcGeometryStream::tryNext()
+{
+    return m_spState->queue.tryPop();
+}
+
+void IfcGeometryStream::cancel()
+{
+    m_spState->cancelled = true;
+    m_spState->queue.close(); // wakes up a producer waiting for a free slot
+}
+
+bool IfcGeometryStream::isStopped() const
+{
+    return !m_producerTask.valid() || m_producerTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void IfcGeometryStream::waitStopped() const
+{
+    if(m_producerTask.valid())
+        m_producerTask.wait();
+}
+
+void IfcGeometryStream::start(Producer producer)
+{
+    //the load posts through its own stream over the same state, which outlives this one if needed
+    std::shared_ptr<IfcGeometryStream> spProducerSide(new IfcGeometryStream(m_spState));
+    m_producerTask = TaskScheduler::instance().async([spProducerSide, producer = std::move(producer)]() {
+        auto& stream = *spProducerSide;
+        try {
+            producer(stream);
+        }
+        catch(const std::exception& e) {
+            stream.post({Event::Type::Finished, nullptr, false, std::string("Geometry load failed: ") + e.what()});
+        }
+        stream.m_spState->queue.close();
+    });
+}
+
+bool IfcGeometryStream::post(Event event)
+{
+    return m_spState->queue.push(std::move(event));
+}
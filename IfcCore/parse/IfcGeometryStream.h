@@ -0,0 +1,90 @@
+#ifndef IFCGEOMETRYSTREAM_H
+#define IFCGEOMETRYSTREAM_H
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "SceneData.h"
+#include "BoundedQueue.h"
+
+/*
+ * Pull side of a geometry load running on the TaskScheduler.
+ * The load posts its events into a bounded queue and waits when the queue is full, so that
+ * the delivered batches waiting for a slow consumer are bounded. The threads of the IfcOpenShell
+ * iterator tessellate ahead of the load regardless, up to the window of products given to
+ * the iterator, see IfcGeometryParser::Options::windowSize.
+ * Destroying the stream cancels the load without waiting for it, the queue lives until the load
+ * returns; whoever owns what the load uses (eg. the parser) keeps it until isStopped.
+ */
+class IfcGeometryStream
+{
+public:
+    struct Event {
+        enum class Type {
+            ObjectsReady,   // new objects
+            ObjectsRefined, // full quality meshes of objects already delivered
+            Interactive,    // coarse pass of a progressive load done
+            Finished        // last event of the stream
+        };
+
+        Type type = Type::Finished;
+        std::shared_ptr<std::vector<SceneData::Object>> objects; // ObjectsReady and ObjectsRefined only
+        bool success = false;                                     // Interactive and Finished only
+        std::string message;
+    };
+
+    using Producer = std::function<void(IfcGeometryStream& stream)>;
+
+    // maxQueuedEvents: number of events the load may get ahead of the consumer
+    explicit IfcGeometryStream(size_t maxQueuedEvents);
+    ~IfcGeometryStream();
+
+    IfcGeometryStream(const IfcGeometryStream&) = delete;
+    IfcGeometryStream& operator=(const IfcGeometryStream&) = delete;
+
+    // Consumer side
+
+    // Wait for the next event, empty once the Finished event was consumed or the stream was cancelled
+    std::optional<Event> next();
+    // Return immediately, empty if no event is ready yet
+    std::optional<Event> tryNext();
+    // All events consumed
+    bool isDrained() const { return m_spState->queue.isDrained(); }
+
+    // Stop the load, the queued events are dropped
+    void cancel();
+
+    // The load returned, it no longer uses the parser
+    bool isStopped() const;
+    void waitStopped() const;
+
+    // Producer side
+
+    // Run the producer on the TaskScheduler, the stream is closed when it returns
+    void start(Producer producer);
+    // Wait for a free slot, return false if the stream was cancelled
+    bool post(Event event);
+    bool isCancelled() const { return m_spState->cancelled.load(); }
+
+private:
+    // Shared by the stream and the load
+    struct State {
+        explicit State(size_t maxQueuedEvents): queue(maxQueuedEvents) {}
+
+        BoundedQueue<Event> queue;
+        std::atomic<bool> cancelled{false};
+    };
+
+    // Producer side of the same state, owned by the load
+    explicit IfcGeometryStream(std::shared_ptr<State> spState): m_spState(std::move(spState)) {}
+
+    std::shared_ptr<State> m_spState;
+    std::future<void> m_producerTask;
+};
+
+#endif // IFCGEOMETRYSTREAM_H
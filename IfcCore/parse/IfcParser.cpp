@@ -1,7 +1,11 @@
 #include "IfcParser.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
 #include <string>
+#include <unordered_set>
 
 #include <ifcparse/Ifc2x3.h>
 #include <ifcparse/Ifc4.h>
@@ -25,25 +29,110 @@
 #include "IfcGeometryParser.h"
 #include "IfcElemProcessorMesh.h"
 #include "IfcElemProcessorMeshFlow.h"
+#include "IfcElemProcessorGltf.h"
+#include "IfcElemProcessorQuantity.h"
+#include "IfcElemProcessorNetQuantity.h"
+#include "IfcElemProcessorOCC.h"
+#include "IfcElemCurvature.h"
+#include "IfcKernelBenchmark.h"
+#include "MeshCodec.h"
+#include "MeshSpillFile.h"
+#include "IfcSceneCache.h"
+#include "IfcProfiler.h"
+#include "IfcMemory.h"
+#include "IfcQuantityReport.h"
+#include "IfcPlanSlicer.h"
 
 #define IFC_SCHEMA_SEQ (Ifc4x3_add2)(Ifc4x3)(Ifc4x2)(Ifc4x1)(Ifc4)(Ifc2x3)
 #define PROCESS_FOR_SCHEMA(r, data, elem)                               \
 if (schema_version == BOOST_PP_STRINGIZE(elem))                         \
 {                                                                       \
-    adapter = std::make_unique<IfcSchemaStrategyImpl<elem>>(m_ifcFile); \
+    adapter = std::make_unique<IfcSchemaStrategyImpl<elem>>(ifcFile()); \
 }                                                                       \
 else                                                                    \
 
-IfcParser::IfcParser(const std::string& file): m_sFile(file), m_ifcFile(file)
+namespace {
+    // First pass deflections of the progressive quality mode, in meters and radians
+    constexpr double CoarseLinearDeflection = 0.05;
+    constexpr double CoarseAngularDeflection = 1.0;
+
+    // Products per geometry iterator of a stream at least, below the iterator threads run short of work
+    constexpr size_t MinStreamWindow = 256;
+
+    // Accept only the products with the given GlobalIds
+    IfcGeom::filter_t guidFilter(const std::vector<std::string>& guids) {
+        auto spGuids = std::make_shared<std::unordered_set<std::string>>(guids.begin(), guids.end());
+        return [spGuids](IfcUtil::IfcBaseEntity* pProduct) {
+            std::string guid = pProduct->get("GlobalId");
+            return spGuids->count(guid) > 0;
+        };
+    }
+}
+
+IfcParser::IfcParser(const std::string& file): m_sFile(file)
 {
-    if(!m_ifcFile.good())
-        std::cerr << "Unable to parse .ifc file" << std::endl;
 }
 
+IfcParser::~IfcParser()
+{
+    IfcMemory::add(IfcMemory::Category::IfcFile, -m_ifcFileBytes);
+}
+
+IfcParse::IfcFile& IfcParser::ifcFile()
+{
+    //the tree and the stream functions may first need the file from different threads
+    std::call_once(m_ifcFileOnce, [this]() {
+        IFC_PROFILE_SCOPE("IfcFile parse", "parse");
+        //IfcOpenShell does not report its memory, the growth of the process while parsing is the best estimate
+        size_t residentBefore = IfcMemory::residentBytes();
+        m_upIfcFile = std::make_unique<IfcParse::IfcFile>(m_sFile);
+        size_t residentAfter = IfcMemory::residentBytes();
+        m_ifcFileBytes = residentAfter > residentBefore ? int64_t(residentAfter - residentBefore) : 0;
+        IfcMemory::add(IfcMemory::Category::IfcFile, m_ifcFileBytes);
+        if(!m_upIfcFile->good())
+            std::cerr << "Unable to parse .ifc file" << std::endl;
+    });
+    return *m_upIfcFile;
+}
 
 std::unique_ptr<DataNode::Base> IfcParser::createPreviewTree()
 {
-    auto schema_version = m_ifcFile.schema()->name().substr(3);
+    auto upTree = readOrBuildTree();
+
+    StoreyIndex storeyIndex;
+    indexStoreys(upTree.get(), storeyIndex);
+    {
+        std::lock_guard<std::mutex> lock(m_storeyIndexMutex);
+        m_objectGuidsByStorey = std::move(storeyIndex);
+    }
+    IfcMemory::set(IfcMemory::Category::StructureTree, int64_t(IfcMemory::treeBytes(upTree.get())));
+
+    return upTree;
+}
+
+std::unique_ptr<DataNode::Base> IfcParser::readOrBuildTree()
+{
+    if(auto upCache = openSceneCache())
+    {
+        IFC_PROFILE_SCOPE("Scene cache tree", "cache");
+        if(auto upTree = upCache->readTree())
+            return upTree;
+    }
+    return buildTree();
+}
+
+std::unique_ptr<DataNode::Base> IfcParser::buildTree()
+{
+    IFC_PROFILE_SCOPE("Structure build", "parse");
+    auto adapter = createSchemaStrategy();
+
+    IfcStructureBuilder builder;
+    return builder.buildTreeByStorey(ifcFile(), *adapter);
+}
+
+std::unique_ptr<IfcSchemaStrategyBase> IfcParser::createSchemaStrategy()
+{
+    auto schema_version = ifcFile().schema()->name().substr(3);
     std::transform(schema_version.begin(), schema_version.end(), schema_version.begin(), [](const char& c) {
         return std::tolower(c);
     });
@@ -56,20 +145,495 @@ std::unique_ptr<DataNode::Base> IfcParser::createPreviewTree()
         throw std::invalid_argument("IFC Schema " + schema_version + " not supported");
         return nullptr;
     }
+    return adapter;
+}
 
-    IfcStructureBuilder builder;
-    return builder.buildTreeByStorey(m_ifcFile, *adapter);
+std::unordered_map<std::string, std::vector<std::string>> IfcParser::openingsByHost()
+{
+    auto adapter = createSchemaStrategy();
+    HashRel hashRelVoids;
+    adapter->extractRelationship_Voids(ifcFile(), hashRelVoids);
+
+    std::unordered_map<std::string, std::vector<std::string>> openings;
+    for (const auto& [hostGuid, relatedOpenings] : hashRelVoids)
+    {
+        auto& guids = openings[hostGuid];
+        for (auto pOpening : relatedOpenings)
+            guids.push_back(adapter->getGlobalId(pOpening));
+    }
+    return openings;
+}
+
+std::unordered_map<std::string, std::string> IfcParser::materialsByGuid()
+{
+    std::unordered_map<std::string, std::string> materials;
+    createSchemaStrategy()->extractMaterials(ifcFile(), materials);
+    return materials;
+}
+
+void IfcParser::indexStoreys(DataNode::Base* pNode, StoreyIndex& index)
+{
+    //storey node -> class nodes -> object nodes
+    auto pObjectNode = pNode->as<DataNode::IfcObject>();
+    if(pObjectNode && pObjectNode->m_ifcClass == "IfcBuildingStorey")
+    {
+        auto& guids = index[pObjectNode->m_guid];
+        for(const auto& upClassNode : pNode->getChildren())
+            for(const auto& upChild : upClassNode->getChildren())
+                if(auto pChild = upChild->as<DataNode::IfcObject>())
+                    guids.push_back(pChild->m_guid);
+        return;
+    }
+
+    for(const auto& upChild : pNode->getChildren())
+        indexStoreys(upChild.get(), index);
+}
+
+std::vector<std::string> IfcParser::objectGuidsOfStoreys(const std::vector<std::string>& storeyGuids)
+{
+    //storey containment is resolved when building the structure tree, without preview tree it is built here once
+    std::lock_guard<std::mutex> lock(m_storeyIndexMutex);
+    if(m_objectGuidsByStorey.empty())
+    {
+        auto upTree = readOrBuildTree();
+        indexStoreys(upTree.get(), m_objectGuidsByStorey);
+    }
+
+    std::vector<std::string> objectGuids;
+    for(const auto& storeyGuid : storeyGuids)
+    {
+        auto it = m_objectGuidsByStorey.find(storeyGuid);
+        if(it != m_objectGuidsByStorey.end())
+            objectGuids.insert(objectGuids.end(), it->second.begin(), it->second.end());
+    }
+    return objectGuids;
+}
+
+std::optional<double> IfcParser::storeyElevation(const std::string& storeyGuid)
+{
+    auto adapter = createSchemaStrategy();
+    IfcUtil::IfcBaseClass* pStorey = nullptr;
+    try {
+        pStorey = ifcFile().instance_by_guid(storeyGuid);
+    }
+    catch (const IfcParse::IfcException&) {
+        return std::nullopt;
+    }
+    if (!pStorey || !adapter->isStorey(pStorey))
+        return std::nullopt;
+
+    auto elevation = adapter->getStoreyElevation(pStorey);
+    if (!elevation)
+        return std::nullopt;
+    return *elevation * adapter->getLengthUnitScale(ifcFile());
+}
+
+std::unique_ptr<IfcPlanSlicer> IfcParser::createStoreyPlan(const std::string& storeyGuid)
+{
+    auto objectGuids = objectGuidsOfStoreys({storeyGuid});
+    if (objectGuids.empty())
+        return nullptr;
+    auto spObjects = parseObjectsGeometry(objectGuids);
+    if (!spObjects || spObjects->empty())
+        return nullptr;
+
+    auto upSlicer = std::make_unique<IfcPlanSlicer>();
+    upSlicer->setObjects(*spObjects);
+    return upSlicer;
 }
 
 std::shared_ptr<std::vector<SceneData::Object>> IfcParser::parseGeometry() {
     IfcElemProcessorMesh elemProcessor;
-    IfcGeometryParser geomParser;
-    geomParser.parse(m_ifcFile, elemProcessor);
+    elemProcessor.setVertexLayout(m_vertexLayout);
+    elemProcessor.setMeshCompression(m_compressMeshes);
+
+    std::shared_ptr<MeshSpillFile> spSpillFile;
+    if(m_meshMemoryBudget > 0)
+    {
+        //without scratch file, everything stays in memory
+        spSpillFile = MeshSpillFile::create(m_scratchDirectory);
+        elemProcessor.setMemoryBudget(m_meshMemoryBudget, spSpillFile);
+    }
+
+    IfcGeometryParser geomParser(m_geometryOptions);
+    geomParser.parse(ifcFile(), elemProcessor);
+
+    auto spObjects = elemProcessor.getSceneObjects();
+    if(m_compressMeshes && spObjects)
+        Logger::Notice("[IfcParser] Compressed meshes: " + MeshCodec::measure(*spObjects).toString());
+    if(spSpillFile && elemProcessor.spilledMeshCount())
+        Logger::Notice("[IfcParser] " + std::to_string(elemProcessor.spilledMeshCount()) + " meshes spilled, "
+                       + std::to_string(spSpillFile->size() >> 20) + " MB in scratch file");
+    Logger::Notice("[IfcParser] Memory: " + IfcMemory::summary());
+    return spObjects;
+}
+
+std::shared_ptr<std::vector<SceneData::Object>> IfcParser::parseObjectsGeometry(const std::vector<std::string>& objectGuids) {
+    IfcElemProcessorMesh elemProcessor;
+    elemProcessor.setVertexLayout(m_vertexLayout);
+
+    auto options = m_geometryOptions;
+    options.order = IfcGeometryParser::Order::Iterator;
+    options.filters.push_back(guidFilter(objectGuids));
+
+    IfcGeometryParser geomParser(options);
+    geomParser.parse(ifcFile(), elemProcessor);
     return elemProcessor.getSceneObjects();
 }
 
-void IfcParser::parseGeometryFlow(Callback_ObjectReady onObjectReady, Callback_ParseFinished onParseFinished) {
+bool IfcParser::exportGlb(const std::string& outputPath) {
+    IfcElemProcessorGltf elemProcessor(outputPath);
+    IfcGeometryParser geomParser(m_geometryOptions);
+    geomParser.parse(ifcFile(), elemProcessor);
+    return elemProcessor.isWritten();
+}
+
+std::unique_ptr<IfcQuantityReport> IfcParser::createQuantityReport(QuantitySource source, std::function<bool()> isCancelled) {
+    auto options = m_geometryOptions;
+    options.order = IfcGeometryParser::Order::Iterator;
+    options.isCancelled = isCancelled;
+    auto cancelled = [&isCancelled]() { return isCancelled && isCancelled(); };
+    auto openings = openingsByHost();
+
+    //volume, surface area, footprint
+    std::unordered_map<std::string, IfcQuantityReport::Values> quantitiesByGuid;
+    auto addMeshQuantities = [&quantitiesByGuid](const IfcElemProcessorQuantity& elemProcessor) {
+        for(const auto& [guid, quantities] : elemProcessor.quantitiesByGuid())
+            quantitiesByGuid[guid] = {quantities.grossVolume, quantities.surfaceArea, quantities.footprintArea};
+    };
+
+    if(source == QuantitySource::BRep)
+    {
+        options.output = IfcGeometryParser::Output::BRep;
+        options.kernel = "opencascade";
+        IfcElemProcessorOCC elemProcessor;
+        IfcGeometryParser geomParser(options);
+        geomParser.parse(ifcFile(), elemProcessor);
+        for(const auto& [guid, quantities] : elemProcessor.quantitiesByGuid())
+            quantitiesByGuid[guid] = {quantities.volume, quantities.surfaceArea, quantities.footprintArea};
+    }
+    else if(source == QuantitySource::MeshNet)
+    {
+        //no Boolean while tessellating, the openings are clipped against their hosts afterwards
+        options.subtractOpenings = false;
+        IfcElemProcessorNetQuantity elemProcessor(openings);
+        IfcGeometryParser geomParser(options);
+        geomParser.parse(ifcFile(), elemProcessor);
+        addMeshQuantities(elemProcessor);
+
+        //the hosts the clipping does not handle get the Boolean subtraction, them only
+        const auto& booleanHosts = elemProcessor.booleanHosts();
+        if(!booleanHosts.empty() && !cancelled())
+        {
+            auto booleanOptions = options;
+            booleanOptions.subtractOpenings = true;
+            booleanOptions.filters.push_back(guidFilter(booleanHosts));
+            IfcElemProcessorQuantity booleanProcessor;
+            IfcGeometryParser booleanParser(booleanOptions);
+            booleanParser.parse(ifcFile(), booleanProcessor);
+            addMeshQuantities(booleanProcessor);
+        }
+    }
+    else
+    {
+        IfcElemProcessorQuantity elemProcessor;
+        IfcGeometryParser geomParser(options);
+        geomParser.parse(ifcFile(), elemProcessor);
+        addMeshQuantities(elemProcessor);
+    }
+
+    //openings are voids, not quantities
+    for(const auto& [hostGuid, openingGuids] : openings)
+        for(const auto& openingGuid : openingGuids)
+            quantitiesByGuid.erase(openingGuid);
+
+    if(quantitiesByGuid.empty() || cancelled())
+        return nullptr;
+
+    //runs off the GUI thread: a tree of its own, createPreviewTree would replace the storey index and memory figures
+    auto upTree = buildTree();
+    auto upReport = std::make_unique<IfcQuantityReport>();
+    upReport->build(upTree.get(), quantitiesByGuid, materialsByGuid());
+    return upReport;
+}
+
+bool IfcParser::exportQuantityReport(const std::string& csvPath, int groupBy, QuantitySource source) {
+    auto upReport = createQuantityReport(source);
+    if(!upReport)
+        return false;
+    if(!upReport->writeCsv(csvPath, groupBy))
+    {
+        Logger::Error("[IfcParser] Unable to write " + csvPath);
+        return false;
+    }
+    return true;
+}
+
+std::string IfcParser::benchmarkGeometryKernels(const std::vector<std::string>& kernels) {
+    IfcKernelBenchmark benchmark;
+    auto results = benchmark.run(ifcFile(), m_geometryOptions, kernels.empty() ? IfcKernelBenchmark::knownKernels() : kernels);
+    return IfcKernelBenchmark::toString(results);
+}
+
+IfcElemProcessorMeshFlow IfcParser::createFlowProcessor(Callback_ObjectReady onObjectReady, Callback_ParseFinished onParseFinished) const {
     IfcElemProcessorMeshFlow elemProcessor(onObjectReady, onParseFinished);
-    IfcGeometryParser geomParser;
-    geomParser.parse(m_ifcFile, elemProcessor);
+    elemProcessor.setVertexLayout(m_vertexLayout);
+    return elemProcessor;
+}
+
+IfcElemProcessorMeshFlow IfcParser::createFlowProcessor(Callback_ObjectsReady onObjectsReady, Callback_ParseFinished onParseFinished) const {
+    IfcElemProcessorMeshFlow elemProcessor(onObjectsReady, onParseFinished, m_batchCount, m_batchWindowMs);
+    elemProcessor.setVertexLayout(m_vertexLayout);
+    return elemProcessor;
+}
+
+void IfcParser::parseGeometryFlow(Callback_ObjectReady onObjectReady, Callback_ParseFinished onParseFinished) {
+    parseGeometryFlowImpl(m_geometryOptions, onObjectReady, onParseFinished);
+}
+
+void IfcParser::parseGeometryFlow(Callback_ObjectsReady onObjectsReady, Callback_ParseFinished onParseFinished) {
+    parseGeometryFlowImpl(m_geometryOptions, onObjectsReady, onParseFinished);
+}
+
+void IfcParser::parseGeometryFlowProgressive(Callback_ObjectReady onObjectReady, Callback_ObjectReady onObjectRefined,
+                                             Callback_ParseFinished onCoarseFinished, Callback_ParseFinished onParseFinished) {
+    parseGeometryFlowProgressiveImpl(m_geometryOptions, onObjectReady, onObjectRefined, onCoarseFinished, onParseFinished);
+}
+
+void IfcParser::parseGeometryFlowProgressive(Callback_ObjectsReady onObjectsReady, Callback_ObjectsReady onObjectsRefined,
+                                             Callback_ParseFinished onCoarseFinished, Callback_ParseFinished onParseFinished) {
+    parseGeometryFlowProgressiveImpl(m_geometryOptions, onObjectsReady, onObjectsRefined, onCoarseFinished, onParseFinished);
+}
+
+void IfcParser::parseStoreysGeometryFlow(const std::vector<std::string>& storeyGuids,
+                                         Callback_ObjectReady onObjectReady, Callback_ParseFinished onParseFinished) {
+    parseStoreysGeometryFlowImpl(m_geometryOptions, storeyGuids, onObjectReady, onParseFinished);
+}
+
+void IfcParser::parseStoreysGeometryFlow(const std::vector<std::string>& storeyGuids,
+                                         Callback_ObjectsReady onObjectsReady, Callback_ParseFinished onParseFinished) {
+    parseStoreysGeometryFlowImpl(m_geometryOptions, storeyGuids, onObjectsReady, onParseFinished);
+}
+
+template<typename Callback>
+void IfcParser::parseGeometryFlowImpl(const IfcGeometryParser::Options& options,
+                                      Callback onReady, Callback_ParseFinished onParseFinished) {
+    auto elemProcessor = createFlowProcessor(onReady, onParseFinished);
+    IfcGeometryParser geomParser(options);
+    geomParser.parse(ifcFile(), elemProcessor);
+}
+
+template<typename Callback>
+void IfcParser::parseGeometryFlowProgressiveImpl(const IfcGeometryParser::Options& options, Callback onReady, Callback onRefined,
+                                                 Callback_ParseFinished onCoarseFinished, Callback_ParseFinished onParseFinished) {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&start]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    //Pass 1: coarse tessellation of everything
+    bool coarseSuccess = false;
+    std::string coarseMessage;
+    auto coarseProcessor = createFlowProcessor(onReady, [&](bool success, const std::string& message) {
+        coarseSuccess = success;
+        coarseMessage = message;
+    });
+
+    auto coarseOptions = options;
+    coarseOptions.linearDeflection = CoarseLinearDeflection;
+    coarseOptions.angularDeflection = CoarseAngularDeflection;
+    IfcGeometryParser(coarseOptions).parse(ifcFile(), coarseProcessor);
+
+    char sTiming[128];
+    std::snprintf(sTiming, sizeof(sTiming), "interactive after %.0f ms", elapsedMs());
+    onCoarseFinished(coarseSuccess, coarseMessage + ", " + sTiming);
+    if(!coarseSuccess)
+    {
+        onParseFinished(false, coarseMessage);
+        return;
+    }
+
+    //Pass 2: full quality tessellation of curved objects only, planar ones are already exact
+    bool refineSuccess = false;
+    std::string refineMessage;
+    auto refineProcessor = createFlowProcessor(onRefined, [&](bool success, const std::string& message) {
+        refineSuccess = success;
+        refineMessage = message;
+    });
+
+    auto refineOptions = options;
+    //shared by the filters of the priority tiers, each tier filters every product
+    auto spCurvature = std::make_shared<IfcElemCurvature>(ifcFile());
+    refineOptions.filters.push_back([spCurvature](IfcUtil::IfcBaseEntity* pProduct) {
+        return spCurvature->isCurved(pProduct);
+    });
+    bool kernelAvailable = IfcGeometryParser(refineOptions).parse(ifcFile(), refineProcessor);
+
+    //a model without curved objects has nothing to refine, otherwise the coarse meshes are not final
+    const bool cancelled = options.isCancelled && options.isCancelled();
+    std::snprintf(sTiming, sizeof(sTiming), "total %.0f ms", elapsedMs());
+    if(!refineSuccess && (!kernelAvailable || cancelled || spCurvature->curvedCount() > 0))
+    {
+        onParseFinished(false, coarseMessage + "; refinement failed: " + refineMessage + "; " + sTiming);
+        return;
+    }
+    onParseFinished(true, coarseMessage + "; refined " + (refineSuccess ? refineMessage : std::string("no curved geometry")) + "; " + sTiming);
+}
+
+template<typename Callback>
+void IfcParser::parseStoreysGeometryFlowImpl(const IfcGeometryParser::Options& options, const std::vector<std::string>& storeyGuids,
+                                             Callback onReady, Callback_ParseFinished onParseFinished) {
+    auto storeyOptions = options;
+    storeyOptions.filters.push_back(guidFilter(objectGuidsOfStoreys(storeyGuids)));
+
+    auto elemProcessor = createFlowProcessor(onReady, onParseFinished);
+    IfcGeometryParser geomParser(storeyOptions);
+    geomParser.parse(ifcFile(), elemProcessor);
+}
+
+std::unique_ptr<IfcGeometryStream> IfcParser::openStream(size_t maxQueuedBatches,
+                                                         std::function<void(IfcGeometryStream&, const IfcGeometryParser::Options&)> producer) {
+    auto upStream = std::make_unique<IfcGeometryStream>(maxQueuedBatches);
+    upStream->start([this, producer = std::move(producer)](IfcGeometryStream& stream) {
+        auto options = m_geometryOptions;
+        options.isCancelled = [&stream]() { return stream.isCancelled(); };
+        //the iterator gets a window of about one batch ahead of a load blocked on the full stream
+        if(!options.windowSize)
+            options.windowSize = std::max(m_batchCount, MinStreamWindow);
+        producer(stream, options);
+    });
+    return upStream;
+}
+
+namespace {
+    using StreamEvent = IfcGeometryStream::Event;
+
+    // Flow callbacks posting into the stream, blocking while it is full, and recording the objects in the scene cache if any
+    IfcParser::Callback_ObjectsReady postObjects(IfcGeometryStream& stream, StreamEvent::Type type,
+                                                 std::shared_ptr<IfcSceneCacheWriter> spWriter = nullptr) {
+        return [&stream, type, spWriter](std::shared_ptr<std::vector<SceneData::Object>> spObjects) {
+            if(spWriter && spObjects)
+                spWriter->addObjects(*spObjects, type == StreamEvent::Type::ObjectsRefined);
+            stream.post({type, std::move(spObjects), true, {}});
+        };
+    }
+
+    IfcParser::Callback_ParseFinished postStatus(IfcGeometryStream& stream, StreamEvent::Type type) {
+        return [&stream, type](bool success, const std::string& message) {
+            stream.post({type, nullptr, success, message});
+        };
+    }
+}
+
+std::unique_ptr<IfcGeometryStream> IfcParser::openGeometryStream(size_t maxQueuedBatches) {
+    return openStream(maxQueuedBatches, [this](IfcGeometryStream& stream, const IfcGeometryParser::Options& options) {
+        if(streamFromSceneCache(stream, nullptr, false))
+            return;
+
+        auto spWriter = createSceneCacheWriter();
+        parseGeometryFlowImpl(options, postObjects(stream, StreamEvent::Type::ObjectsReady, spWriter),
+                              commitSceneCache(spWriter, stream, postStatus(stream, StreamEvent::Type::Finished)));
+    });
+}
+
+std::unique_ptr<IfcGeometryStream> IfcParser::openGeometryStreamProgressive(size_t maxQueuedBatches) {
+    return openStream(maxQueuedBatches, [this](IfcGeometryStream& stream, const IfcGeometryParser::Options& options) {
+        if(streamFromSceneCache(stream, nullptr, true))
+            return;
+
+        //the cache keeps the refined meshes, it is valid for both loading modes
+        auto spWriter = createSceneCacheWriter();
+        parseGeometryFlowProgressiveImpl(options, postObjects(stream, StreamEvent::Type::ObjectsReady, spWriter),
+                                         postObjects(stream, StreamEvent::Type::ObjectsRefined, spWriter),
+                                         postStatus(stream, StreamEvent::Type::Interactive),
+                                         commitSceneCache(spWriter, stream, postStatus(stream, StreamEvent::Type::Finished)));
+    });
+}
+
+std::unique_ptr<IfcGeometryStream> IfcParser::openStoreysGeometryStream(const std::vector<std::string>& storeyGuids,
+                                                                        size_t maxQueuedBatches) {
+    return openStream(maxQueuedBatches, [this, storeyGuids](IfcGeometryStream& stream, const IfcGeometryParser::Options& options) {
+        //a partial load reads the cache but does not write it
+        auto objectGuids = objectGuidsOfStoreys(storeyGuids);
+        std::unordered_set<std::string> guidSet(objectGuids.begin(), objectGuids.end());
+        if(streamFromSceneCache(stream, &guidSet, false))
+            return;
+
+        parseStoreysGeometryFlowImpl(options, storeyGuids, postObjects(stream, StreamEvent::Type::ObjectsReady),
+                                     postStatus(stream, StreamEvent::Type::Finished));
+    });
+}
+
+uint64_t IfcParser::settingsHash() const {
+    //every setting changing the delivered meshes
+    std::string settings = m_geometryOptions.kernel;
+    settings += "|" + (m_geometryOptions.linearDeflection ? std::to_string(*m_geometryOptions.linearDeflection) : std::string("default"));
+    settings += "|" + (m_geometryOptions.angularDeflection ? std::to_string(*m_geometryOptions.angularDeflection) : std::string("default"));
+    settings += "|" + std::to_string(static_cast<int>(m_vertexLayout));
+    settings += m_geometryOptions.subtractOpenings ? "" : "|gross";
+    return IfcSceneCache::hashString(settings);
+}
+
+bool IfcParser::sceneCacheApplies() {
+    //a filtered load does not deliver the whole model
+    if(!m_useSceneCache || !m_geometryOptions.filters.empty())
+        return false;
+
+    std::call_once(m_fileHashOnce, [this]() { m_fileHash = IfcSceneCache::hashFile(m_sFile); });
+    return m_fileHash != 0;
+}
+
+std::unique_ptr<IfcSceneCacheReader> IfcParser::openSceneCache() {
+    if(!sceneCacheApplies())
+        return nullptr;
+    return IfcSceneCacheReader::open(m_sFile, m_fileHash, settingsHash());
+}
+
+std::shared_ptr<IfcSceneCacheWriter> IfcParser::createSceneCacheWriter() {
+    if(!sceneCacheApplies())
+        return nullptr;
+    return IfcSceneCacheWriter::create(m_sFile, m_fileHash, settingsHash());
+}
+
+bool IfcParser::streamFromSceneCache(IfcGeometryStream& stream, const std::unordered_set<std::string>* pGuids, bool progressive) {
+    auto upCache = openSceneCache();
+    if(!upCache)
+        return false;
+
+    IFC_PROFILE_SCOPE("Scene cache objects", "cache");
+    auto start = std::chrono::steady_clock::now();
+    size_t nObjects = upCache->readObjects(m_batchCount, pGuids, [&stream](std::shared_ptr<std::vector<SceneData::Object>> spObjects) {
+        return stream.post({StreamEvent::Type::ObjectsReady, std::move(spObjects), true, {}});
+    });
+
+    if(stream.isCancelled())
+    {
+        stream.post({StreamEvent::Type::Finished, nullptr, false, "Geometry loading cancelled"});
+        return true;
+    }
+
+    char sMessage[128];
+    std::snprintf(sMessage, sizeof(sMessage), "%zu objects loaded from cache in %.0f ms", nObjects,
+                  std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    if(progressive)
+        stream.post({StreamEvent::Type::Interactive, nullptr, true, sMessage});
+    stream.post({StreamEvent::Type::Finished, nullptr, true, sMessage});
+    return true;
+}
+
+IfcParser::Callback_ParseFinished IfcParser::commitSceneCache(std::shared_ptr<IfcSceneCacheWriter> spWriter, IfcGeometryStream& stream,
+                                                              Callback_ParseFinished onParseFinished) {
+    if(!spWriter)
+        return onParseFinished;
+
+    return [this, spWriter, &stream, onParseFinished](bool success, const std::string& message) {
+        //an interrupted load would leave objects out of the cache
+        if(success && !stream.isCancelled())
+        {
+            auto upTree = buildTree();
+            if(!spWriter->commit(upTree.get()))
+                Logger::Warning("[IfcParser] Unable to write the scene cache " + IfcSceneCache::cachePath(m_sFile));
+        }
+        onParseFinished(success, message);
+    };
 }
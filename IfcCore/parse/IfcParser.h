@@ -1,19 +1,86 @@
 #ifndef IFCPARSER_H
 #define IFCPARSER_H
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_set>
 #include <ifcparse/IfcFile.h>
 
 #include "DataNode.h"
 #include "SceneData.h"
+#include "IfcGeometryParser.h"
+#include "IfcGeometryStream.h"
+
+class IfcElemProcessorMeshFlow;
+class IfcPlanSlicer;
+class IfcQuantityReport;
+class IfcSchemaStrategyBase;
+class IfcSceneCacheReader;
+class IfcSceneCacheWriter;
 
 class IfcParser
 {
     std::string m_sFile;
-    IfcParse::IfcFile m_ifcFile;
+    std::unique_ptr<IfcParse::IfcFile> m_upIfcFile; // parsed on first use, not at all when the scene cache is valid
+    std::once_flag m_ifcFileOnce;
+    int64_t m_ifcFileBytes = 0; // share of the IfcFile memory figure, parsers of the previous file may still be alive
+    IfcGeometryParser::Options m_geometryOptions;
+    using StoreyIndex = std::unordered_map<std::string, std::vector<std::string>>;
+    StoreyIndex m_objectGuidsByStorey; //storey guid _ guids of the objects it contains
+    std::mutex m_storeyIndexMutex;     // the index is read by the load tasks while the GUI may replace it
+    size_t m_batchCount = 1000;
+    int m_batchWindowMs = 50;
+    SceneData::VertexLayout m_vertexLayout = SceneData::VertexLayout::Separate;
+    bool m_compressMeshes = false;
+    size_t m_meshMemoryBudget = 0;
+    std::string m_scratchDirectory;
+    bool m_useSceneCache = false;
+    std::once_flag m_fileHashOnce;
+    uint64_t m_fileHash = 0;
 
 public:
     IfcParser(const std::string& file);
+    ~IfcParser();
+
+    // Options applied by parseGeometry and parseGeometryFlow, eg. priority ordered loading
+    void setGeometryOptions(const IfcGeometryParser::Options& options) { m_geometryOptions = options; }
+
+    // IfcOpenShell geometry kernel used for tessellation, see IfcKernelBenchmark::knownKernels()
+    void setGeometryKernel(const std::string& kernel) { m_geometryOptions.kernel = kernel; }
+
+    /**
+     * Tessellates the whole file once per kernel, with the current geometry options
+     * @param kernels: kernels to compare, all known kernels if empty
+     * @return time, triangle count and failure count per kernel and IFC class, as a text table
+     */
+    std::string benchmarkGeometryKernels(const std::vector<std::string>& kernels = {});
+
+    // Vertex layout of the meshes created by parseGeometry and the flow functions
+    void setVertexLayout(SceneData::VertexLayout layout) { m_vertexLayout = layout; }
+
+    // Keep the meshes returned by parseGeometry compressed in memory, see MeshCodec and MeshView
+    void setMeshCompression(bool enabled) { m_compressMeshes = enabled; }
+
+    /**
+     * Out-of-core mode of parseGeometry: once budgetBytes of vertex data are in memory,
+     * further meshes are spilled to a memory-mapped scratch file and paged back in by MeshView
+     * @param budgetBytes: resident vertex data limit, 0 to keep everything in memory
+     * @param scratchDirectory: directory of the scratch file, the system temp directory if empty
+     */
+    void setMeshMemoryBudget(size_t budgetBytes, const std::string& scratchDirectory = {}) {
+        m_meshMemoryBudget = budgetBytes;
+        m_scratchDirectory = scratchDirectory;
+    }
+
+    /**
+     * Persistent scene cache, see IfcSceneCache: the tree and the stream functions read a valid
+     * <file>.ifccache instead of parsing the IFC file, and a full geometry stream writes it.
+     * It is keyed by the content of the file and the geometry settings, and ignored while geometry filters are set.
+     */
+    void setSceneCache(bool enabled) { m_useSceneCache = enabled; }
 
     std::unique_ptr<DataNode::Base> createPreviewTree();
 
@@ -26,10 +93,72 @@ public:
      */
     std::shared_ptr<std::vector<SceneData::Object>> parseGeometry();
 
+    /**
+     * Tessellates the given objects again, eg. when their meshes were released after upload to the GPU
+     * @param objectGuids: GlobalIds of the objects
+     * @return the scene objects, with the current geometry options and vertex layout
+     */
+    std::shared_ptr<std::vector<SceneData::Object>> parseObjectsGeometry(const std::vector<std::string>& objectGuids);
+
+    /**
+     * Tessellates the model straight into a binary glTF file, see IfcElemProcessorGltf
+     * @param outputPath: .glb file to write
+     * @return false if the geometry or the file could not be written
+     */
+    bool exportGlb(const std::string& outputPath);
+
+    // Source of the quantities of createQuantityReport
+    enum class QuantitySource {
+        Mesh,   // measured on the triangulation, see IfcElemProcessorQuantity
+        BRep,   // exact, from the OpenCASCADE shapes, see IfcElemProcessorOCC
+        MeshNet // triangulation without opening subtractions, net quantities by clipping, see IfcElemProcessorNetQuantity
+    };
+
+    /**
+     * Measures every element and groups the quantities by storey, IFC class and material, see IfcQuantityReport
+     * @param isCancelled: polled between elements
+     * @return null if no geometry was loaded or the load was cancelled
+     */
+    std::unique_ptr<IfcQuantityReport> createQuantityReport(QuantitySource source = QuantitySource::Mesh,
+                                                            std::function<bool()> isCancelled = nullptr);
+
+    /**
+     * Headless take-off: createQuantityReport written as CSV
+     * @param groupBy: combination of IfcQuantityReport::GroupBy flags
+     * @return false if no geometry was loaded or the file could not be written
+     */
+    bool exportQuantityReport(const std::string& csvPath, int groupBy, QuantitySource source = QuantitySource::Mesh);
+
+    // Material names of the objects, by GUID
+    std::unordered_map<std::string, std::string> materialsByGuid();
+
+    /**
+     * Elevation of a storey in metres, the unit of the geometry, from its Elevation attribute
+     * @return nullopt if the storey is unknown or its elevation is not set
+     */
+    std::optional<double> storeyElevation(const std::string& storeyGuid);
+
+    /**
+     * Floor plan of a storey: a slicer loaded with the geometry of its objects, to cut at the storey elevation
+     * plus a cut height, see IfcPlanSlicer and storeyElevation
+     * @return null if the storey has no geometry
+     */
+    std::unique_ptr<IfcPlanSlicer> createStoreyPlan(const std::string& storeyGuid);
+
+    // Opening GUIDs of the elements voided by openings (IfcRelVoidsElement), by element GUID
+    std::unordered_map<std::string, std::vector<std::string>> openingsByHost();
+
     // Define callback types
     using Callback_ObjectReady = std::function<void(std::shared_ptr<SceneData::Object> objectData)>;
+    using Callback_ObjectsReady = std::function<void(std::shared_ptr<std::vector<SceneData::Object>> objectsData)>;
     using Callback_ParseFinished = std::function<void(bool success, const std::string& message)>;
 
+    /**
+     * Batching of the flow functions taking a Callback_ObjectsReady:
+     * ready objects are delivered together once batchCount of them are ready, or when the oldest one waited batchWindowMs
+     */
+    void setBatchDelivery(size_t batchCount, int batchWindowMs) { m_batchCount = batchCount; m_batchWindowMs = batchWindowMs; }
+
     /**
      * @brief parseGeometryFlow
      * Parse geometry from the IFC file supporting callbacks when one object is ready
@@ -37,6 +166,88 @@ public:
      * @param onParseFinished: callback function when all geometry are parsed
      */
     void parseGeometryFlow(Callback_ObjectReady onObjectReady, Callback_ParseFinished onParseFinished);
+    void parseGeometryFlow(Callback_ObjectsReady onObjectsReady, Callback_ParseFinished onParseFinished);
+
+    /**
+     * @brief parseGeometryFlowProgressive
+     * Parse geometry in two passes: a coarse tessellation of all the objects to get an interactive model quickly,
+     * then a full quality tessellation of the objects with curved geometry, whose meshes replace the coarse ones
+     * @param onObjectReady: callback function when the coarse geometry of one object is ready to render
+     * @param onObjectRefined: callback function when the full quality geometry of a curved object is ready
+     * @param onCoarseFinished: callback function when the coarse pass is done, ie. the model is interactive
+     * @param onParseFinished: callback function when both passes are done, failed if the curved objects were not refined
+     */
+    void parseGeometryFlowProgressive(Callback_ObjectReady onObjectReady, Callback_ObjectReady onObjectRefined,
+                                      Callback_ParseFinished onCoarseFinished, Callback_ParseFinished onParseFinished);
+    void parseGeometryFlowProgressive(Callback_ObjectsReady onObjectsReady, Callback_ObjectsReady onObjectsRefined,
+                                      Callback_ParseFinished onCoarseFinished, Callback_ParseFinished onParseFinished);
+
+    /**
+     * @brief parseStoreysGeometryFlow
+     * Same as parseGeometryFlow, restricted to the objects contained in the given storeys
+     * @param storeyGuids: GUIDs of the storeys (IfcBuildingStorey) to load
+     */
+    void parseStoreysGeometryFlow(const std::vector<std::string>& storeyGuids,
+                                  Callback_ObjectReady onObjectReady, Callback_ParseFinished onParseFinished);
+    void parseStoreysGeometryFlow(const std::vector<std::string>& storeyGuids,
+                                  Callback_ObjectsReady onObjectsReady, Callback_ParseFinished onParseFinished);
+
+    /**
+     * Pull based counterparts of the flow functions: the load runs on the TaskScheduler and posts batches
+     * of objects (see setBatchDelivery) into the returned stream, pausing while maxQueuedBatches are waiting.
+     * The geometry iterator runs over windows of about one batch of products (IfcGeometryParser::Options::windowSize),
+     * so the tessellated geometry held by the load stays within a few batches more than the queue.
+     * Destroying the stream cancels the load; the parser must outlive the load, see IfcGeometryStream::isStopped.
+     */
+    std::unique_ptr<IfcGeometryStream> openGeometryStream(size_t maxQueuedBatches = 4);
+    std::unique_ptr<IfcGeometryStream> openGeometryStreamProgressive(size_t maxQueuedBatches = 4);
+    std::unique_ptr<IfcGeometryStream> openStoreysGeometryStream(const std::vector<std::string>& storeyGuids,
+                                                                 size_t maxQueuedBatches = 4);
+
+    /**
+     * Objects contained in the given storeys, resolved by the structure builder
+     * @return GUIDs of the contained objects, including aggregated parts
+     */
+    std::vector<std::string> objectGuidsOfStoreys(const std::vector<std::string>& storeyGuids);
+
+private:
+    IfcParse::IfcFile& ifcFile();
+    std::unique_ptr<DataNode::Base> buildTree();
+    // The tree of the scene cache if valid, else built from the file
+    std::unique_ptr<DataNode::Base> readOrBuildTree();
+    // Accessors of the schema of the file, throws if the schema is not supported
+    std::unique_ptr<IfcSchemaStrategyBase> createSchemaStrategy();
+    static void indexStoreys(DataNode::Base* pNode, StoreyIndex& index);
+
+    // Null when the cache is disabled, does not apply to the current options, or is missing or stale
+    std::unique_ptr<IfcSceneCacheReader> openSceneCache();
+    std::shared_ptr<IfcSceneCacheWriter> createSceneCacheWriter();
+    bool sceneCacheApplies();
+    uint64_t settingsHash() const;
+
+    // Post the cached objects into the stream, false if there is no valid cache
+    bool streamFromSceneCache(IfcGeometryStream& stream, const std::unordered_set<std::string>* pGuids, bool progressive);
+    // Commit the cache before reporting a successful, complete load
+    Callback_ParseFinished commitSceneCache(std::shared_ptr<IfcSceneCacheWriter> spWriter, IfcGeometryStream& stream,
+                                            Callback_ParseFinished onParseFinished);
+
+    // Flow processor delivering objects one by one or in batches
+    IfcElemProcessorMeshFlow createFlowProcessor(Callback_ObjectReady onObjectReady, Callback_ParseFinished onParseFinished) const;
+    IfcElemProcessorMeshFlow createFlowProcessor(Callback_ObjectsReady onObjectsReady, Callback_ParseFinished onParseFinished) const;
+
+    template<typename Callback>
+    void parseGeometryFlowImpl(const IfcGeometryParser::Options& options,
+                               Callback onReady, Callback_ParseFinished onParseFinished);
+    template<typename Callback>
+    void parseGeometryFlowProgressiveImpl(const IfcGeometryParser::Options& options, Callback onReady, Callback onRefined,
+                                          Callback_ParseFinished onCoarseFinished, Callback_ParseFinished onParseFinished);
+    template<typename Callback>
+    void parseStoreysGeometryFlowImpl(const IfcGeometryParser::Options& options, const std::vector<std::string>& storeyGuids,
+                                      Callback onReady, Callback_ParseFinished onParseFinished);
+
+    // Stream whose load is cancelled with it, the producer receives the options to load with
+    std::unique_ptr<IfcGeometryStream> openStream(size_t maxQueuedBatches,
+                                                  std::function<void(IfcGeometryStream&, const IfcGeometryParser::Options&)> producer);
 
 };
 
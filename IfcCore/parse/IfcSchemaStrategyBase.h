@@ -19,6 +19,9 @@ public:
     virtual void extractRelationship_Aggregates(IfcParse::IfcFile& file, HashRel& map) const = 0;
     virtual void extractRelationship_Voids(IfcParse::IfcFile& file, HashRel& map) const = 0;
 
+    // Material name of the objects associated with IfcRelAssociatesMaterial, by GUID
+    virtual void extractMaterials(IfcParse::IfcFile& file, std::unordered_map<std::string, std::string>& materialsByGuid) const = 0;
+
     // --- Instance Getters and Type Checks ---
     virtual void getProjects(IfcParse::IfcFile& file, std::vector<IfcUtil::IfcBaseClass*>& ifcProjects) const = 0;
     virtual bool isStorey(IfcUtil::IfcBaseClass* obj) const = 0;
@@ -28,6 +31,9 @@ public:
     virtual std::string getName(IfcUtil::IfcBaseClass* obj) const = 0;
     virtual std::string getTypeName(IfcUtil::IfcBaseClass* obj) const = 0;
     virtual std::optional<double> getStoreyElevation(IfcUtil::IfcBaseClass* obj) const = 0;
+
+    // Metres per length unit of the project (IfcUnitAssignment), 1 if it has none
+    virtual double getLengthUnitScale(IfcParse::IfcFile& file) const = 0;
 };
 
 #endif // IFCSCHEMA_STRATEGY_BASE_H
@@ -58,6 +58,17 @@ public:
         }
     }
 
+    void extractMaterials(IfcParse::IfcFile& ifcFile, std::unordered_map<std::string, std::string>& materialsByGuid) const override {
+        auto pRelsMaterial = ifcFile.instances_by_type<typename Schema::IfcRelAssociatesMaterial>();
+        for (auto pRel : *pRelsMaterial) {
+            auto material = getMaterialName(pRel->RelatingMaterial());
+
+            //the first association of an object wins, materials of type objects are not inherited
+            for (auto pRelated : *(pRel->RelatedObjects()))
+                materialsByGuid.emplace(getGlobalId(pRelated), material);
+        }
+    }
+
     void getProjects(IfcParse::IfcFile& file, std::vector<IfcUtil::IfcBaseClass*>& ifcProjects) const override {
 
         if (auto pContainer = file.instances_by_type<typename Schema::IfcProject>()) {
@@ -98,6 +109,95 @@ public:
         return std::nullopt;
     }
 
+    double getLengthUnitScale(IfcParse::IfcFile& file) const override {
+        auto pProjects = file.instances_by_type<typename Schema::IfcProject>();
+        if (!pProjects || pProjects->size() == 0)
+            return 1.0;
+        auto pAssignment = (*pProjects->begin())->UnitsInContext();
+        if (!pAssignment)
+            return 1.0;
+
+        for (auto pUnit : *(pAssignment->Units())) {
+            if (auto pSIUnit = pUnit->template as<typename Schema::IfcSIUnit>()) {
+                if (isLengthUnit(pSIUnit->UnitType()))
+                    return getPrefixScale(pSIUnit);
+            }
+            else if (auto pConversionUnit = pUnit->template as<typename Schema::IfcConversionBasedUnit>()) {
+                if (!isLengthUnit(pConversionUnit->UnitType()))
+                    continue;
+                //eg. foot: 0.3048 of the metre unit component
+                auto pFactor = pConversionUnit->ConversionFactor();
+                double factor = 1.0;
+                if (auto pLength = pFactor->ValueComponent()->template as<typename Schema::IfcLengthMeasure>())
+                    factor = *pLength;
+                else if (auto pRatio = pFactor->ValueComponent()->template as<typename Schema::IfcRatioMeasure>())
+                    factor = *pRatio;
+                if (auto pComponent = pFactor->UnitComponent()->template as<typename Schema::IfcSIUnit>())
+                    factor *= getPrefixScale(pComponent);
+                return factor;
+            }
+        }
+        return 1.0;
+    }
+
+private:
+    static bool isLengthUnit(typename Schema::IfcUnitEnum::Value unitType) {
+        return std::string(Schema::IfcUnitEnum::ToString(unitType)) == "LENGTHUNIT";
+    }
+
+    static double getPrefixScale(typename Schema::IfcSIUnit* pUnit) {
+        if (!pUnit->Prefix())
+            return 1.0;
+        static const std::unordered_map<std::string, double> scales{
+            {"EXA", 1e18}, {"PETA", 1e15}, {"TERA", 1e12}, {"GIGA", 1e9}, {"MEGA", 1e6}, {"KILO", 1e3}, {"HECTO", 1e2}, {"DECA", 1e1},
+            {"DECI", 1e-1}, {"CENTI", 1e-2}, {"MILLI", 1e-3}, {"MICRO", 1e-6}, {"NANO", 1e-9}, {"PICO", 1e-12}, {"FEMTO", 1e-15}, {"ATTO", 1e-18}};
+        auto it = scales.find(Schema::IfcSIPrefix::ToString(*pUnit->Prefix()));
+        return it != scales.end() ? it->second : 1.0;
+    }
+
+    // Name of a material select: the material, the layer set name or the joined names of its materials
+    std::string getMaterialName(IfcUtil::IfcBaseClass* obj) const {
+        if (!obj)
+            return "";
+
+        auto joinNames = [this](const auto& pItems) {
+            std::string names;
+            if (pItems)
+                for (auto pItem : *pItems) {
+                    auto name = getMaterialName(pItem);
+                    if (!name.empty())
+                        names += (names.empty() ? "" : " / ") + name;
+                }
+            return names;
+        };
+
+        if (auto pMaterial = obj->as<typename Schema::IfcMaterial>())
+            return pMaterial->Name();
+        if (auto pLayer = obj->as<typename Schema::IfcMaterialLayer>())
+            return getMaterialName(pLayer->Material());
+        if (auto pUsage = obj->as<typename Schema::IfcMaterialLayerSetUsage>())
+            return getMaterialName(pUsage->ForLayerSet());
+        if (auto pLayerSet = obj->as<typename Schema::IfcMaterialLayerSet>())
+            return pLayerSet->LayerSetName() ? std::string(*pLayerSet->LayerSetName()) : joinNames(pLayerSet->MaterialLayers());
+        if (auto pList = obj->as<typename Schema::IfcMaterialList>())
+            return joinNames(pList->Materials());
+
+        //constituent and profile sets were introduced with IFC4
+        if constexpr (requires { typename Schema::IfcMaterialConstituentSet; }) {
+            if (auto pConstituentSet = obj->as<typename Schema::IfcMaterialConstituentSet>())
+                return pConstituentSet->Name().value_or(joinNames(pConstituentSet->MaterialConstituents()));
+            if (auto pConstituent = obj->as<typename Schema::IfcMaterialConstituent>())
+                return getMaterialName(pConstituent->Material());
+            if (auto pProfileUsage = obj->as<typename Schema::IfcMaterialProfileSetUsage>())
+                return getMaterialName(pProfileUsage->ForProfileSet());
+            if (auto pProfileSet = obj->as<typename Schema::IfcMaterialProfileSet>())
+                return pProfileSet->Name().value_or(joinNames(pProfileSet->MaterialProfiles()));
+            if (auto pProfile = obj->as<typename Schema::IfcMaterialProfile>())
+                return getMaterialName(pProfile->Material());
+        }
+        return getTypeName(obj);
+    }
+
 };
 
 #endif // IFCSCHEMA_STRATEGY_IMPL_H
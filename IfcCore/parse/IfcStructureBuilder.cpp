@@ -1,4 +1,5 @@
 #include "IfcStructureBuilder.h"
+#include "TaskScheduler.h"
 
 IfcStructureBuilder::IfcStructureBuilder() {}
 
@@ -15,7 +16,7 @@ std::unique_ptr<DataNode::Base> IfcStructureBuilder::buildTreeByStorey (
 
     strategy.extractRelationship_Contains(ifcFile, hashRelContains);
     strategy.extractRelationship_Aggregates(ifcFile, hashRelAggregates);
-    strategy.extractRelationship_Voids(ifcFile, hashRelAggregates);
+    strategy.extractRelationship_Voids(ifcFile, hashRelVoids);
 
 
     //comparation class to compare unique pointer of Storey
@@ -114,26 +115,37 @@ std::unique_ptr<DataNode::Base> IfcStructureBuilder::buildTreeByStorey (
     }
 
     //complete structural tree: storey nodes and ifcClass nodes
+    //storey subtrees are independent: build them in parallel, then attach them in elevation order
+    std::vector<std::pair<DataNode::Base*, const DataNode::Storey*>> storeys;
     for (const auto& pair : map_pBuilding_upStoreySet)
-    {
-        auto pBuildingNode = pair.first;
         for (const auto& upStorey : pair.second)
+            storeys.emplace_back(pair.first, upStorey.get());
+
+    std::vector<std::unique_ptr<DataNode::Base>> storeyNodes(storeys.size());
+    TaskScheduler::instance().parallelFor(0, storeys.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
         {
-            //create storey node and add to building node
-            auto pStoreyNode = pBuildingNode->addChild( make_unique<DataNode::IfcObject>(upStorey->m_guid, upStorey->m_name, "IfcBuildingStorey") );
+            const auto pStorey = storeys[i].second;
+
+            //create storey node
+            auto upStoreyNode = make_unique<DataNode::IfcObject>(pStorey->m_guid, pStorey->m_name, "IfcBuildingStorey");
 
             //create ifcClass nodes and add to storey node
-            for (auto pair2 : upStorey->m_objectGuidsNamesByType)
+            for (const auto& pair2 : pStorey->m_objectGuidsNamesByType)
             {
-                auto pClassNode = pStoreyNode->addChild( make_unique<DataNode::IfcClass>(pair2.first, pair2.second.size()) );
+                auto pClassNode = upStoreyNode->addChild( make_unique<DataNode::IfcClass>(pair2.first, pair2.second.size()) );
 
                 //create ifcObject nodes of the same ifc class
                 for (const auto& pair_guid_name : pair2.second)
                     pClassNode->addChild( make_unique<DataNode::IfcObject>(pair_guid_name.first, pair_guid_name.second, pair2.first));
-
             }
+            storeyNodes[i] = std::move(upStoreyNode);
         }
-    }
+    });
+
+    //add storey nodes to building nodes
+    for (size_t i = 0; i < storeys.size(); ++i)
+        storeys[i].first->addChild(std::move(storeyNodes[i]));
 
     return spRootNode;
 }
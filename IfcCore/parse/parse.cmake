@@ -3,6 +3,8 @@ set(
     ${CMAKE_CURRENT_LIST_DIR}/parse.cmake
     ${CMAKE_CURRENT_LIST_DIR}/IfcParser.h
     ${CMAKE_CURRENT_LIST_DIR}/IfcParser.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcGeometryStream.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcGeometryStream.cpp
     ${CMAKE_CURRENT_LIST_DIR}/IfcSchemaStrategyBase.h
     ${CMAKE_CURRENT_LIST_DIR}/IfcSchemaStrategyImpl.h
     ${CMAKE_CURRENT_LIST_DIR}/IfcStructureBuilder.cpp
@@ -0,0 +1,95 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+/*
+ * Blocking FIFO with a fixed capacity, connecting one or more producers to a consumer.
+ * Producers wait while the queue is full, which throttles them to the pace of the consumer.
+ * After close(), pushes are refused and pops drain the remaining items.
+ */
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : m_capacity(capacity > 0 ? capacity : 1) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Wait for a free slot, return false if the queue was closed
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this]() { return m_closed || m_items.size() < m_capacity; });
+        if(m_closed)
+            return false;
+        m_items.push_back(std::move(item));
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // Wait for an item, empty once the queue is closed and drained
+    std::optional<T> pop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this]() { return m_closed || !m_items.empty(); });
+        return takeFront(lock);
+    }
+
+    // Return immediately, empty if no item is queued
+    std::optional<T> tryPop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return takeFront(lock);
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    bool isClosed() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
+    }
+
+    // Closed and nothing left to pop
+    bool isDrained() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed && m_items.empty();
+    }
+
+private:
+    const size_t m_capacity;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+    std::deque<T> m_items;
+    bool m_closed = false;
+
+    std::optional<T> takeFront(std::unique_lock<std::mutex>& lock)
+    {
+        if(m_items.empty())
+            return std::nullopt;
+        std::optional<T> item(std::move(m_items.front()));
+        m_items.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        return item;
+    }
+};
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,281 @@
+#include "TaskScheduler.h"
+
+#include <chrono>
+#include <iterator>
+
+namespace {
+    // Index of the worker running on the current thread, -1 outside of the workers
+    thread_local int t_workerIndex = -1;
+    thread_local const TaskScheduler* t_pScheduler = nullptr;
+
+    std::mutex g_instanceMutex;
+    std::unique_ptr<TaskScheduler> g_upInstance;
+}
+
+//-------------------- TaskScheduler -------------------------//
+
+TaskScheduler& TaskScheduler::instance()
+{
+    std::lock_guard<std::mutex> lock(g_instanceMutex);
+    if(!g_upInstance)
+        g_upInstance = std::make_unique<TaskScheduler>(resolveWorkerCount(0, 0));
+    return *g_upInstance;
+}
+
+void TaskScheduler::configure(int nWorkers, int nReservedCores)
+{
+    std::lock_guard<std::mutex> lock(g_instanceMutex);
+    int n = resolveWorkerCount(nWorkers, nReservedCores);
+    if(g_upInstance && g_upInstance->workerCount() == n)
+        return;
+
+    g_upInstance.reset(); // joins the current workers
+    g_upInstance = std::make_unique<TaskScheduler>(n);
+}
+
+int TaskScheduler::resolveWorkerCount(int nWorkers, int nReservedCores)
+{
+    if(nWorkers <= 0)
+        nWorkers = static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(1, nWorkers - std::max(0, nReservedCores));
+}
+
+TaskScheduler::TaskScheduler(int nWorkers)
+{
+    start(std::max(1, nWorkers));
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    stop();
+}
+
+void TaskScheduler::start(int nWorkers)
+{
+    m_stop = false;
+    for(int i = 0; i < nWorkers; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+
+    //start the threads once all the deques exist, as they steal from each other
+    for(int i = 0; i < nWorkers; ++i)
+        m_workers[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i);
+}
+
+void TaskScheduler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_sleepCondition.notify_all();
+
+    for(auto& upWorker : m_workers)
+        if(upWorker->thread.joinable())
+            upWorker->thread.join();
+    m_workers.clear();
+}
+
+void TaskScheduler::submit(Task task)
+{
+    submit(std::move(task), nullptr);
+}
+
+void TaskScheduler::submit(Task task, const TaskGroup* pGroup)
+{
+    if(t_pScheduler == this && t_workerIndex >= 0)
+    {
+        //from a worker: keep it local, it is the most likely to be cache-warm
+        auto& worker = *m_workers[t_workerIndex];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back({std::move(task), pGroup});
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_injectionMutex);
+        m_injectionQueue.push_back({std::move(task), pGroup});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_nQueued++;
+    }
+    m_sleepCondition.notify_one();
+}
+
+void TaskScheduler::submitAfter(std::chrono::milliseconds delay, Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_timedTasks.emplace(std::chrono::steady_clock::now() + delay, std::move(task));
+        m_nTimed++;
+    }
+    //a sleeping worker takes the new deadline into account
+    m_sleepCondition.notify_one();
+}
+
+bool TaskScheduler::submitDueTask()
+{
+    Task task;
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        if(m_timedTasks.empty() || m_timedTasks.begin()->first > std::chrono::steady_clock::now())
+            return false;
+        task = std::move(m_timedTasks.begin()->second);
+        m_timedTasks.erase(m_timedTasks.begin());
+        m_nTimed--;
+    }
+    submit(std::move(task));
+    return true;
+}
+
+bool TaskScheduler::popTask(int index, const TaskGroup* pGroup, Task& task)
+{
+    //workers take any task, group waiters only the tasks of their group
+    auto matches = [pGroup](const QueuedTask& queued) { return !pGroup || queued.pGroup == pGroup; };
+    auto take = [&matches, &task](std::deque<QueuedTask>& tasks, bool fromBack) {
+        auto it = tasks.end();
+        if(fromBack)
+        {
+            auto itReverse = std::find_if(tasks.rbegin(), tasks.rend(), matches);
+            if(itReverse != tasks.rend())
+                it = std::prev(itReverse.base());
+        }
+        else
+            it = std::find_if(tasks.begin(), tasks.end(), matches);
+        if(it == tasks.end())
+            return false;
+
+        task = std::move(it->task);
+        tasks.erase(it);
+        return true;
+    };
+
+    //own tasks, newest first
+    if(index >= 0)
+    {
+        auto& worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if(take(worker.tasks, true))
+            return true;
+    }
+
+    //tasks submitted from outside
+    {
+        std::lock_guard<std::mutex> lock(m_injectionMutex);
+        if(take(m_injectionQueue, false))
+            return true;
+    }
+
+    //steal the oldest task of another worker
+    const int n = workerCount();
+    const int first = index >= 0 ? index + 1 : 0;
+    for(int i = 0; i < n; ++i)
+    {
+        auto& victim = *m_workers[(first + i) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(take(victim.tasks, false))
+            return true;
+    }
+    return false;
+}
+
+bool TaskScheduler::runPendingTask(const TaskGroup* pGroup)
+{
+    int index = (t_pScheduler == this) ? t_workerIndex : -1;
+
+    Task task;
+    if(!popTask(index, pGroup, task))
+        return false;
+
+    m_nQueued--;
+    task();
+    return true;
+}
+
+void TaskScheduler::workerLoop(int index)
+{
+    t_workerIndex = index;
+    t_pScheduler = this;
+
+    while(true)
+    {
+        if(m_nTimed > 0 && submitDueTask())
+            continue;
+        if(runPendingTask())
+            continue;
+
+        //sleep until a task is queued, or the first timed task is due
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        if(m_stop && m_nQueued <= 0)
+            break;
+        if(m_nQueued > 0)
+            continue;
+        if(m_timedTasks.empty())
+            m_sleepCondition.wait(lock);
+        else
+            m_sleepCondition.wait_until(lock, m_timedTasks.begin()->first);
+    }
+
+    t_workerIndex = -1;
+    t_pScheduler = nullptr;
+}
+
+//-------------------- TaskGroup -------------------------//
+
+TaskGroup::~TaskGroup()
+{
+    //tasks refer to the group, never leave them behind
+    helpUntilPending(0);
+}
+
+void TaskGroup::run(TaskScheduler::Task task)
+{
+    m_nPending++;
+    m_scheduler.submit([this, task = std::move(task)]() {
+        try {
+            task();
+        }
+        catch(...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_error)
+                m_error = std::current_exception();
+        }
+
+        //throttled producers wait for less than all the tasks
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_nPending--;
+        m_doneCondition.notify_all();
+    }, this);
+}
+
+void TaskGroup::helpUntilPending(int maxPending)
+{
+    //help with the tasks of the group instead of blocking, they may be queued behind the current one
+    while(m_nPending > maxPending)
+    {
+        if(m_scheduler.runPendingTask(this))
+            continue;
+
+        //the remaining tasks are running on other threads, and may still add tasks to the group
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait_for(lock, std::chrono::milliseconds(1), [this, maxPending]() { return m_nPending <= maxPending; });
+    }
+}
+
+void TaskGroup::waitUntilPending(int maxPending)
+{
+    helpUntilPending(std::max(maxPending, 0));
+}
+
+void TaskGroup::wait()
+{
+    helpUntilPending(0);
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::swap(error, m_error);
+    }
+    if(error)
+        std::rethrow_exception(error);
+}
@@ -0,0 +1,176 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskGroup;
+
+/*
+ * Work-stealing task scheduler shared by all IfcCore work.
+ * Each worker owns a deque: it pushes and pops its own tasks at the back,
+ * idle workers steal from the front of the others. Tasks submitted from
+ * outside the workers go to a shared injection queue.
+ */
+class TaskScheduler
+{
+public:
+    using Task = std::function<void()>;
+
+    // Scheduler shared by IfcCore, started with one worker per core on first use
+    static TaskScheduler& instance();
+
+    /**
+     * Set the worker budget of the shared scheduler.
+     * Must not be called while tasks are running.
+     * @param nWorkers: number of workers, 0 for one per hardware thread
+     * @param nReservedCores: cores left free, eg. for the UI thread; at least one worker is kept
+     */
+    static void configure(int nWorkers, int nReservedCores = 0);
+
+    explicit TaskScheduler(int nWorkers);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    int workerCount() const { return static_cast<int>(m_workers.size()); }
+
+    void submit(Task task);
+
+    // Submit the task once the delay elapsed; taken by an idle worker, later if all of them are busy. Dropped on stop
+    void submitAfter(std::chrono::milliseconds delay, Task task);
+
+    // Run a callable on the scheduler, its result or exception is delivered through the future
+    template<typename Func>
+    auto async(Func&& func) -> std::future<decltype(func())>
+    {
+        using Result = decltype(func());
+        auto spTask = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+        auto future = spTask->get_future();
+        submit([spTask]() { (*spTask)(); });
+        return future;
+    }
+
+    /**
+     * Run one pending task on the calling thread, return false if there was none
+     * @param pGroup: only a task of this group, null for any task. A thread waiting for something
+     * must not take unrelated tasks, they may be long or block on what the thread would deliver next
+     */
+    bool runPendingTask(const TaskGroup* pGroup = nullptr);
+
+    /**
+     * Split [begin, end) into chunks of at least grain indices, run func(first, last) on each chunk
+     * and wait for all of them. The calling thread takes part in the work.
+     */
+    template<typename Func>
+    void parallelFor(size_t begin, size_t end, size_t grain, Func&& func);
+
+private:
+    friend class TaskGroup;
+
+    struct QueuedTask {
+        Task task;
+        const TaskGroup* pGroup = nullptr; // group the task belongs to, if any
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<QueuedTask> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::mutex m_injectionMutex;
+    std::deque<QueuedTask> m_injectionQueue;
+
+    std::atomic<int> m_nQueued{0};
+    std::atomic<bool> m_stop{false};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+    std::multimap<std::chrono::steady_clock::time_point, Task> m_timedTasks; // guarded by m_sleepMutex
+    std::atomic<int> m_nTimed{0};
+
+    void start(int nWorkers);
+    void stop();
+    void workerLoop(int index);
+    void submit(Task task, const TaskGroup* pGroup);
+    bool popTask(int index, const TaskGroup* pGroup, Task& task);
+    // Move the timed task due first to the queues, false if none is due
+    bool submitDueTask();
+
+    static int resolveWorkerCount(int nWorkers, int nReservedCores);
+};
+
+/*
+ * Set of tasks which can be waited for together.
+ * The waiting thread executes the pending tasks of the group instead of blocking, so that
+ * groups can be nested inside tasks without starving the workers. It never runs the tasks
+ * of other groups or of submit: the GUI thread waits on groups too.
+ */
+class TaskGroup
+{
+public:
+    explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::instance()) : m_scheduler(scheduler) {}
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(TaskScheduler::Task task);
+
+    // Wait for all the tasks of the group, rethrow the first exception thrown by one of them
+    void wait();
+
+    // Wait until at most maxPending tasks of the group are left, eg. to throttle a producer; exceptions are kept for wait
+    void waitUntilPending(int maxPending);
+
+private:
+    TaskScheduler& m_scheduler;
+    std::atomic<int> m_nPending{0};
+    std::mutex m_mutex;
+    std::condition_variable m_doneCondition;
+    std::exception_ptr m_error;
+
+    void helpUntilPending(int maxPending);
+};
+
+template<typename Func>
+void TaskScheduler::parallelFor(size_t begin, size_t end, size_t grain, Func&& func)
+{
+    if(end <= begin)
+        return;
+
+    grain = std::max<size_t>(grain, 1);
+    const size_t count = end - begin;
+    const size_t maxChunks = static_cast<size_t>(workerCount() + 1) * 4;
+    const size_t chunkSize = std::max(grain, (count + maxChunks - 1) / maxChunks);
+
+    if(chunkSize >= count)
+    {
+        func(begin, end);
+        return;
+    }
+
+    TaskGroup group(*this);
+    for(size_t first = begin + chunkSize; first < end; first += chunkSize)
+    {
+        size_t last = std::min(end, first + chunkSize);
+        group.run([&func, first, last]() { func(first, last); });
+    }
+    func(begin, begin + chunkSize);
+    group.wait();
+}
+
+#endif // TASKSCHEDULER_H
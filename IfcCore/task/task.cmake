@@ -0,0 +1,9 @@
+set(
+    TASK_SOURCES
+    ${CMAKE_CURRENT_LIST_DIR}/task.cmake
+    ${CMAKE_CURRENT_LIST_DIR}/TaskScheduler.h
+    ${CMAKE_CURRENT_LIST_DIR}/TaskScheduler.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/BoundedQueue.h
+)
+
+source_group(task FILES ${TASK_SOURCES})
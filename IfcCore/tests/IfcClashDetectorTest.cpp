@@ -0,0 +1,94 @@
+#include "IfcClashDetector.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    int g_nFailures = 0;
+
+    void check(bool condition, const char* what) {
+        if (!condition) {
+            std::printf("FAILED: %s\n", what);
+            g_nFailures++;
+        }
+    }
+
+    // Closed box of 12 outward facing triangles, in world coordinates
+    SceneData::Object box(const std::string& guid, const std::string& type,
+                          float x0, float y0, float z0, float x1, float y1, float z1) {
+        const SceneData::Vec3f p[8] = {{x0, y0, z0}, {x1, y0, z0}, {x1, y1, z0}, {x0, y1, z0},
+                                       {x0, y0, z1}, {x1, y0, z1}, {x1, y1, z1}, {x0, y1, z1}};
+        const int faces[12][3] = {{0, 2, 1}, {0, 3, 2}, {4, 5, 6}, {4, 6, 7}, {0, 1, 5}, {0, 5, 4},
+                                  {1, 2, 6}, {1, 6, 5}, {2, 3, 7}, {2, 7, 6}, {3, 0, 4}, {3, 4, 7}};
+        SceneData::Mesh mesh;
+        for (const auto& face : faces)
+            for (int k : face) {
+                mesh.vertices.push_back(p[k]);
+                mesh.normals.push_back({0.0f, 0.0f, 1.0f});
+            }
+
+        SceneData::Object object;
+        object.guid = guid;
+        object.type = type;
+        object.meshes = std::make_shared<std::vector<SceneData::Mesh>>(1, std::move(mesh));
+        return object;
+    }
+
+    std::vector<IfcClashDetector::Clash> detect(const SceneData::Object& a, const SceneData::Object& b, double clearance = 0.0) {
+        IfcClashDetector::Options options;
+        options.clearance = clearance;
+        IfcClashDetector detector(options);
+        return detector.detect({a, b});
+    }
+
+    bool near(double value, double expected) { return std::abs(value - expected) < 1e-3; }
+
+    //a pipe 10 cm into a 20 cm wall: only the pipe's side faces cross, the wall face is flat
+    void testPartialPenetration() {
+        auto clashes = detect(box("wall", "IfcWall", 0.0f, -2.0f, 0.0f, 0.2f, 2.0f, 3.0f),
+                              box("pipe", "IfcPipeSegment", -1.0f, -0.05f, 1.0f, 0.1f, 0.05f, 1.1f));
+        check(clashes.size() == 1, "pipe into wall is one clash");
+        if (clashes.size() == 1) {
+            check(clashes[0].type == IfcClashDetector::Type::Hard, "pipe into wall is a hard clash");
+            check(near(clashes[0].penetration, 0.1), "pipe into wall penetrates 0.1");
+        }
+
+        auto beamClashes = detect(box("column", "IfcColumn", 0.0f, 0.0f, 0.0f, 0.3f, 0.3f, 3.0f),
+                                  box("beam", "IfcBeam", 0.2f, 0.05f, 2.6f, 4.0f, 0.25f, 3.0f));
+        check(beamClashes.size() == 1 && beamClashes[0].type == IfcClashDetector::Type::Hard, "beam into column is a hard clash");
+        if (beamClashes.size() == 1)
+            check(near(beamClashes[0].penetration, 0.1), "beam into column penetrates 0.1");
+    }
+
+    //a wall standing on a slab only touches it
+    void testTouching() {
+        auto clashes = detect(box("slab", "IfcSlab", -5.0f, -5.0f, -0.3f, 5.0f, 5.0f, 0.0f),
+                              box("wall", "IfcWall", 0.0f, -2.0f, 0.0f, 0.2f, 2.0f, 3.0f));
+        check(clashes.empty(), "wall on slab is no clash");
+    }
+
+    void testContainment() {
+        auto clashes = detect(box("wall", "IfcWall", 0.0f, -2.0f, 0.0f, 0.4f, 2.0f, 3.0f),
+                              box("pipe", "IfcPipeSegment", 0.1f, -0.05f, 1.0f, 0.3f, 0.05f, 1.1f));
+        check(clashes.size() == 1 && clashes[0].type == IfcClashDetector::Type::Hard, "pipe inside wall is a hard clash");
+    }
+
+    void testClearance() {
+        auto clashes = detect(box("wall", "IfcWall", 0.0f, -2.0f, 0.0f, 0.2f, 2.0f, 3.0f),
+                              box("pipe", "IfcPipeSegment", -1.0f, -0.05f, 1.0f, -0.05f, 0.05f, 1.1f), 0.1);
+        check(clashes.size() == 1 && clashes[0].type == IfcClashDetector::Type::Clearance, "pipe near wall is a clearance clash");
+        if (clashes.size() == 1)
+            check(near(clashes[0].distance, 0.05), "pipe is 0.05 from the wall");
+    }
+}
+
+int main()
+{
+    testPartialPenetration();
+    testTouching();
+    testContainment();
+    testClearance();
+    if (g_nFailures)
+        std::printf("%d checks failed\n", g_nFailures);
+    return g_nFailures ? 1 : 0;
+}
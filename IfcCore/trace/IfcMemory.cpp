@@ -0,0 +1,123 @@
+#include "IfcMemory.h"
+#include "MeshCodec.h"
+
+#include <cstdio>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace {
+    // Heap block of a string, none while it fits the small string buffer
+    size_t stringBytes(const std::string& text) {
+        return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+    }
+
+    // Deleter of the tracked mesh sets, found back with std::get_deleter
+    struct TrackedMeshesDeleter {
+        size_t bytes = 0;
+        bool instanced = false;
+
+        void operator()(std::vector<SceneData::Mesh>* pMeshes) const {
+            IfcMemory::add(instanced ? IfcMemory::Category::SharedMeshes : IfcMemory::Category::UniqueMeshes,
+                           -static_cast<int64_t>(bytes));
+            delete pMeshes;
+        }
+    };
+}
+
+const char* IfcMemory::name(Category category)
+{
+    switch (category) {
+    case Category::IfcFile: return "IfcFile";
+    case Category::StructureTree: return "structure tree";
+    case Category::UniqueMeshes: return "unique meshes";
+    case Category::SharedMeshes: return "shared meshes";
+    case Category::GpuBuffers: return "GPU buffers";
+    default: return "";
+    }
+}
+
+std::string IfcMemory::summary()
+{
+    char text[96];
+    std::string out;
+    for (size_t i = 0; i < index(Category::Count); ++i) {
+        auto category = static_cast<Category>(i);
+        std::snprintf(text, sizeof(text), "%s%s %.1f MB", out.empty() ? "" : ", ", name(category), bytes(category) / 1048576.0);
+        out += text;
+    }
+    std::snprintf(text, sizeof(text), "; process resident %.1f MB", residentBytes() / 1048576.0);
+    return out + text;
+}
+
+size_t IfcMemory::residentBytes()
+{
+#if defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+        return 0;
+    return static_cast<size_t>(info.resident_size);
+#elif defined(__linux__)
+    long pages = 0, residentPages = 0;
+    FILE* pFile = std::fopen("/proc/self/statm", "r");
+    if (!pFile)
+        return 0;
+    int nRead = std::fscanf(pFile, "%ld %ld", &pages, &residentPages);
+    std::fclose(pFile);
+    return nRead == 2 ? static_cast<size_t>(residentPages) * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+size_t IfcMemory::treeBytes(DataNode::Base* pRoot)
+{
+    if (!pRoot)
+        return 0;
+
+    size_t bytes = 0;
+    if (auto pObject = pRoot->as<DataNode::IfcObject>())
+        bytes += sizeof(DataNode::IfcObject) + stringBytes(pObject->m_guid) + stringBytes(pObject->m_name) + stringBytes(pObject->m_ifcClass);
+    else if (auto pClass = pRoot->as<DataNode::IfcClass>())
+        bytes += sizeof(DataNode::IfcClass) + stringBytes(pClass->m_ifcClass);
+    else
+        bytes += sizeof(DataNode::Base);
+
+    const auto& children = pRoot->getChildren();
+    bytes += children.capacity() * sizeof(children[0]);
+    for (const auto& upChild : children)
+        bytes += treeBytes(upChild.get());
+    return bytes;
+}
+
+size_t IfcMemory::meshBytes(const std::vector<SceneData::Mesh>& meshes)
+{
+    size_t bytes = sizeof(meshes) + meshes.capacity() * sizeof(SceneData::Mesh);
+    for (const auto& mesh : meshes)
+        bytes += MeshCodec::vertexBytes(mesh);
+    return bytes;
+}
+
+std::shared_ptr<std::vector<SceneData::Mesh>> IfcMemory::trackMeshes(std::vector<SceneData::Mesh>&& meshes)
+{
+    TrackedMeshesDeleter deleter;
+    deleter.bytes = meshBytes(meshes);
+    add(Category::UniqueMeshes, static_cast<int64_t>(deleter.bytes));
+    return std::shared_ptr<std::vector<SceneData::Mesh>>(new std::vector<SceneData::Mesh>(std::move(meshes)), deleter);
+}
+
+void IfcMemory::markInstanced(const std::shared_ptr<std::vector<SceneData::Mesh>>& spMeshes)
+{
+    // Called by the producer of the mesh set while it holds a reference, the deleter cannot run meanwhile
+    auto pDeleter = std::get_deleter<TrackedMeshesDeleter>(spMeshes);
+    if (!pDeleter || pDeleter->instanced)
+        return;
+
+    pDeleter->instanced = true;
+    add(Category::UniqueMeshes, -static_cast<int64_t>(pDeleter->bytes));
+    add(Category::SharedMeshes, static_cast<int64_t>(pDeleter->bytes));
+}
@@ -0,0 +1,55 @@
+#ifndef IFCMEMORY_H
+#define IFCMEMORY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DataNode.h"
+#include "SceneData.h"
+
+/*
+ * Live byte counts of the data held during and after a load, queryable at any time:
+ * - IfcFile: resident memory taken by parsing the IFC file with IfcOpenShell
+ * - StructureTree: the DataNode tree last built
+ * - UniqueMeshes / SharedMeshes: CPU mesh sets alive, split on whether more than one object instances them
+ * - GpuBuffers: vertex buffers uploaded by the viewer
+ * Mesh sets are counted from creation until their last reference is released.
+ */
+class IfcMemory
+{
+public:
+    enum class Category { IfcFile, StructureTree, UniqueMeshes, SharedMeshes, GpuBuffers, Count };
+
+    static void add(Category category, int64_t bytes) { s_bytes[index(category)].fetch_add(bytes, std::memory_order_relaxed); }
+    static void set(Category category, int64_t bytes) { s_bytes[index(category)].store(bytes, std::memory_order_relaxed); }
+    static int64_t bytes(Category category) { return s_bytes[index(category)].load(std::memory_order_relaxed); }
+
+    static const char* name(Category category);
+
+    // One line with every category and the process resident memory, for load summaries
+    static std::string summary();
+
+    // Resident memory of the process, 0 if the platform is not supported
+    static size_t residentBytes();
+
+    // Heap and object bytes of a DataNode tree
+    static size_t treeBytes(DataNode::Base* pRoot);
+
+    // Bytes of a mesh set, vertex data in its current form (see MeshCodec::vertexBytes) and bookkeeping
+    static size_t meshBytes(const std::vector<SceneData::Mesh>& meshes);
+
+    // Shared mesh set counted in UniqueMeshes while it is alive
+    static std::shared_ptr<std::vector<SceneData::Mesh>> trackMeshes(std::vector<SceneData::Mesh>&& meshes);
+    // An object instances a tracked mesh set again: it moves to SharedMeshes, no-op if it already did or is not tracked
+    static void markInstanced(const std::shared_ptr<std::vector<SceneData::Mesh>>& spMeshes);
+
+private:
+    static constexpr size_t index(Category category) { return static_cast<size_t>(category); }
+
+    static inline std::atomic<int64_t> s_bytes[static_cast<size_t>(Category::Count)] = {};
+};
+
+#endif // IFCMEMORY_H
@@ -0,0 +1,191 @@
+#include "IfcProfiler.h"
+#include "IfcTrace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace {
+    // Spans kept, about 40 MB; later spans are only counted in the totals
+    constexpr size_t MaxSpans = 1 << 19;
+
+    struct SpanRecord {
+        const char* name;
+        const char* category;
+        std::string detail;
+        uint64_t startNs;
+        uint64_t durationNs;
+        uint32_t threadId;
+    };
+
+    struct Totals {
+        size_t count = 0;
+        double ms = 0.0;
+    };
+
+    std::mutex g_mutex;
+    std::vector<SpanRecord> g_spans;
+    size_t g_nDroppedSpans = 0;
+    std::map<std::string, Totals> g_totalsByName;
+    std::map<std::string, IfcProfiler::ClassStats> g_statsByClass;
+
+    size_t triangleBucket(size_t nTriangles) {
+        size_t bucket = 0;
+        for (size_t limit = 16; bucket + 1 < IfcProfiler::TriangleBuckets && nTriangles >= limit; limit *= 4)
+            ++bucket;
+        return bucket;
+    }
+
+    std::string jsonString(const std::string& text) {
+        std::string out = "\"";
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if (c >= 0x20)
+                out += static_cast<char>(c);
+        }
+        return out + "\"";
+    }
+}
+
+void IfcProfiler::reset()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_spans.clear();
+    g_nDroppedSpans = 0;
+    g_totalsByName.clear();
+    g_statsByClass.clear();
+}
+
+IfcProfiler::Span::Span(const char* name, const char* category)
+    : m_name(name), m_category(category)
+{
+    if (isEnabled())
+        m_startNs = std::max<uint64_t>(IfcTrace::nowNs(), 1);
+}
+
+IfcProfiler::Span::Span(const char* name, const char* category, const std::string& detail)
+    : m_name(name), m_category(category)
+{
+    if (isEnabled()) {
+        m_detail = detail;
+        m_startNs = std::max<uint64_t>(IfcTrace::nowNs(), 1);
+    }
+}
+
+IfcProfiler::Span::~Span()
+{
+    if (m_startNs)
+        addSpan(m_name, m_category, m_detail, m_startNs, IfcTrace::nowNs());
+}
+
+void IfcProfiler::addSpan(const char* name, const char* category, const std::string& detail, uint64_t startNs, uint64_t endNs)
+{
+    const uint64_t durationNs = endNs > startNs ? endNs - startNs : 0;
+    const uint32_t threadId = IfcTrace::currentThreadId();
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto& totals = g_totalsByName[name];
+    totals.count++;
+    totals.ms += durationNs * 1e-6;
+
+    if (g_spans.size() < MaxSpans)
+        g_spans.push_back({name, category, detail, startNs, durationNs, threadId});
+    else
+        g_nDroppedSpans++;
+}
+
+void IfcProfiler::addElement(const std::string& ifcClass, double handoverMs, size_t nTriangles)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto& stats = g_statsByClass[ifcClass];
+    stats.nElements++;
+    stats.nTriangles += nTriangles;
+    stats.handoverMs += handoverMs;
+    stats.maxHandoverMs = std::max(stats.maxHandoverMs, handoverMs);
+    stats.triangleHistogram[triangleBucket(nTriangles)]++;
+}
+
+std::map<std::string, IfcProfiler::ClassStats> IfcProfiler::statsByClass()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_statsByClass;
+}
+
+std::string IfcProfiler::summary(size_t nClasses)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+
+    char text[256];
+    std::string out;
+    for (const auto& [name, totals] : g_totalsByName) {
+        std::snprintf(text, sizeof(text), "%s%s %.0f ms", out.empty() ? "" : ", ", name.c_str(), totals.ms);
+        out += text;
+    }
+
+    std::vector<std::pair<std::string, ClassStats>> classes(g_statsByClass.begin(), g_statsByClass.end());
+    std::sort(classes.begin(), classes.end(), [](const auto& a, const auto& b) { return a.second.handoverMs > b.second.handoverMs; });
+    if (classes.size() > nClasses)
+        classes.resize(nClasses);
+    for (size_t i = 0; i < classes.size(); ++i) {
+        const auto& stats = classes[i].second;
+        std::snprintf(text, sizeof(text), "%s%s %.0f ms (%zu elements, %zu triangles)", i ? ", " : "; longest handover by class: ",
+                      classes[i].first.c_str(), stats.handoverMs, stats.nElements, stats.nTriangles);
+        out += text;
+    }
+    return out;
+}
+
+std::string IfcProfiler::classTable()
+{
+    auto stats = statsByClass();
+
+    char text[512];
+    std::snprintf(text, sizeof(text), "%-32s %8s %10s %12s %12s  triangles per element: <16 <64 <256 <1k <4k <16k <64k more\n",
+                  "class", "elements", "triangles", "handover ms", "max handover");
+    std::string out = text;
+    for (const auto& [ifcClass, classStats] : stats) {
+        int n = std::snprintf(text, sizeof(text), "%-32s %8zu %10zu %12.1f %12.1f ", ifcClass.c_str(), classStats.nElements,
+                              classStats.nTriangles, classStats.handoverMs, classStats.maxHandoverMs);
+        for (size_t count : classStats.triangleHistogram)
+            n += std::snprintf(text + n, sizeof(text) - n, " %zu", count);
+        out += text;
+        out += "\n";
+    }
+    return out;
+}
+
+bool IfcProfiler::writeChromeTrace(const std::string& path)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+        return false;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char numbers[128];
+    for (size_t i = 0; i < g_spans.size(); ++i) {
+        const auto& span = g_spans[i];
+        // Complete events, times in microseconds
+        std::snprintf(numbers, sizeof(numbers), "\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+                      span.startNs * 1e-3, span.durationNs * 1e-3, span.threadId);
+        out << (i ? ",\n" : "\n") << "{\"name\":" << jsonString(span.name) << ",\"cat\":" << jsonString(span.category)
+            << "," << numbers;
+        if (!span.detail.empty())
+            out << ",\"args\":{\"detail\":" << jsonString(span.detail) << "}";
+        out << "}";
+    }
+    out << "\n],\"otherData\":{\"droppedSpans\":" << g_nDroppedSpans << ",\"classes\":{";
+    // Per class statistics, the time is the sum of the handover intervals
+    bool first = true;
+    for (const auto& [ifcClass, stats] : g_statsByClass) {
+        std::snprintf(numbers, sizeof(numbers), "{\"elements\":%zu,\"triangles\":%zu,\"handoverMs\":%.3f,\"maxHandoverMs\":%.3f}",
+                      stats.nElements, stats.nTriangles, stats.handoverMs, stats.maxHandoverMs);
+        out << (first ? "\n" : ",\n") << jsonString(ifcClass) << ":" << numbers;
+        first = false;
+    }
+    out << "}}}\n";
+    return static_cast<bool>(out);
+}
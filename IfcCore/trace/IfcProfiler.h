@@ -0,0 +1,79 @@
+#ifndef IFCPROFILER_H
+#define IFCPROFILER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/*
+ * Timing spans of the load phases (IFC parsing, structure build, iterator initialization,
+ * element handover intervals, processing, GPU upload) and per IFC class statistics.
+ * The iterator does not expose the time spent tessellating an element: the time of a class
+ * is the sum of the handover intervals of its elements, ie. the time until the iterator delivered them.
+ * Disabled by default: a disabled span costs one relaxed atomic load.
+ * The spans are exported as a Chrome trace-event file (chrome://tracing, Perfetto)
+ * and summarized in the geometry parser finish message.
+ */
+class IfcProfiler
+{
+public:
+    static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // Drop the recorded spans and statistics, eg. before loading another file
+    static void reset();
+
+    // Times its scope
+    class Span
+    {
+    public:
+        explicit Span(const char* name, const char* category = "ifc");
+        Span(const char* name, const char* category, const std::string& detail);
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* m_name;
+        const char* m_category;
+        std::string m_detail;
+        uint64_t m_startNs = 0; // 0 when disabled
+    };
+
+    // Span measured by the caller, times from IfcTrace::nowNs()
+    static void addSpan(const char* name, const char* category, const std::string& detail, uint64_t startNs, uint64_t endNs);
+
+    // Number of triangles per element, buckets [0,16) [16,64) [64,256) ... [16384,65536) [65536,inf)
+    static constexpr size_t TriangleBuckets = 8;
+
+    struct ClassStats {
+        size_t nElements = 0;
+        size_t nTriangles = 0;
+        double handoverMs = 0.0;
+        double maxHandoverMs = 0.0;
+        std::array<size_t, TriangleBuckets> triangleHistogram{};
+    };
+
+    // One element of the class, delivered handoverMs after the previous one
+    static void addElement(const std::string& ifcClass, double handoverMs, size_t nTriangles);
+    static std::map<std::string, ClassStats> statsByClass();
+
+    // Total time per span name, and the classes with the longest handover intervals
+    static std::string summary(size_t nClasses = 3);
+    // Per class table with the handover intervals and the triangle histograms
+    static std::string classTable();
+
+    static bool writeChromeTrace(const std::string& path);
+
+private:
+    static inline std::atomic<bool> s_enabled{false};
+};
+
+#define IFC_PROFILE_CONCAT_(a, b) a##b
+#define IFC_PROFILE_CONCAT(a, b) IFC_PROFILE_CONCAT_(a, b)
+#define IFC_PROFILE_SCOPE(...) IfcProfiler::Span IFC_PROFILE_CONCAT(ifcProfileSpan, __LINE__)(__VA_ARGS__)
+
+#endif // IFCPROFILER_H
@@ -0,0 +1,110 @@
+#include "IfcTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    // Each slot is a seqlock: odd sequence while written, 2 * (index + 1) once record index is complete
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        IfcTrace::Record record;
+    };
+
+    Slot g_slots[IfcTrace::Capacity];
+    std::atomic<uint64_t> g_head{0};
+    std::atomic<uint32_t> g_nThreads{0};
+    const auto g_epoch = std::chrono::steady_clock::now();
+
+    const char* levelName(IfcTrace::Level level) {
+        switch (level) {
+        case IfcTrace::Level::Error: return "Error";
+        case IfcTrace::Level::Notice: return "Notice";
+        case IfcTrace::Level::Debug: return "Debug";
+        default: return "Off";
+        }
+    }
+}
+
+uint64_t IfcTrace::nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_epoch).count());
+}
+
+uint32_t IfcTrace::currentThreadId()
+{
+    thread_local uint32_t id = g_nThreads.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void IfcTrace::record(Level level, const char* event, std::string_view text, std::initializer_list<double> values)
+{
+    const uint64_t index = g_head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = g_slots[index & (Capacity - 1)];
+
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Record& record = slot.record;
+    record.timeNs = nowNs();
+    record.threadId = currentThreadId();
+    record.level = level;
+    record.event = event;
+    const size_t nText = std::min(text.size(), sizeof(record.text) - 1);
+    std::memcpy(record.text, text.data(), nText);
+    record.text[nText] = '\0';
+    record.nValues = static_cast<uint8_t>(std::min(values.size(), MaxValues));
+    std::copy_n(values.begin(), record.nValues, record.values);
+
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+std::vector<IfcTrace::Record> IfcTrace::snapshot()
+{
+    const uint64_t head = g_head.load(std::memory_order_acquire);
+    const uint64_t first = head > Capacity ? head - Capacity : 0;
+
+    std::vector<Record> records;
+    records.reserve(static_cast<size_t>(head - first));
+    for (uint64_t index = first; index < head; ++index)
+    {
+        const Slot& slot = g_slots[index & (Capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != 2 * index + 2)
+            continue; // still being written, or already overwritten
+
+        Record record = slot.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == 2 * index + 2)
+            records.push_back(record);
+    }
+    return records;
+}
+
+std::string IfcTrace::format(const Record& record)
+{
+    char line[256];
+    int n = std::snprintf(line, sizeof(line), "%10.3f ms T%u %-6s %s", record.timeNs * 1e-6, record.threadId,
+                          levelName(record.level), record.event ? record.event : "");
+    if (record.text[0] && n < int(sizeof(line)))
+        n += std::snprintf(line + n, sizeof(line) - n, " %s", record.text);
+    for (uint8_t i = 0; i < record.nValues && n < int(sizeof(line)); ++i)
+        n += std::snprintf(line + n, sizeof(line) - n, " %g", record.values[i]);
+    return line;
+}
+
+std::string IfcTrace::dump()
+{
+    std::string text;
+    for (const auto& record : snapshot())
+        text += format(record) + "\n";
+    return text;
+}
+
+void IfcTrace::clear()
+{
+    // Invalidates every record written so far
+    for (auto& slot : g_slots)
+        slot.sequence.store(0, std::memory_order_relaxed);
+}
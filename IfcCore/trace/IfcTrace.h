@@ -0,0 +1,71 @@
+#ifndef IFCTRACE_H
+#define IFCTRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Most detailed level compiled in, see IfcTrace::Level: records above it are removed by the compiler
+#ifndef IFC_TRACE_LEVEL
+#define IFC_TRACE_LEVEL 2
+#endif
+
+/*
+ * Trace records of the hot paths, eg. one per tessellated element.
+ * A record is a fixed size entry in a lock-free ring buffer: an event name literal,
+ * a short text such as a GUID and a few numbers. Nothing is formatted until the
+ * records are read back with snapshot() or dump(); the oldest records are overwritten.
+ *
+ * Use the IFC_TRACE macro: above the compile-time level the record is compiled out,
+ * above the runtime level its arguments are not evaluated.
+ */
+class IfcTrace
+{
+public:
+    enum class Level : uint8_t { Off = 0, Error = 1, Notice = 2, Debug = 3 };
+
+    static constexpr size_t Capacity = 1 << 14; // records kept, a power of two
+    static constexpr size_t MaxValues = 4;
+
+    struct Record {
+        uint64_t timeNs;    // see nowNs()
+        uint32_t threadId;  // small id in the order threads first traced
+        Level level;
+        uint8_t nValues;
+        const char* event;  // string literal
+        char text[38];      // truncated, null terminated
+        double values[MaxValues];
+    };
+
+    static void setLevel(Level level) { s_level.store(static_cast<int>(level), std::memory_order_relaxed); }
+    static Level level() { return static_cast<Level>(s_level.load(std::memory_order_relaxed)); }
+    static bool isEnabled(Level level) { return static_cast<int>(level) <= s_level.load(std::memory_order_relaxed); }
+
+    static void record(Level level, const char* event, std::string_view text = {}, std::initializer_list<double> values = {});
+
+    // Clock and thread ids shared with IfcProfiler
+    static uint64_t nowNs(); // since IfcCore was loaded
+    static uint32_t currentThreadId();
+
+    // Records still in the buffer, oldest first; records being written are skipped
+    static std::vector<Record> snapshot();
+    static std::string format(const Record& record);
+    static std::string dump();
+    static void clear();
+
+private:
+    static inline std::atomic<int> s_level{static_cast<int>(Level::Notice)};
+};
+
+#define IFC_TRACE(level, ...)                                                               \
+    do {                                                                                    \
+        if constexpr (static_cast<int>(IfcTrace::Level::level) <= IFC_TRACE_LEVEL) {        \
+            if (IfcTrace::isEnabled(IfcTrace::Level::level))                                \
+                IfcTrace::record(IfcTrace::Level::level, __VA_ARGS__);                      \
+        }                                                                                   \
+    } while (0)
+
+#endif // IFCTRACE_H
@@ -0,0 +1,12 @@
+set(
+    TRACE_SOURCES
+    ${CMAKE_CURRENT_LIST_DIR}/trace.cmake
+    ${CMAKE_CURRENT_LIST_DIR}/IfcTrace.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcTrace.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcProfiler.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcProfiler.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/IfcMemory.h
+    ${CMAKE_CURRENT_LIST_DIR}/IfcMemory.cpp
+)
+
+source_group(trace FILES ${TRACE_SOURCES})
@@ -1,53 +1,371 @@
 #include "IfcParseController.h"
 #include "IfcParser.h"
-#include <QMetaObject>
+#include "IfcGeometryStream.h"
+#include "IfcProfiler.h"
+#include "IfcMemory.h"
+#include "IfcQuantityReport.h"
+#include "IfcPlanSlicer.h"
+#include "TaskScheduler.h"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <QDebug>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
-IfcParseController::IfcParseController(QObject *parent) : QObject(parent) {}
+namespace {
+    // GUI time spent pulling geometry per poll, the rest of the frame is left to rendering and input
+    constexpr qint64 PollBudgetMs = 8;
+    constexpr int PollIntervalMs = 5;
+    constexpr int ReportPollIntervalMs = 50;
+    constexpr int StoppingPollIntervalMs = 50;
+
+    // Chrome trace file of the load timings, profiling is off when not set
+    QString profileTracePath() { return qEnvironmentVariable("IFCVIEWER_PROFILE"); }
+}
+
+IfcParseController::IfcParseController(QObject *parent) : QObject(parent) {
+    m_pollTimer.setInterval(PollIntervalMs);
+    connect(&m_pollTimer, &QTimer::timeout, this, &IfcParseController::pollStream);
+    m_reportTimer.setInterval(ReportPollIntervalMs);
+    connect(&m_reportTimer, &QTimer::timeout, this, &IfcParseController::pollQuantityReport);
+    m_planTimer.setInterval(ReportPollIntervalMs);
+    connect(&m_planTimer, &QTimer::timeout, this, &IfcParseController::pollStoreyPlan);
+    m_stoppingTimer.setInterval(StoppingPollIntervalMs);
+    connect(&m_stoppingTimer, &QTimer::timeout, this, &IfcParseController::releaseStoppedLoads);
+}
 
 IfcParseController::~IfcParseController() {
-    if (m_workerThread.joinable()) {
-        m_workerThread.join(); // Ensure thread is joined on destruction
+    stopLoading(); // Cancel the running load on destruction
+    // The parsers must outlive their loads
+    for (const auto& load : m_stoppingLoads)
+        load.waitStopped();
+}
+
+bool IfcParseController::StoppingLoad::isStopped() const {
+    if (upStream)
+        return upStream->isStopped();
+    if (planFuture.valid())
+        return planFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    return reportFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void IfcParseController::StoppingLoad::waitStopped() const {
+    if (upStream)
+        upStream->waitStopped();
+    else if (planFuture.valid())
+        planFuture.wait();
+    else
+        reportFuture.wait();
+}
+
+void IfcParseController::stopLoading() {
+    m_pollTimer.stop();
+    if (m_upStream) {
+        m_upStream->cancel();
+        if (!m_upStream->isStopped()) {
+            m_stoppingLoads.push_back({m_parserInstance, std::move(m_upStream)});
+            m_stoppingTimer.start();
+        }
+        m_upStream.reset();
+    }
+    m_reportTimer.stop();
+    if (m_reportFuture.valid()) {
+        *m_spReportCancelled = true;
+        m_stoppingLoads.push_back({m_parserInstance, nullptr, std::move(m_reportFuture)});
+        m_stoppingTimer.start();
+    }
+    m_planTimer.stop();
+    if (m_planFuture.valid()) {
+        // Not cancellable, one storey
+        m_stoppingLoads.push_back({m_parserInstance, nullptr, {}, std::move(m_planFuture)});
+        m_stoppingTimer.start();
+    }
+    m_busy = false;
+    m_runningStoreys.clear();
+}
+
+bool IfcParseController::isParserStopping() const {
+    for (const auto& load : m_stoppingLoads)
+        if (load.spParser == m_parserInstance)
+            return true;
+    return false;
+}
+
+void IfcParseController::dropStoppedLoads() {
+    m_stoppingLoads.erase(std::remove_if(m_stoppingLoads.begin(), m_stoppingLoads.end(),
+                                         [](const StoppingLoad& load) { return load.isStopped(); }),
+                          m_stoppingLoads.end());
+}
+
+void IfcParseController::releaseStoppedLoads() {
+    dropStoppedLoads();
+    if (isParserStopping())
+        return;
+    if (m_stoppingLoads.empty())
+        m_stoppingTimer.stop();
+
+    // Loads requested while the parser was still in use
+    if (m_parseWhenStopped) {
+        m_parseWhenStopped = false;
+        startParsing();
+    }
+    else if (!m_busy)
+        startPendingStoreys();
+}
+
+void IfcParseController::openFile(const QString& filePath) {
+    stopLoading(); // The load of the previous file is not needed anymore
+    m_pendingStoreys.clear();
+
+    IfcProfiler::setEnabled(!profileTracePath().isEmpty());
+    IfcProfiler::reset();
+
+    m_upQuantityReport.reset();
+    m_parseWhenStopped = false;
+    m_parserInstance = std::make_shared<IfcParser>(filePath.toStdString());
+
+    // Progressive loading: show the building envelope and structure first
+    IfcGeometryParser::Options geometryOptions;
+    geometryOptions.order = IfcGeometryParser::Order::Priority;
+    m_parserInstance->setGeometryOptions(geometryOptions);
+    // Interleaved vertices with quantized normals, uploaded as a single VBO
+    m_parserInstance->setVertexLayout(SceneData::VertexLayout::Packed);
+    // Reopening an unchanged file reads <file>.ifccache instead of parsing it
+    m_parserInstance->setSceneCache(true);
+}
+
+std::unique_ptr<DataNode::Base> IfcParseController::createPreviewTree() {
+    if (!m_parserInstance)
+        return nullptr;
+    stopLoading(); // The parser is not shared with a running load
+    for (const auto& load : m_stoppingLoads)
+        if (load.spParser == m_parserInstance)
+            load.waitStopped(); // only if the tree is created again for the same file
+    dropStoppedLoads();
+    return m_parserInstance->createPreviewTree();
+}
+
+QSet<QString> IfcParseController::objectGuidsOfStorey(const QString& storeyGuid) const {
+    QSet<QString> guids;
+    if (!m_parserInstance)
+        return guids;
+    for (const auto& guid : m_parserInstance->objectGuidsOfStoreys({storeyGuid.toStdString()}))
+        guids.insert(QString::fromStdString(guid));
+    return guids;
+}
+
+void IfcParseController::startParsing() {
+    if (!m_parserInstance)
+        return;
+    stopLoading();
+    if (isParserStopping()) {
+        m_parseWhenStopped = true;
+        return;
+    }
+
+    // The load runs on the shared scheduler and waits whenever the GUI falls behind
+    startStream(m_progressiveQuality ? m_parserInstance->openGeometryStreamProgressive()
+                                     : m_parserInstance->openGeometryStream());
+}
+
+void IfcParseController::startParsingStoreys(const QStringList& storeyGuids) {
+    if (!m_parserInstance || storeyGuids.isEmpty())
+        return;
+
+    if (m_busy || isParserStopping()) {
+        for (const auto& guid : storeyGuids)
+            if (!m_pendingStoreys.contains(guid))
+                m_pendingStoreys.append(guid);
+        return;
+    }
+
+    std::vector<std::string> guids;
+    for (const auto& guid : storeyGuids)
+        guids.push_back(guid.toStdString());
+
+    startStream(m_parserInstance->openStoreysGeometryStream(guids));
+    m_runningStoreys = storeyGuids;
+}
+
+bool IfcParseController::discardPendingStorey(const QString& storeyGuid) {
+    return m_pendingStoreys.removeAll(storeyGuid) > 0;
+}
+
+void IfcParseController::startStream(std::unique_ptr<IfcGeometryStream> upStream) {
+    m_upStream = std::move(upStream);
+    m_busy = true;
+    m_pollTimer.start();
+}
+
+void IfcParseController::pollStream() {
+    if (!m_upStream)
+        return;
+
+    QElapsedTimer budget;
+    budget.start();
+    while (budget.elapsed() < PollBudgetMs) {
+        auto event = m_upStream->tryNext();
+        if (!event) {
+            // The load ended without a Finished event, eg. it failed
+            if (m_upStream->isDrained())
+                finishStream(false, "Geometry loading stopped");
+            return;
+        }
+
+        using Type = IfcGeometryStream::Event::Type;
+        switch (event->type) {
+        case Type::ObjectsReady:
+            emit objectsReadyForOpenGL(event->objects); // Forward to OpenGLWidget
+            break;
+        case Type::ObjectsRefined:
+            emit objectsRefinedForOpenGL(event->objects);
+            break;
+        case Type::Interactive:
+            if (event->success)
+                emit parsingInteractive(QString::fromStdString(event->message));
+            break;
+        case Type::Finished:
+            finishStream(event->success, QString::fromStdString(event->message));
+            return;
+        }
     }
 }
 
-void IfcParseController::startParsing(const QString& filePath) {
-    if (m_workerThread.joinable()) {
-        m_workerThread.join(); // Wait for any previous parsing to finish
+void IfcParseController::finishStream(bool success, const QString& message) {
+    stopLoading();
+#if defined(__GLIBC__)
+    // The uploaded meshes are freed in many small blocks, hand the pages back to the OS
+    malloc_trim(0);
+#endif
+    // Load summary with where the memory goes, the uploads of this load are done
+    emit parsingComplete(success, success ? message + "; memory: " + QString::fromStdString(IfcMemory::summary()) : message);
+
+    if (IfcProfiler::isEnabled()) {
+        if (!IfcProfiler::writeChromeTrace(profileTracePath().toStdString()))
+            qWarning() << "Unable to write the profile trace" << profileTracePath();
+        qDebug().noquote() << QString::fromStdString(IfcProfiler::classTable());
     }
 
-    m_parserInstance = std::make_unique<IfcParser>(filePath.toStdString());
+    startPendingStoreys();
+}
+
+void IfcParseController::startPendingStoreys() {
+    // Storeys checked while the previous load was running
+    if (!m_pendingStoreys.isEmpty()) {
+        QStringList storeyGuids;
+        storeyGuids.swap(m_pendingStoreys);
+        startParsingStoreys(storeyGuids);
+    }
+}
+
+void IfcParseController::startQuantityReport() {
+    if (!m_parserInstance || m_busy || isParserStopping())
+        return;
 
+    // A separate geometry pass, the parser is not shared with the loads meanwhile
+    m_busy = true;
+    auto spCancelled = std::make_shared<std::atomic<bool>>(false);
+    m_spReportCancelled = spCancelled;
+    IfcParser* pParser = m_parserInstance.get(); // kept alive by m_stoppingLoads once cancelled
+    m_reportFuture = TaskScheduler::instance().async([pParser, spCancelled]() {
+        return pParser->createQuantityReport(IfcParser::QuantitySource::MeshNet, [spCancelled]() { return spCancelled->load(); });
+    });
+    m_reportTimer.start();
+}
 
-    auto callback_objectReady = [this](std::shared_ptr<SceneData::Object> objData){
-        // This lambda is executed in m_workerThread.
-        // Use QMetaObject::invokeMethod to call a slot in this controller's thread (GUI thread).
-        QMetaObject::invokeMethod(this, "handleObjectReady", Qt::QueuedConnection,
-                                  Q_ARG(std::shared_ptr<SceneData::Object>, objData));
-    };
+void IfcParseController::pollQuantityReport() {
+    if (!m_reportFuture.valid() || m_reportFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
 
-    auto callback_finished = [this](bool success, const std::string& msg) {
-        // This lambda is executed in m_workerThread.
-        QString qMsg = QString::fromStdString(msg);
-        QMetaObject::invokeMethod(this, "handleParsingFinished", Qt::QueuedConnection,
-                                  Q_ARG(bool, success), Q_ARG(QString, qMsg));
-    };
+    m_reportTimer.stop();
+    m_busy = false;
+    try {
+        m_upQuantityReport = m_reportFuture.get();
+    }
+    catch (const std::exception& e) {
+        m_upQuantityReport.reset();
+        qWarning() << "Quantity take-off failed:" << e.what();
+    }
+    m_reportFuture = {};
 
-    // Start the parsing in a new std::thread
-    m_workerThread = std::thread(&IfcParser::parseGeometryFlow,
-                      m_parserInstance.get(),
-                      callback_objectReady,
-                      callback_finished
-                      );
+    if (m_upQuantityReport)
+        emit quantityReportReady(true, quantityTotals());
+    else
+        emit quantityReportReady(false, tr("no element measured"));
+
+    startPendingStoreys();
 }
 
-// These slots are guaranteed to be called in the thread of IfcParserController (GUI thread)
-void IfcParseController::handleObjectReady(std::shared_ptr<SceneData::Object> objectData) {
-    emit objectReadyForOpenGL(objectData); // Forward to OpenGLWidget
+bool IfcParseController::startStoreyPlan(const QString& storeyGuid) {
+    if (!m_parserInstance || m_busy || isParserStopping())
+        return false;
+
+    // The geometry of the storey is tessellated again, the parser is not shared with the loads meanwhile
+    m_busy = true;
+    m_planStorey = storeyGuid;
+    IfcParser* pParser = m_parserInstance.get(); // kept alive by m_stoppingLoads once stopped
+    m_planFuture = TaskScheduler::instance().async([pParser, guid = storeyGuid.toStdString()]() {
+        StoreyPlan plan;
+        plan.spPlan = pParser->createStoreyPlan(guid);
+        plan.elevation = pParser->storeyElevation(guid).value_or(0.0);
+        return plan;
+    });
+    m_planTimer.start();
+    return true;
 }
 
-void IfcParseController::handleParsingFinished(bool success, const QString& message) {
-    if (m_workerThread.joinable()) {
-        m_workerThread.join();
+void IfcParseController::pollStoreyPlan() {
+    if (!m_planFuture.valid() || m_planFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+
+    m_planTimer.stop();
+    m_busy = false;
+    StoreyPlan plan;
+    try {
+        plan = m_planFuture.get();
+    }
+    catch (const std::exception& e) {
+        qWarning() << "Storey plan failed:" << e.what();
     }
-    emit parsingComplete(success, message);
+    m_planFuture = {};
+
+    emit storeyPlanReady(m_planStorey, plan.spPlan, plan.elevation);
+    startPendingStoreys();
+}
+
+void IfcParseController::setObjectsVisible(const QStringList& guids, bool visible) {
+    if (!m_upQuantityReport)
+        return;
+
+    std::vector<std::string> objectGuids;
+    objectGuids.reserve(guids.size());
+    for (const auto& guid : guids)
+        objectGuids.push_back(guid.toStdString());
+    m_upQuantityReport->setVisible(objectGuids, visible);
+    emit quantityTotalsChanged(quantityTotals());
+}
+
+QString IfcParseController::quantityTotals() const {
+    if (!m_upQuantityReport)
+        return QString();
+
+    const auto total = m_upQuantityReport->total();
+    return tr("%1 elements: volume %2 m³, surface %3 m², footprint %4 m²")
+        .arg(total.nElements)
+        .arg(total.values[IfcQuantityReport::Volume], 0, 'f', 2)
+        .arg(total.values[IfcQuantityReport::SurfaceArea], 0, 'f', 2)
+        .arg(total.values[IfcQuantityReport::FootprintArea], 0, 'f', 2);
+}
+
+QStringList IfcParseController::quantityReportStoreys() const {
+    QStringList storeyGuids;
+    if (m_upQuantityReport)
+        for (const auto& guid : m_upQuantityReport->storeyGuids())
+            storeyGuids << QString::fromStdString(guid);
+    return storeyGuids;
+}
+
+bool IfcParseController::exportQuantityReport(const QString& csvPath) const {
+    return m_upQuantityReport && m_upQuantityReport->writeCsv(csvPath.toStdString());
 }
@@ -3,12 +3,21 @@
 
 #include <QObject>
 #include <QString>
-#include <thread>
+#include <QStringList>
+#include <QSet>
+#include <QTimer>
+#include <atomic>
+#include <future>
 #include <memory>
+#include <vector>
 
 #include "SceneData.h"
+#include "DataNode.h"
 
 class IfcParser;
+class IfcGeometryStream;
+class IfcQuantityReport;
+class IfcPlanSlicer;
 
 class IfcParseController : public QObject {
     Q_OBJECT
@@ -16,21 +25,98 @@ public:
     explicit IfcParseController(QObject *parent = nullptr);
     ~IfcParseController();
 
-    void startParsing(const QString& filePath);
+    // Open the file once, it is then shared by the preview tree and all geometry loads
+    void openFile(const QString& filePath);
+    std::unique_ptr<DataNode::Base> createPreviewTree();
+
+    // Load the geometry of the whole file
+    void startParsing();
+
+    // Coarse pass first, then curved objects refined in the background (used by startParsing)
+    void setProgressiveQuality(bool enabled) { m_progressiveQuality = enabled; }
+
+    // Load the geometry of the given storeys only, queued if a load is running
+    void startParsingStoreys(const QStringList& storeyGuids);
+    // Remove a storey from the queued loads, return false if it is not queued
+    bool discardPendingStorey(const QString& storeyGuid);
+    bool isParsingStorey(const QString& storeyGuid) const { return m_runningStoreys.contains(storeyGuid); }
+
+    QSet<QString> objectGuidsOfStorey(const QString& storeyGuid) const;
+
+    // Measure the elements on the IfcCore TaskScheduler, quantityReportReady is emitted when done. Ignored while a load is running
+    void startQuantityReport();
+    bool hasQuantityReport() const { return m_upQuantityReport != nullptr; }
+    // Follow the checked elements and storeys of the preview tree, quantityTotalsChanged is emitted
+    void setObjectsVisible(const QStringList& guids, bool visible);
+    QString quantityTotals() const;
+    QStringList quantityReportStoreys() const;
+    bool exportQuantityReport(const QString& csvPath) const;
+
+    // Load the geometry of a storey into a plan slicer on the IfcCore TaskScheduler, storeyPlanReady is emitted when done.
+    // Returns false, ignored, while a load is running
+    bool startStoreyPlan(const QString& storeyGuid);
 
 signals:
-    void objectReadyForOpenGL(std::shared_ptr<SceneData::Object> objectData); // To send to OpenGLWidget
+    void objectsReadyForOpenGL(std::shared_ptr<std::vector<SceneData::Object>> objectsData); // To send to OpenGLWidget
+    void objectsRefinedForOpenGL(std::shared_ptr<std::vector<SceneData::Object>> objectsData); // Full quality meshes of loaded objects
+    void parsingInteractive(const QString& message); // Coarse pass of a progressive quality load done
     void parsingComplete(bool success, const QString& message);
+    void quantityReportReady(bool success, const QString& message);
+    void quantityTotalsChanged(const QString& totals);
+    void storeyPlanReady(const QString& storeyGuid, std::shared_ptr<IfcPlanSlicer> spPlan, double elevation); // null plan without geometry
 
 private slots:
-    // These slots will be invoked in the IfcParseController's thread (GUI thread)
-    // via QMetaObject::invokeMethod
-    void handleObjectReady(std::shared_ptr<SceneData::Object> objectData);
-    void handleParsingFinished(bool success, const QString& message);
+    // Pull the ready geometry events of the running load, within a time budget per call
+    void pollStream();
+    void pollQuantityReport();
+    void pollStoreyPlan();
+    // Release the cancelled loads which stopped, and the parsers only they used
+    void releaseStoppedLoads();
 
 private:
-    std::unique_ptr<IfcParser> m_parserInstance;
-    std::thread m_workerThread;
+    std::shared_ptr<IfcParser> m_parserInstance;
+    std::unique_ptr<IfcGeometryStream> m_upStream; // geometry load running on the IfcCore TaskScheduler
+    QTimer m_pollTimer;
+    bool m_busy = false;
+    bool m_parseWhenStopped = false; // startParsing deferred until the cancelled loads of the parser stopped
+
+    struct StoreyPlan {
+        std::shared_ptr<IfcPlanSlicer> spPlan;
+        double elevation = 0.0;
+    };
+
+    // Cancelled loads, quantity reports and storey plans finish on the scheduler, the GUI does not wait for them
+    struct StoppingLoad {
+        std::shared_ptr<IfcParser> spParser;
+        std::unique_ptr<IfcGeometryStream> upStream;
+        std::future<std::unique_ptr<IfcQuantityReport>> reportFuture; // valid for a quantity report, without stream
+        std::future<StoreyPlan> planFuture;                           // valid for a storey plan, without stream
+
+        bool isStopped() const;
+        void waitStopped() const;
+    };
+    std::vector<StoppingLoad> m_stoppingLoads;
+    QTimer m_stoppingTimer;
+    bool m_progressiveQuality = true;
+    QStringList m_runningStoreys;
+    QStringList m_pendingStoreys;
+
+    std::unique_ptr<IfcQuantityReport> m_upQuantityReport;
+    std::future<std::unique_ptr<IfcQuantityReport>> m_reportFuture; // quantities being measured
+    std::shared_ptr<std::atomic<bool>> m_spReportCancelled; // shared with the measuring task, which may outlive the request
+    QTimer m_reportTimer;
+
+    std::future<StoreyPlan> m_planFuture; // storey geometry being loaded into the slicer
+    QString m_planStorey;
+    QTimer m_planTimer;
+
+    void startStream(std::unique_ptr<IfcGeometryStream> upStream);
+    void finishStream(bool success, const QString& message);
+    void stopLoading();
+    void startPendingStoreys();
+    // A cancelled load still uses the current parser, which is not shared between loads
+    bool isParserStopping() const;
+    void dropStoppedLoads();
 };
 
 #endif // IFCPARSECONTROLLER_H
@@ -0,0 +1,133 @@
+#include "IfcPlanWidget.h"
+#include "IfcPlanSlicer.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QVBoxLayout>
+#include <cmath>
+
+namespace {
+    // Usual cut height of floor plans above the storey elevation, in metres
+    constexpr double DefaultCutHeight = 1.0;
+    // The slider counts centimetres
+    constexpr double SliderScale = 100.0;
+    constexpr int MarginPx = 10;
+}
+
+// Draws the sections in world XY, fitted to the view; the fit only grows so that moving the cut does not rescale
+class IfcPlanCanvas : public QWidget
+{
+public:
+    explicit IfcPlanCanvas(QWidget *parent = nullptr) : QWidget(parent) { setMinimumSize(300, 300); }
+
+    void setSections(std::vector<IfcPlanSlicer::Section> sections, bool resetBounds)
+    {
+        m_sections = std::move(sections);
+        if (resetBounds)
+            m_bounds = QRectF();
+        for (const auto& section : m_sections)
+            for (const auto& polyline : section.polylines)
+                for (const auto& point : polyline.points)
+                    m_bounds = m_bounds.isNull() ? QRectF(point[0], point[1], 0.0, 0.0)
+                                                 : m_bounds.united(QRectF(point[0], point[1], 0.0, 0.0));
+        update();
+    }
+
+protected:
+    void paintEvent(QPaintEvent*) override
+    {
+        QPainter painter(this);
+        painter.fillRect(rect(), Qt::white);
+        if (m_sections.empty() || m_bounds.isNull())
+            return;
+
+        const double width = std::max(m_bounds.width(), 1e-6);
+        const double height = std::max(m_bounds.height(), 1e-6);
+        const double scale = std::min((this->width() - 2 * MarginPx) / width, (this->height() - 2 * MarginPx) / height);
+        // Y up in the model, down on the screen
+        QTransform transform;
+        transform.translate(this->width() / 2.0, this->height() / 2.0);
+        transform.scale(scale, -scale);
+        transform.translate(-m_bounds.center().x(), -m_bounds.center().y());
+
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setTransform(transform);
+        QPen pen(Qt::black);
+        pen.setCosmetic(true);
+        painter.setPen(pen);
+        for (const auto& section : m_sections)
+        {
+            // Holes are left out by the odd-even fill of the closed polylines
+            QPainterPath path;
+            path.setFillRule(Qt::OddEvenFill);
+            for (const auto& polyline : section.polylines)
+            {
+                QPolygonF polygon;
+                for (const auto& point : polyline.points)
+                    polygon << QPointF(point[0], point[1]);
+                if (!polyline.closed) {
+                    painter.drawPolyline(polygon);
+                    continue;
+                }
+                path.addPolygon(polygon);
+                path.closeSubpath();
+            }
+            painter.fillPath(path, QColor(200, 200, 200));
+            painter.drawPath(path);
+        }
+    }
+
+private:
+    std::vector<IfcPlanSlicer::Section> m_sections;
+    QRectF m_bounds;
+};
+
+IfcPlanWidget::IfcPlanWidget(QWidget *parent)
+    : QWidget(parent, Qt::Window)
+    , m_pSlider(new QSlider(Qt::Horizontal))
+    , m_pLabel(new QLabel)
+    , m_pCanvas(new IfcPlanCanvas)
+{
+    setWindowTitle(tr("Floor plan"));
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(m_pCanvas, 1);
+    layout->addWidget(m_pSlider);
+    layout->addWidget(m_pLabel);
+
+    connect(m_pSlider, &QSlider::valueChanged, this, &IfcPlanWidget::slice);
+}
+
+void IfcPlanWidget::setPlan(const QString& storeyName, std::shared_ptr<IfcPlanSlicer> spPlan, double elevation)
+{
+    m_spPlan = std::move(spPlan);
+    m_elevation = elevation;
+    m_storeyName = storeyName;
+    setWindowTitle(tr("Floor plan: ") + storeyName);
+    m_pCanvas->setSections({}, true);
+    if (!m_spPlan) {
+        m_pLabel->setText(tr("No geometry to cut"));
+        return;
+    }
+
+    // Cut heights over the elements of the storey
+    const QSignalBlocker blocker(m_pSlider);
+    m_pSlider->setRange(int(std::floor((m_spPlan->minZ() - m_elevation) * SliderScale)),
+                        int(std::ceil((m_spPlan->maxZ() - m_elevation) * SliderScale)));
+    m_pSlider->setValue(int(DefaultCutHeight * SliderScale));
+    slice();
+}
+
+void IfcPlanWidget::slice()
+{
+    if (!m_spPlan)
+        return;
+
+    const double cutHeight = m_pSlider->value() / SliderScale;
+    auto sections = m_spPlan->slice(m_elevation + cutHeight);
+    double area = 0.0;
+    for (const auto& section : sections)
+        area += section.area;
+    m_pLabel->setText(tr("Cut %1 m above %2: %3 elements, %4 m² cut")
+                          .arg(cutHeight, 0, 'f', 2).arg(m_storeyName).arg(sections.size()).arg(area, 0, 'f', 2));
+    m_pCanvas->setSections(std::move(sections), false);
+}
@@ -0,0 +1,37 @@
+#ifndef IFCPLANWIDGET_H
+#define IFCPLANWIDGET_H
+
+#include <QLabel>
+#include <QSlider>
+#include <QWidget>
+#include <memory>
+
+class IfcPlanSlicer;
+class IfcPlanCanvas;
+
+/*
+ * Floor plan of a storey: the sections of its elements at a cut height set with a slider,
+ * sliced again by IfcPlanSlicer each time the height changes.
+ */
+class IfcPlanWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit IfcPlanWidget(QWidget *parent = nullptr);
+
+    // Show the plan of a storey, cut 1 m above its elevation at first; a null plan clears the view
+    void setPlan(const QString& storeyName, std::shared_ptr<IfcPlanSlicer> spPlan, double elevation);
+
+private:
+    std::shared_ptr<IfcPlanSlicer> m_spPlan;
+    double m_elevation = 0.0;
+    QString m_storeyName;
+    QSlider* m_pSlider = nullptr;
+    QLabel* m_pLabel = nullptr;
+    IfcPlanCanvas* m_pCanvas = nullptr;
+
+    void slice();
+};
+
+#endif // IFCPLANWIDGET_H
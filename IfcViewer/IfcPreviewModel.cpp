@@ -0,0 +1,305 @@
+#include "IfcPreviewModel.h"
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+IfcPreviewModel::IfcPreviewModel(QObject* parent) : QAbstractItemModel(parent)
+{
+    clear();
+}
+
+IfcPreviewModel::~IfcPreviewModel() = default;
+
+void IfcPreviewModel::clear()
+{
+    setTree(nullptr, false);
+}
+
+void IfcPreviewModel::setTree(std::unique_ptr<DataNode::Base> upTreeRoot, bool storeysUnchecked)
+{
+    beginResetModel();
+
+    m_upTree = std::move(upTreeRoot);
+    m_nodes.clear();
+    m_parents.clear();
+    m_rows.clear();
+    m_children.clear();
+    m_hiddenByDefault.clear();
+
+    //depth-first numbering, a subtree is a range of nodes
+    if (m_upTree) {
+        std::vector<std::pair<DataNode::Base*, Node>> stack{{m_upTree.get(), 0}};
+        std::vector<uint32_t> nextRow;
+        while (!stack.empty()) {
+            auto [pNode, parent] = stack.back();
+            stack.pop_back();
+            const auto node = static_cast<Node>(m_nodes.size());
+            m_nodes.push_back(pNode);
+            m_parents.push_back(parent);
+            m_rows.push_back(node ? nextRow[parent]++ : 0);
+            nextRow.push_back(0);
+
+            const auto& children = pNode->getChildren();
+            for (auto it = children.rbegin(); it != children.rend(); ++it)
+                stack.emplace_back(it->get(), node);
+        }
+    }
+    else {
+        static DataNode::Base emptyRoot;
+        m_nodes.push_back(&emptyRoot);
+        m_parents.push_back(0);
+        m_rows.push_back(0);
+    }
+
+    const size_t nNodes = m_nodes.size();
+    m_childBegin.assign(nNodes + 1, 0);
+    for (Node node = 1; node < nNodes; ++node)
+        m_childBegin[m_parents[node] + 1]++;
+    for (size_t node = 0; node < nNodes; ++node)
+        m_childBegin[node + 1] += m_childBegin[node];
+    m_children.resize(nNodes ? nNodes - 1 : 0);
+    for (Node node = 1; node < nNodes; ++node)
+        m_children[m_childBegin[m_parents[node]] + m_rows[node]] = node;
+
+    m_subtreeEnd.resize(nNodes);
+    for (Node node = 0; node < nNodes; ++node)
+        m_subtreeEnd[node] = node + 1;
+    for (Node node = Node(nNodes) - 1; node > 0; --node)
+        m_subtreeEnd[m_parents[node]] = std::max(m_subtreeEnd[m_parents[node]], m_subtreeEnd[node]);
+
+    m_checkStates.assign(nNodes, Qt::Checked);
+    for (Node node = 1; node < nNodes; ++node) {
+        auto pObject = m_nodes[node]->as<DataNode::IfcObject>();
+        if (!pObject)
+            continue;
+        if (storeysUnchecked && pObject->m_ifcClass == "IfcBuildingStorey")
+            std::fill(m_checkStates.begin() + node, m_checkStates.begin() + m_subtreeEnd[node], uint8_t(Qt::Unchecked));
+        //todo complete default hidden types
+        auto ifcClass = QString::fromStdString(pObject->m_ifcClass);
+        if (ifcClass.compare("IfcOpeningElement", Qt::CaseInsensitive) == 0 ||
+            ifcClass.compare("IfcSpace", Qt::CaseInsensitive) == 0)
+            m_hiddenByDefault.push_back(node);
+    }
+    //children are numbered after their parent
+    for (Node node = Node(nNodes) - 1; node > 0; --node)
+        if (childCount(node) > 0)
+            m_checkStates[node] = stateFromChildren(node);
+
+    m_fetched.assign(nNodes, false);
+    m_fetched[0] = true;
+
+    endResetModel();
+}
+
+QModelIndex IfcPreviewModel::index(int row, int column, const QModelIndex& parent) const
+{
+    if (column != 0 || row < 0 || row >= rowCount(parent))
+        return QModelIndex();
+    const Node parentNode = nodeOf(parent);
+    return createIndex(row, column, quintptr(m_children[m_childBegin[parentNode] + row]));
+}
+
+QModelIndex IfcPreviewModel::parent(const QModelIndex& index) const
+{
+    if (!index.isValid())
+        return QModelIndex();
+    const Node parentNode = m_parents[nodeOf(index)];
+    if (parentNode == 0)
+        return QModelIndex();
+    return createIndex(int(m_rows[parentNode]), 0, quintptr(parentNode));
+}
+
+int IfcPreviewModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.column() > 0)
+        return 0;
+    const Node node = nodeOf(parent);
+    return m_fetched[node] ? int(childCount(node)) : 0;
+}
+
+int IfcPreviewModel::columnCount(const QModelIndex&) const
+{
+    return 1;
+}
+
+bool IfcPreviewModel::hasChildren(const QModelIndex& parent) const
+{
+    return childCount(nodeOf(parent)) > 0;
+}
+
+bool IfcPreviewModel::canFetchMore(const QModelIndex& parent) const
+{
+    const Node node = nodeOf(parent);
+    return !m_fetched[node] && childCount(node) > 0;
+}
+
+void IfcPreviewModel::fetchMore(const QModelIndex& parent)
+{
+    if (!canFetchMore(parent))
+        return;
+    const Node node = nodeOf(parent);
+    beginInsertRows(parent, 0, int(childCount(node)) - 1);
+    m_fetched[node] = true;
+    endInsertRows();
+}
+
+QModelIndex IfcPreviewModel::indexOf(Node node)
+{
+    if (node == 0 || node >= m_nodes.size())
+        return QModelIndex();
+
+    std::vector<Node> ancestors;
+    for (Node ancestor = m_parents[node]; ancestor != 0; ancestor = m_parents[ancestor])
+        ancestors.push_back(ancestor);
+    for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it)
+        if (!m_fetched[*it])
+            fetchMore(createIndex(int(m_rows[*it]), 0, quintptr(*it)));
+    return createIndex(int(m_rows[node]), 0, quintptr(node));
+}
+
+QString IfcPreviewModel::guid(Node node) const
+{
+    auto pObject = m_nodes[node]->as<DataNode::IfcObject>();
+    return pObject ? QString::fromStdString(pObject->m_guid) : QString();
+}
+
+QString IfcPreviewModel::ifcClass(Node node) const
+{
+    if (auto pObject = m_nodes[node]->as<DataNode::IfcObject>())
+        return QString::fromStdString(pObject->m_ifcClass);
+    if (auto pClass = m_nodes[node]->as<DataNode::IfcClass>())
+        return QString::fromStdString(pClass->m_ifcClass);
+    return QString();
+}
+
+QVariant IfcPreviewModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+    const Node node = nodeOf(index);
+    auto pNode = m_nodes[node];
+
+    if (auto pObject = pNode->as<DataNode::IfcObject>()) {
+        switch (role) {
+        case Qt::DisplayRole: {
+            auto name = QString::fromStdString(pObject->m_name);
+            return name.isEmpty() ? tr("unnamed ") + QString::fromStdString(pObject->m_ifcClass) : name;
+        }
+        case Qt::CheckStateRole:
+            return int(m_checkStates[node]);
+        case GuidRole:
+            return QString::fromStdString(pObject->m_guid);
+        case IfcClassRole:
+            return QString::fromStdString(pObject->m_ifcClass);
+        default:
+            return QVariant();
+        }
+    }
+
+    if (auto pClass = pNode->as<DataNode::IfcClass>()) {
+        switch (role) {
+        case Qt::DisplayRole:
+            return QString("%1 (%2)").arg(QString::fromStdString(pClass->m_ifcClass)).arg(pClass->m_objectsCount);
+        case Qt::CheckStateRole:
+            return int(m_checkStates[node]);
+        case IfcClassRole:
+            return QString::fromStdString(pClass->m_ifcClass);
+        default:
+            return QVariant();
+        }
+    }
+    return QVariant();
+}
+
+bool IfcPreviewModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (!index.isValid() || role != Qt::CheckStateRole || !(flags(index) & Qt::ItemIsUserCheckable))
+        return false;
+    setCheckState(nodeOf(index), static_cast<Qt::CheckState>(value.toInt()));
+    return true;
+}
+
+Qt::ItemFlags IfcPreviewModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+}
+
+uint8_t IfcPreviewModel::stateFromChildren(Node node) const
+{
+    bool anyChecked = false;
+    bool anyUnchecked = false;
+    for (uint32_t i = m_childBegin[node]; i < m_childBegin[node + 1]; ++i) {
+        const auto state = m_checkStates[m_children[i]];
+        anyChecked |= state != Qt::Unchecked;
+        anyUnchecked |= state != Qt::Checked;
+        if (anyChecked && anyUnchecked)
+            return Qt::PartiallyChecked;
+    }
+    return anyChecked ? Qt::Checked : Qt::Unchecked;
+}
+
+void IfcPreviewModel::setCheckStates(const std::vector<Node>& nodes, Qt::CheckState state)
+{
+    const uint8_t newState = state == Qt::Unchecked ? Qt::Unchecked : Qt::Checked;
+    std::vector<Node> changed;
+    std::vector<bool> wasUnchecked;
+    auto setState = [&](Node node, uint8_t nodeState) {
+        if (m_checkStates[node] == nodeState)
+            return false;
+        changed.push_back(node);
+        wasUnchecked.push_back(m_checkStates[node] == Qt::Unchecked);
+        m_checkStates[node] = nodeState;
+        return true;
+    };
+
+    //subtrees are ranges of nodes, ancestors are updated once from the deepest up
+    std::priority_queue<Node> ancestors;
+    for (Node node : nodes) {
+        if (node == 0 || node >= m_nodes.size())
+            continue;
+        for (Node subNode = node; subNode < m_subtreeEnd[node]; ++subNode)
+            setState(subNode, newState);
+        ancestors.push(m_parents[node]);
+    }
+    for (Node last = 0; !ancestors.empty();) {
+        const Node node = ancestors.top();
+        ancestors.pop();
+        if (node == 0 || node == last)
+            continue;
+        last = node;
+        if (setState(node, stateFromChildren(node)))
+            ancestors.push(m_parents[node]);
+    }
+    if (changed.empty())
+        return;
+
+    //one dataChanged per range of exposed siblings
+    std::unordered_map<Node, std::pair<uint32_t, uint32_t>> rowsByParent;
+    for (Node node : changed) {
+        if (!isExposed(node))
+            continue;
+        auto it = rowsByParent.try_emplace(m_parents[node], m_rows[node], m_rows[node]).first;
+        it->second.first = std::min(it->second.first, m_rows[node]);
+        it->second.second = std::max(it->second.second, m_rows[node]);
+    }
+    for (const auto& [parentNode, rows] : rowsByParent) {
+        const auto parentIndex = parentNode ? createIndex(int(m_rows[parentNode]), 0, quintptr(parentNode)) : QModelIndex();
+        emit dataChanged(index(int(rows.first), 0, parentIndex), index(int(rows.second), 0, parentIndex), {Qt::CheckStateRole});
+    }
+
+    std::vector<size_t> order(changed.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return changed[a] < changed[b]; });
+    std::vector<Node> checked;
+    std::vector<Node> unchecked;
+    for (size_t i : order) {
+        const bool isUnchecked = m_checkStates[changed[i]] == Qt::Unchecked;
+        if (isUnchecked != wasUnchecked[i])
+            (isUnchecked ? unchecked : checked).push_back(changed[i]);
+    }
+    emit checkedChanged(checked, unchecked);
+}
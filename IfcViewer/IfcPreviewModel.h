@@ -0,0 +1,105 @@
+#ifndef IFCPREVIEWMODEL_H
+#define IFCPREVIEWMODEL_H
+
+#include <QAbstractItemModel>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DataNode.h"
+
+/*
+ * Item model over the structure tree of IfcParser::createPreviewTree, which it owns.
+ * The tree is numbered once in depth-first order into flat arrays (parent, row, children, check state),
+ * no item is allocated per node. The rows of a node are exposed to the view when it is expanded
+ * (canFetchMore / fetchMore), so that showing the tree costs the same whatever the size of the model.
+ * Every node is checkable and tri-state: checking a node checks its subtree, a range of the numbering,
+ * and its ancestors are recomputed from their children. A change is reported once, whatever its size.
+ */
+class IfcPreviewModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    using Node = uint32_t; // depth-first number, 0 is the root
+
+    enum Role {
+        GuidRole = Qt::UserRole,
+        IfcClassRole = Qt::UserRole + 1
+    };
+
+    explicit IfcPreviewModel(QObject* parent = nullptr);
+    ~IfcPreviewModel() override;
+
+    /**
+     * Replace the tree, only the top level rows are exposed
+     * @param storeysUnchecked: storeys start unchecked, see IfcPreviewWidget::setStoreyScopedLoading
+     */
+    void setTree(std::unique_ptr<DataNode::Base> upTreeRoot, bool storeysUnchecked);
+    void clear();
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& index) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+    Node nodeOf(const QModelIndex& index) const { return index.isValid() ? static_cast<Node>(index.internalId()) : 0; }
+
+    // Index of a node, its ancestors are fetched first if needed
+    QModelIndex indexOf(Node node);
+
+    bool isClassNode(Node node) const { return m_nodes[node]->type() == DataNode::Type::IfcClass; }
+    QString guid(Node node) const;
+    QString ifcClass(Node node) const;
+
+    Node nodeCount() const { return static_cast<Node>(m_nodes.size()); }
+    bool isObjectNode(Node node) const { return m_nodes[node]->type() == DataNode::Type::IfcObject; }
+
+    Qt::CheckState checkState(Node node) const { return static_cast<Qt::CheckState>(m_checkStates[node]); }
+
+    /**
+     * Check or uncheck the subtrees of nodes, their ancestors become partially checked if needed
+     * @param state: Qt::PartiallyChecked is applied as Qt::Checked
+     */
+    void setCheckState(Node node, Qt::CheckState state) { setCheckStates({node}, state); }
+    void setCheckStates(const std::vector<Node>& nodes, Qt::CheckState state);
+
+    // Objects of the classes hidden once the geometry is loaded, eg. openings and spaces
+    const std::vector<Node>& hiddenByDefault() const { return m_hiddenByDefault; }
+
+signals:
+    /**
+     * Nodes that changed state in one change, through the view or setCheckStates, in increasing order
+     * @param checked: nodes that were unchecked and are now checked or partially checked
+     * @param unchecked: nodes that are now unchecked
+     */
+    void checkedChanged(const std::vector<Node>& checked, const std::vector<Node>& unchecked);
+
+private:
+    std::unique_ptr<DataNode::Base> m_upTree;
+
+    // By node
+    std::vector<DataNode::Base*> m_nodes;
+    std::vector<Node> m_parents;
+    std::vector<uint32_t> m_rows;        // row in the parent
+    std::vector<uint32_t> m_childBegin;  // children of node n: m_children[m_childBegin[n], m_childBegin[n + 1])
+    std::vector<Node> m_subtreeEnd;      // subtree of node n: [n, m_subtreeEnd[n])
+    std::vector<uint8_t> m_checkStates;  // Qt::CheckState
+    std::vector<bool> m_fetched;         // rows of the children exposed to the view
+
+    std::vector<Node> m_children;
+    std::vector<Node> m_hiddenByDefault;
+
+    uint32_t childCount(Node node) const { return m_childBegin[node + 1] - m_childBegin[node]; }
+    bool isExposed(Node node) const { return node == 0 || m_fetched[m_parents[node]]; }
+    uint8_t stateFromChildren(Node node) const;
+};
+
+#endif // IFCPREVIEWMODEL_H
@@ -1,104 +1,112 @@
 #include "IfcPreviewWidget.h"
 
-IfcPreviewWidget::IfcPreviewWidget(QWidget *parent) : QTreeWidget(parent)
+#include <QSet>
+
+IfcPreviewWidget::IfcPreviewWidget(QWidget *parent) : QTreeView(parent), m_pModel(new IfcPreviewModel(this))
 {
-    connect(this, &QTreeWidget::itemChanged, this, &IfcPreviewWidget::handleTreeItemChanged);
-    connect(this, &QTreeWidget::itemSelectionChanged, this, &IfcPreviewWidget::handleItemSelectionChanged);
+    setModel(m_pModel);
+    setUniformRowHeights(true);
+
+    connect(m_pModel, &IfcPreviewModel::checkedChanged, this, &IfcPreviewWidget::handleCheckedChanged);
+    connect(selectionModel(), &QItemSelectionModel::selectionChanged, this, &IfcPreviewWidget::handleItemSelectionChanged);
 }
 
 void IfcPreviewWidget::clearAll()
 {
-    QTreeWidget::clear();
-    m_pItemsToHideByDefault.clear();
+    m_pModel->clear();
 }
 
-void IfcPreviewWidget::loadTree(const std::unique_ptr<DataNode::Base>& upTreeRoot)
+void IfcPreviewWidget::loadTree(std::unique_ptr<DataNode::Base> upTreeRoot)
 {
-    clearAll();
-
-    if(!upTreeRoot)
-        return;
-
-    auto fillObjectItem = [this](QTreeWidgetItem* pItem, DataNode::IfcObject* pObjectNode) {
-
-        auto ifcClass = QString::fromStdString(pObjectNode->m_ifcClass);
-        if (ifcClass.compare("IfcOpeningElement", Qt::CaseInsensitive) == 0 ||
-            ifcClass.compare("IfcSpace", Qt::CaseInsensitive) == 0) {
-            //todo complete default hidden types
-            m_pItemsToHideByDefault.push_back(pItem);
-        }
-
-        auto name = QString::fromStdString(pObjectNode->m_name);
-        if(name.isEmpty())
-            name = tr("unnamed ") + ifcClass;
-
-        pItem->setText(0, name);
-        pItem->setData(0, Qt::UserRole, QString::fromStdString(pObjectNode->m_guid));
-        pItem->setCheckState(0, Qt::CheckState::Checked);
-    };
-
-    std::function< void (QTreeWidgetItem*, const std::unique_ptr<DataNode::Base>&) > createWidgetItem
-        = [&createWidgetItem, &fillObjectItem](QTreeWidgetItem* pParentItem, const std::unique_ptr<DataNode::Base>& upNode){
-
-              auto pItem = new QTreeWidgetItem();
-              pParentItem->addChild(pItem);
-
-              if(auto pObjectNode = upNode->as<DataNode::IfcObject>())
-                  fillObjectItem(pItem, pObjectNode);
+    m_pModel->setTree(std::move(upTreeRoot), m_storeyScopedLoading);
+    expandStructure(QModelIndex());
+
+    //elements of unchecked storeys stay hidden if only some of them get checked once loaded
+    std::vector<IfcPreviewModel::Node> unchecked;
+    for (IfcPreviewModel::Node node = 1; node < m_pModel->nodeCount(); ++node)
+        if (m_pModel->checkState(node) == Qt::CheckState::Unchecked)
+            unchecked.push_back(node);
+    emitVisibilityChanged(unchecked, false);
+}
 
-              else if(auto pClassNode = upNode->as<DataNode::IfcClass>())
-              {
-                  pItem->setText(0, QString("%1 (%2)").arg(pClassNode->m_ifcClass).arg(pClassNode->m_objectsCount));
-              }
+void IfcPreviewWidget::expandStructure(const QModelIndex& parent)
+{
+    //the spatial structure is expanded down to the class nodes, elements are fetched when their class is expanded
+    for (int row = 0; row < m_pModel->rowCount(parent); ++row)
+    {
+        auto index = m_pModel->index(row, 0, parent);
+        if (m_pModel->isClassNode(m_pModel->nodeOf(index)) || !m_pModel->hasChildren(index))
+            continue;
+        m_pModel->fetchMore(index);
+        expand(index);
+        expandStructure(index);
+    }
+}
 
-              for(const auto& upChild : upNode->getChildren())
-                  createWidgetItem(pItem, upChild);
-          };
+void IfcPreviewWidget::handleCheckedChanged(const std::vector<IfcPreviewModel::Node>& checked, const std::vector<IfcPreviewModel::Node>& unchecked)
+{
+    emitVisibilityChanged(checked, true);
+    emitVisibilityChanged(unchecked, false);
+}
 
-    //create top level widget items, then create children items recursively
-    for(const auto& upChild: upTreeRoot->getChildren())
+void IfcPreviewWidget::emitVisibilityChanged(const std::vector<IfcPreviewModel::Node>& nodes, bool visible)
+{
+    QStringList guids;
+    for (auto node : nodes)
     {
-        //the first level node is always an object eg IfcProject, IfcBuilding etc.
-        if(const auto& pChild = upChild->as<DataNode::IfcObject>())
-        {
-            auto topItem = new QTreeWidgetItem(this);
-            fillObjectItem(topItem, pChild);
-
-            for(const auto& upChildChild : pChild->getChildren())
-                createWidgetItem(topItem, upChildChild);
-        }
+        if (!m_pModel->isObjectNode(node))
+            continue;
+        //a storey stands for its elements in the quantity report, they are listed on their own
+        if (isStoreyNode(node))
+            emit storeyCheckStateChanged(m_pModel->guid(node), visible);
+        else
+            guids << m_pModel->guid(node);
     }
+    if (!guids.isEmpty())
+        emit objectsVisibilityChanged(guids, visible);
+}
 
-    this->expandAll();
+bool IfcPreviewWidget::isStoreyNode(IfcPreviewModel::Node node) const
+{
+    return m_pModel->ifcClass(node) == QLatin1String("IfcBuildingStorey");
 }
 
-void IfcPreviewWidget::handleTreeItemChanged(QTreeWidgetItem * item, int column)
+QStringList IfcPreviewWidget::uncheckedElementGuids() const
 {
-    emit objectVisibilityChanged(item->data(0, Qt::UserRole).toString() /*guid*/ , item->checkState(column));
+    QStringList guids;
+    for (IfcPreviewModel::Node node = 1; node < m_pModel->nodeCount(); ++node)
+        if (m_pModel->isObjectNode(node) && !isStoreyNode(node) && m_pModel->checkState(node) == Qt::CheckState::Unchecked)
+            guids << m_pModel->guid(node);
+    return guids;
+}
 
-    //todo update children and parent state
-    //item->treeWidget()->blockSignals(true);
-    //set children and parents state
-    //item->treeWidget()->blockSignals(false);
+QString IfcPreviewWidget::currentStoreyGuid(QString* pStoreyName) const
+{
+    for (auto index = currentIndex(); index.isValid(); index = index.parent())
+    {
+        auto node = m_pModel->nodeOf(index);
+        if (!m_pModel->isObjectNode(node) || !isStoreyNode(node))
+            continue;
+        if (pStoreyName)
+            *pStoreyName = index.siblingAtColumn(0).data().toString();
+        return m_pModel->guid(node);
+    }
+    return {};
 }
 
 void IfcPreviewWidget::handleItemSelectionChanged()
 {
-    const auto& selection = selectedItems();
-    if(selection.isEmpty())
-        emit objectSelectionChanged(QSet<QString>());
-    else {
-        QSet<QString> selectedGuids;
-        for (auto pItem : selection) {
-            selectedGuids << pItem->data(0, Qt::UserRole).toString();
-        }
-        emit objectSelectionChanged(std::move(selectedGuids));
+    QSet<QString> selectedGuids;
+    for (const auto& index : selectionModel()->selectedRows())
+    {
+        auto guid = m_pModel->guid(m_pModel->nodeOf(index));
+        if (!guid.isEmpty())
+            selectedGuids << guid;
     }
+    emit objectSelectionChanged(std::move(selectedGuids));
 }
 
 void IfcPreviewWidget::handleLoadGeometryFinished()
 {
-    for(const auto& pItem : m_pItemsToHideByDefault) {
-        pItem->setCheckState(0, Qt::CheckState::Unchecked);
-    }
+    m_pModel->setCheckStates(m_pModel->hiddenByDefault(), Qt::CheckState::Unchecked);
 }
@@ -1,30 +1,48 @@
 #ifndef IFCPREVIEWWIDGET_H
 #define IFCPREVIEWWIDGET_H
 
-#include <QTreeWidget>
+#include <QStringList>
+#include <QTreeView>
 
 #include "DataNode.h"
+#include "IfcPreviewModel.h"
 
-class IfcPreviewWidget : public QTreeWidget
+class IfcPreviewWidget : public QTreeView
 {
     Q_OBJECT
 
 public:
     IfcPreviewWidget(QWidget *parent = nullptr);
     void clearAll();
-    void loadTree(const std::unique_ptr<DataNode::Base>& upTreeRoot);
+    void loadTree(std::unique_ptr<DataNode::Base> upTreeRoot);
     void handleLoadGeometryFinished();
 
+    // Elements currently unchecked, without the storeys, eg. to seed a view created after the checks were made
+    QStringList uncheckedElementGuids() const;
+
+    // Storey of the current item, or the storey itself, empty if the item is not in a storey
+    QString currentStoreyGuid(QString* pStoreyName = nullptr) const;
+
+    // Storeys are created unchecked, their geometry is loaded when they are checked
+    void setStoreyScopedLoading(bool enabled) { m_storeyScopedLoading = enabled; }
+
 signals:
-    void objectVisibilityChanged(const QString& guid, bool visible);
+    // Elements shown or hidden by one change of the check states, storeys are reported by storeyCheckStateChanged
+    void objectsVisibilityChanged(const QStringList& guids, bool visible);
+    void storeyCheckStateChanged(const QString& storeyGuid, bool checked);
     void objectSelectionChanged(const QSet<QString>& guids);
 
 private slots:
-    void handleTreeItemChanged(QTreeWidgetItem * item, int column);
+    void handleCheckedChanged(const std::vector<IfcPreviewModel::Node>& checked, const std::vector<IfcPreviewModel::Node>& unchecked);
     void handleItemSelectionChanged();
 
 private:
-    std::vector<QTreeWidgetItem*> m_pItemsToHideByDefault;
+    IfcPreviewModel* m_pModel = nullptr;
+    bool m_storeyScopedLoading = false;
+
+    void expandStructure(const QModelIndex& parent);
+    void emitVisibilityChanged(const std::vector<IfcPreviewModel::Node>& nodes, bool visible);
+    bool isStoreyNode(IfcPreviewModel::Node node) const;
 
 };
 
@@ -1,13 +1,13 @@
 #include "MainWindow.h"
 #include "./ui_MainWindow.h"
 
-#include <QTreeWidgetItem>
 #include <QFileDialog>
 #include <QElapsedTimer>
 
 #include "IfcParser.h"
 #include "IfcPreviewWidget.h"
 #include "IfcParseController.h"
+#include "IfcPlanWidget.h"
 #include "OpenGLWidget.h"
 
 MainWindow::MainWindow(qreal dpiScale, QWidget *parent)
@@ -33,8 +33,27 @@ MainWindow::MainWindow(qreal dpiScale, QWidget *parent)
 
     connect(ui->btLoad, &QPushButton::clicked, this, &MainWindow::loadIfcFile);
     connect(ui->btClear, &QPushButton::clicked, this, &MainWindow::clearIfc);
-    connect(m_pPreviewTree, &IfcPreviewWidget::objectVisibilityChanged, m_pGLWidget, &OpenGLWidget::setVisibility);
+    connect(ui->btQuantities, &QPushButton::clicked, this, &MainWindow::exportQuantities);
+    connect(ui->btPlan, &QPushButton::clicked, this, &MainWindow::showStoreyPlan);
+    connect(m_pPreviewTree, &IfcPreviewWidget::objectsVisibilityChanged, m_pGLWidget, &OpenGLWidget::setObjectsVisibility);
     connect(m_pPreviewTree, &IfcPreviewWidget::objectSelectionChanged, m_pGLWidget, &OpenGLWidget::selectObjects);
+    connect(m_pPreviewTree, &IfcPreviewWidget::storeyCheckStateChanged, this, &MainWindow::handleStoreyCheckStateChanged);
+
+    m_pParseController = new IfcParseController(this); // 'this' is QObject parent
+    connect(m_pParseController, &IfcParseController::objectsReadyForOpenGL, m_pGLWidget, &OpenGLWidget::addNewObjects);
+    connect(m_pParseController, &IfcParseController::objectsRefinedForOpenGL, m_pGLWidget, &OpenGLWidget::replaceObjectsMeshes);
+    connect(m_pParseController, &IfcParseController::parsingInteractive, ui->statusbar, [this](const QString& message) {
+        ui->statusbar->showMessage(message + tr(", refining curved geometry ..."));
+    });
+    connect(m_pParseController, &IfcParseController::parsingComplete, this, &MainWindow::handleParseGeometryCompleted);
+
+    // Quantity totals follow the checked elements
+    connect(m_pPreviewTree, &IfcPreviewWidget::objectsVisibilityChanged, m_pParseController, &IfcParseController::setObjectsVisible);
+    connect(m_pParseController, &IfcParseController::quantityTotalsChanged, ui->statusbar, [this](const QString& totals) {
+        ui->statusbar->showMessage(totals);
+    });
+    connect(m_pParseController, &IfcParseController::quantityReportReady, this, &MainWindow::handleQuantityReportReady);
+    connect(m_pParseController, &IfcParseController::storeyPlanReady, this, &MainWindow::handleStoreyPlanReady);
 }
 
 MainWindow::~MainWindow()
@@ -51,17 +70,21 @@ void MainWindow::loadIfcFile()
 
     ui->labelStatus->setText(m_sCurrentFile);
 
-    IfcParser ifcParser(m_sCurrentFile.toStdString());
-    m_pPreviewTree->loadTree(ifcParser.createPreviewTree());
-
+    m_loadedStoreys.clear();
+    m_storeysToUnload.clear();
     m_pGLWidget->clearScene(); // Clear previous model
+    if (m_pPlanWidget)
+        m_pPlanWidget->hide();
 
-    if (!m_pParseController) { // Create controller if it doesn't exist
-        m_pParseController = new IfcParseController(this); // 'this' is QObject parent
-        connect(m_pParseController, &IfcParseController::objectReadyForOpenGL, m_pGLWidget, &OpenGLWidget::addNewObject);
-        connect(m_pParseController, &IfcParseController::parsingComplete, this, &MainWindow::handleParseGeometryCompleted);
-    }
-    m_pParseController->startParsing(m_sCurrentFile);
+    // The same parsed file serves the preview tree and the geometry loads
+    m_storeyScopedLoading = ui->cbLoadByStorey->isChecked();
+    m_pParseController->openFile(m_sCurrentFile);
+    m_pPreviewTree->setStoreyScopedLoading(m_storeyScopedLoading);
+    m_pPreviewTree->loadTree(m_pParseController->createPreviewTree());
+
+    // Load by storey: geometry is loaded when a storey gets checked
+    if (!m_storeyScopedLoading)
+        m_pParseController->startParsing();
 
 /*
     //parse geometry once then load all
@@ -72,15 +95,119 @@ void MainWindow::loadIfcFile()
 */
 }
 
-void MainWindow::handleParseGeometryCompleted()
+void MainWindow::handleParseGeometryCompleted(bool success, const QString& message)
 {
+    ui->statusbar->showMessage(success ? message : tr("Geometry loading failed: ") + message);
+
+    for (const auto& storeyGuid : std::as_const(m_storeysToUnload))
+        m_pGLWidget->removeObjects(m_pParseController->objectGuidsOfStorey(storeyGuid));
+    m_storeysToUnload.clear();
     m_pPreviewTree->handleLoadGeometryFinished();
 }
 
+void MainWindow::handleStoreyCheckStateChanged(const QString& storeyGuid, bool checked)
+{
+    if (!m_storeyScopedLoading)
+        return;
+
+    if (checked) {
+        m_storeysToUnload.remove(storeyGuid);
+        if (!m_loadedStoreys.contains(storeyGuid)) {
+            m_loadedStoreys.insert(storeyGuid);
+            m_pParseController->startParsingStoreys({storeyGuid});
+        }
+        return;
+    }
+
+    if (!m_loadedStoreys.remove(storeyGuid))
+        return;
+
+    if (m_pParseController->discardPendingStorey(storeyGuid))
+        return;
+
+    m_pGLWidget->removeObjects(m_pParseController->objectGuidsOfStorey(storeyGuid));
+    if (m_pParseController->isParsingStorey(storeyGuid))
+        m_storeysToUnload.insert(storeyGuid); // objects still arriving, removed again once loaded
+}
+
+void MainWindow::exportQuantities()
+{
+    if (m_sCurrentFile.isEmpty())
+        return;
+
+    if (!m_pParseController->hasQuantityReport()) {
+        // Exported once measured, see handleQuantityReportReady
+        ui->statusbar->showMessage(tr("Measuring quantities ..."));
+        m_pParseController->startQuantityReport();
+        return;
+    }
+
+    QString csvPath = QFileDialog::getSaveFileName(this, tr("Export quantities"), QString(), tr("CSV Files (*.csv)"));
+    if (csvPath.isEmpty())
+        return;
+    ui->statusbar->showMessage(m_pParseController->exportQuantityReport(csvPath) ? tr("Quantities written to ") + csvPath
+                                                                                  : tr("Unable to write ") + csvPath);
+}
+
+void MainWindow::handleQuantityReportReady(bool success, const QString& message)
+{
+    if (!success) {
+        ui->statusbar->showMessage(tr("Quantity take-off failed: ") + message);
+        return;
+    }
+
+    // The report counts every element, hide the ones unchecked before it was ready, eg. the spaces
+    m_pParseController->setObjectsVisible(m_pPreviewTree->uncheckedElementGuids(), false);
+
+    // Storeys not loaded are unchecked in the tree
+    if (m_storeyScopedLoading) {
+        QStringList uncheckedStoreys;
+        for (const auto& storeyGuid : m_pParseController->quantityReportStoreys())
+            if (!m_loadedStoreys.contains(storeyGuid))
+                uncheckedStoreys << storeyGuid;
+        m_pParseController->setObjectsVisible(uncheckedStoreys, false);
+    }
+    exportQuantities();
+}
+
 void MainWindow::clearIfc()
 {
     m_sCurrentFile.clear();
     ui->labelStatus->clear();
     m_pPreviewTree->clearAll();
     m_pGLWidget->clearScene();
+    if (m_pPlanWidget)
+        m_pPlanWidget->hide();
+}
+
+void MainWindow::showStoreyPlan()
+{
+    if (m_sCurrentFile.isEmpty())
+        return;
+
+    QString storeyName;
+    QString storeyGuid = m_pPreviewTree->currentStoreyGuid(&storeyName);
+    if (storeyGuid.isEmpty()) {
+        ui->statusbar->showMessage(tr("Select a storey, or an element of it, for its plan"));
+        return;
+    }
+
+    // Shown once sliced, see handleStoreyPlanReady
+    if (!m_pParseController->startStoreyPlan(storeyGuid)) {
+        ui->statusbar->showMessage(tr("Geometry is loading, try the plan again once it is done"));
+        return;
+    }
+    m_planStoreyName = storeyName;
+    ui->statusbar->showMessage(tr("Cutting the plan of ") + storeyName + tr(" ..."));
+}
+
+void MainWindow::handleStoreyPlanReady(const QString& storeyGuid, std::shared_ptr<IfcPlanSlicer> spPlan, double elevation)
+{
+    Q_UNUSED(storeyGuid);
+    if (!m_pPlanWidget)
+        m_pPlanWidget = new IfcPlanWidget(this);
+    m_pPlanWidget->setPlan(m_planStoreyName, std::move(spPlan), elevation);
+    m_pPlanWidget->show();
+    m_pPlanWidget->raise();
+    ui->statusbar->clearMessage();
 }
@@ -2,6 +2,8 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QSet>
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -11,6 +13,8 @@ QT_END_NAMESPACE
 
 class IfcParseController;
 class IfcPreviewWidget;
+class IfcPlanWidget;
+class IfcPlanSlicer;
 class OpenGLWidget;
 class OpenGLWidgetDummy;
 
@@ -29,10 +33,20 @@ private:
     IfcPreviewWidget* m_pPreviewTree = nullptr;
     OpenGLWidget* m_pGLWidget = nullptr;
     IfcParseController* m_pParseController = nullptr;
+    IfcPlanWidget* m_pPlanWidget = nullptr; // created on first use
+    QString m_planStoreyName;
+    bool m_storeyScopedLoading = false;
+    QSet<QString> m_loadedStoreys;      // storeys requested with "Load by storey"
+    QSet<QString> m_storeysToUnload;    // storeys unchecked while their load is running
 
     void loadIfcFile();
     void clearIfc();
-    void handleParseGeometryCompleted();
+    void handleParseGeometryCompleted(bool success, const QString& message);
+    void handleStoreyCheckStateChanged(const QString& storeyGuid, bool checked);
+    void exportQuantities();
+    void handleQuantityReportReady(bool success, const QString& message);
+    void showStoreyPlan();
+    void handleStoreyPlanReady(const QString& storeyGuid, std::shared_ptr<IfcPlanSlicer> spPlan, double elevation);
 
 };
 #endif // MAINWINDOW_H
@@ -1,8 +1,12 @@
 #include "OpenGLWidget.h"
+#include "MeshView.h"
+#include "IfcProfiler.h"
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QOpenGLContext>
 #include <QDebug>
+#include <algorithm>
+#include <cstddef>
 
 namespace {
     // --- Configurable Speeds ---
@@ -61,11 +65,41 @@ void OpenGLWidget::clearScene() {
         }
     }
     m_renderableObjects.clear();
-    m_hiddenGuids.clear();
+    m_handleByGuid.clear();
+    m_objectIndexByHandle.clear();
+    m_objectFlags.clear();
+    m_selectedHandles.clear();
     doneCurrent();
     update(); // Request a repaint of the now empty scene
 }
 
+void OpenGLWidget::removeObjects(const QSet<QString>& guids) {
+    if (guids.isEmpty())
+        return;
+
+    for (const auto& guid : guids) {
+        auto it = m_handleByGuid.constFind(guid);
+        if (it != m_handleByGuid.constEnd())
+            m_objectIndexByHandle[it.value()] = -1;
+    }
+
+    makeCurrent();
+    auto itEnd = std::remove_if(m_renderableObjects.begin(), m_renderableObjects.end(), [this](RenderableObjectGL& ro) {
+        if (m_objectIndexByHandle[ro.handle] >= 0)
+            return false;
+        for (auto& mesh : ro.meshes) {
+            mesh->destroyGL();
+        }
+        return true;
+    });
+    m_renderableObjects.erase(itEnd, m_renderableObjects.end());
+
+    for (qsizetype i = 0; i < m_renderableObjects.size(); ++i)
+        m_objectIndexByHandle[m_renderableObjects[i].handle] = i;
+    doneCurrent();
+    update();
+}
+
 void OpenGLWidget::addNewObject(std::shared_ptr<SceneData::Object> pObject) {
 
     if (!pObject) {
@@ -74,14 +108,61 @@ void OpenGLWidget::addNewObject(std::shared_ptr<SceneData::Object> pObject) {
     }
 
     // This slot is called from the GUI thread (due to QueuedConnection or direct call from GUI thread)
+    IFC_PROFILE_SCOPE("GPU upload", "render");
     makeCurrent(); // CRITICAL: Need an active OpenGL context to create buffers
+    appendObject(*pObject);
+    doneCurrent();
+    update(); // Schedule a repaint
+}
+
+void OpenGLWidget::addNewObjects(std::shared_ptr<std::vector<SceneData::Object>> spObjects) {
+
+    if (!spObjects || spObjects->empty())
+        return;
+
+    IFC_PROFILE_SCOPE("GPU upload", "render");
+    makeCurrent();
+    m_renderableObjects.reserve(m_renderableObjects.size() + spObjects->size());
+    for (const SceneData::Object& object : *spObjects)
+        appendObject(object);
+    doneCurrent();
+    update();
+    qDebug() << "Added" << spObjects->size() << "objects to render queue. Total objects:" << m_renderableObjects.size();
+}
+
+void OpenGLWidget::replaceObjectMeshes(std::shared_ptr<SceneData::Object> pObject) {
+
+    if (!pObject)
+        return;
+
+    IFC_PROFILE_SCOPE("GPU upload", "render");
+    makeCurrent();
+    replaceMeshes(*pObject);
+    doneCurrent();
+    update();
+}
+
+void OpenGLWidget::replaceObjectsMeshes(std::shared_ptr<std::vector<SceneData::Object>> spObjects) {
+
+    if (!spObjects || spObjects->empty())
+        return;
+
+    IFC_PROFILE_SCOPE("GPU upload", "render");
+    makeCurrent();
+    for (const SceneData::Object& object : *spObjects)
+        replaceMeshes(object);
+    doneCurrent();
+    update();
+}
+
+void OpenGLWidget::appendObject(const SceneData::Object& object) {
 
     RenderableObjectGL roGL;
-    roGL.guid = QString::fromStdString(pObject->guid);
-    roGL.type = QString::fromStdString(pObject->type);
+    roGL.guid = QString::fromStdString(object.guid);
+    roGL.type = QString::fromStdString(object.type);
 
     // Convert SceneData::Matrix4x4 to QMatrix4x4
-    const float* m = pObject->transform.m;
+    const float* m = object.transform.m;
     roGL.transform = QMatrix4x4(
                          (float)m[0], (float)m[1], (float)m[2], (float)m[3],
                          (float)m[4], (float)m[5], (float)m[6], (float)m[7],
@@ -89,23 +170,102 @@ void OpenGLWidget::addNewObject(std::shared_ptr<SceneData::Object> pObject) {
                          (float)m[12], (float)m[13], (float)m[14], (float)m[15]
         );
 
-    if (pObject->meshes) {
-        for (const SceneData::Mesh& meshData : *pObject->meshes) {
-            if (meshData.vertices.empty()) {
-                qDebug() << "Skipping empty mesh for object GUID:" << QString::fromStdString(pObject->guid);
-                continue;
-            }
+    roGL.meshes = createMeshesGL(object);
 
-            auto rmGL = std::make_shared<RenderableMeshGL>();
-            rmGL->vertexCount = meshData.vertices.size(); // Number of Vec3f elements
+    roGL.handle = handleOf(roGL.guid);
+    const qsizetype index = m_objectIndexByHandle[roGL.handle];
+    if (index >= 0) {
+        // Delivered twice, eg. a storey checked again while its previous load was still running: the newer copy replaces it
+        for (auto& mesh : m_renderableObjects[index].meshes) {
+            mesh->destroyGL();
+        }
+        m_renderableObjects[index] = std::move(roGL);
+        return;
+    }
+    m_objectIndexByHandle[roGL.handle] = m_renderableObjects.size();
+    m_renderableObjects.append(std::move(roGL));
+}
 
-            // Create and bind VAO for this mesh
-            if (!rmGL->vao.create()) {
-                qWarning() << "Failed to create VAO for mesh GUID:" << QString::fromStdString(pObject->guid);
-                continue;
-            }
-            rmGL->vao.bind();
+void OpenGLWidget::replaceMeshes(const SceneData::Object& object) {
+
+    // Objects removed meanwhile (eg. unloaded storey) are not added back
+    const qsizetype index = objectIndexOf(QString::fromStdString(object.guid));
+    if (index < 0)
+        return;
+
+    auto meshes = createMeshesGL(object);
+    if (meshes.isEmpty())
+        return;
+
+    RenderableObjectGL& roGL = m_renderableObjects[index];
+    for (auto& mesh : roGL.meshes) {
+        mesh->destroyGL();
+    }
+    roGL.meshes = std::move(meshes);
+}
+
+OpenGLWidget::ObjectHandle OpenGLWidget::handleOf(const QString& guid) {
+    auto it = m_handleByGuid.constFind(guid);
+    if (it != m_handleByGuid.constEnd())
+        return it.value();
 
+    const auto handle = static_cast<ObjectHandle>(m_objectFlags.size());
+    m_handleByGuid.insert(guid, handle);
+    m_objectIndexByHandle.push_back(-1);
+    m_objectFlags.push_back(0);
+    return handle;
+}
+
+qsizetype OpenGLWidget::objectIndexOf(const QString& guid) const {
+    auto it = m_handleByGuid.constFind(guid);
+    return it == m_handleByGuid.constEnd() ? -1 : m_objectIndexByHandle[it.value()];
+}
+
+bool OpenGLWidget::setObjectFlag(ObjectHandle handle, ObjectFlag flag, bool set) {
+    const uint8_t flags = set ? (m_objectFlags[handle] | flag) : (m_objectFlags[handle] & ~flag);
+    if (flags == m_objectFlags[handle])
+        return false;
+    m_objectFlags[handle] = flags;
+    return true;
+}
+
+QList<std::shared_ptr<RenderableMeshGL>> OpenGLWidget::createMeshesGL(const SceneData::Object& object) {
+
+    QList<std::shared_ptr<RenderableMeshGL>> meshesGL;
+    if (!object.meshes)
+        return meshesGL;
+
+    for (const SceneData::Mesh& storedMesh : *object.meshes) {
+        MeshView view(storedMesh); // decoded here if the mesh is kept compressed
+        const SceneData::Mesh& meshData = view.mesh();
+        if (meshData.vertexCount() == 0) {
+            qDebug() << "Skipping empty mesh for object GUID:" << QString::fromStdString(object.guid);
+            continue;
+        }
+
+        auto rmGL = std::make_shared<RenderableMeshGL>();
+        rmGL->vertexCount = meshData.vertexCount();
+
+        // Create and bind VAO for this mesh
+        if (!rmGL->vao.create()) {
+            qWarning() << "Failed to create VAO for mesh GUID:" << QString::fromStdString(object.guid);
+            continue;
+        }
+        rmGL->vao.bind();
+
+        if (meshData.layout() == SceneData::VertexLayout::Packed) {
+            // Single interleaved VBO: float3 position, snorm16x2 octahedral normal decoded by the vertex shader
+            const int stride = sizeof(SceneData::PackedVertex);
+            rmGL->vboVertices.create();
+            rmGL->vboVertices.bind();
+            rmGL->vboVertices.allocate(meshData.packedVertices.data(), meshData.packedVertices.size() * stride);
+            m_program->enableAttributeArray(0); // Position
+            m_program->setAttributeBuffer(0, GL_FLOAT, offsetof(SceneData::PackedVertex, x), 3, stride);
+            m_program->enableAttributeArray(1); // Normal
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride,
+                                  reinterpret_cast<const void*>(offsetof(SceneData::PackedVertex, nx)));
+            rmGL->packedNormals = true;
+        } else {
             // VBO for Vertices
             rmGL->vboVertices.create();
             rmGL->vboVertices.bind();
@@ -123,33 +283,41 @@ void OpenGLWidget::addNewObject(std::shared_ptr<SceneData::Object> pObject) {
             } else {
                 // Handle missing normals by disabling attribute or using a default
                 m_program->disableAttributeArray(1);
-                qDebug() << "Mesh has no normals, GUID:" << QString::fromStdString(pObject->guid);
+                qDebug() << "Mesh has no normals, GUID:" << QString::fromStdString(object.guid);
             }
-
-            rmGL->color = QVector4D(meshData.color.r, meshData.color.g, meshData.color.b, meshData.color.a);
-            rmGL->vao.release();
-            roGL.meshes.append(std::move(rmGL));
         }
+
+        rmGL->color = QVector4D(meshData.color.r, meshData.color.g, meshData.color.b, meshData.color.a);
+        rmGL->gpuBytes = meshData.packedVertices.size() * sizeof(SceneData::PackedVertex)
+                       + (meshData.vertices.size() + meshData.normals.size()) * sizeof(SceneData::Vec3f);
+        IfcMemory::add(IfcMemory::Category::GpuBuffers, rmGL->gpuBytes);
+        rmGL->vao.release();
+        meshesGL.append(std::move(rmGL));
     }
+    return meshesGL;
+}
 
-    m_renderableObjects.append(std::move(roGL));
+void OpenGLWidget::setVisibility(const QString& guid, bool visible)
+{
+    // Objects not loaded yet only need a handle to be hidden
+    auto it = m_handleByGuid.constFind(guid);
+    const bool known = it != m_handleByGuid.constEnd();
+    if (!known && visible)
+        return;
 
-    doneCurrent();
-    update(); // Schedule a repaint
-    qDebug() << "Added object GUID:" << QString::fromStdString(pObject->guid) << "to render queue. Total objects:" << m_renderableObjects.size();
+    if (setObjectFlag(known ? it.value() : handleOf(guid), Hidden, !visible)) update();
 }
 
-void OpenGLWidget::setVisibility(const QString& guid, bool visible)
+void OpenGLWidget::setObjectsVisibility(const QStringList& guids, bool visible)
 {
     bool changed = false;
-    if (visible) {
-        if (m_hiddenGuids.remove(guid)) {
-            changed = true;
-        }
-    } else { // Hide
-        if (!m_hiddenGuids.contains(guid)) {
-            m_hiddenGuids.insert(guid);
-            changed = true;
+    for (const auto& guid : guids) {
+        if (visible) {
+            auto it = m_handleByGuid.constFind(guid);
+            if (it != m_handleByGuid.constEnd())
+                changed |= setObjectFlag(it.value(), Hidden, false);
+        } else {
+            changed |= setObjectFlag(handleOf(guid), Hidden, true);
         }
     }
 
@@ -158,20 +326,30 @@ void OpenGLWidget::setVisibility(const QString& guid, bool visible)
 
 void OpenGLWidget::selectObjects(const QSet<QString>& guids)
 {
-    m_selectedGuids = guids;
+    for (auto handle : m_selectedHandles)
+        setObjectFlag(handle, Selected, false);
+    m_selectedHandles.clear();
+
+    // Objects not loaded yet are highlighted once they are
+    for (const auto& guid : guids) {
+        const auto handle = handleOf(guid);
+        if (setObjectFlag(handle, Selected, true))
+            m_selectedHandles.push_back(handle);
+    }
     update();
 }
 
 void OpenGLWidget::deselect()
 {
-    if(!m_selectedGuids.isEmpty())
+    if(!m_selectedHandles.empty())
     {
-        m_selectedGuids.clear();
+        for (auto handle : m_selectedHandles)
+            setObjectFlag(handle, Selected, false);
+        m_selectedHandles.clear();
         update();
     }
 }
 
-
 //-------------------- OpenGL -------------------------//
 
 void OpenGLWidget::initializeGL()
@@ -185,6 +363,14 @@ void OpenGLWidget::initializeGL()
         uniform mat4 model;
         uniform mat4 view;
         uniform mat4 projection;
+        uniform bool packedNormals; // aNormal.xy is an octahedral encoded normal
+
+        vec3 decodeOctahedral(vec2 e) {
+            vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+            float t = max(-n.z, 0.0);
+            n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+            return normalize(n);
+        }
 
         out vec3 Normal;
         out vec3 FragPos;
@@ -192,7 +378,8 @@ void OpenGLWidget::initializeGL()
 
         void main() {
             FragPos = vec3(model * vec4(aPos, 1.0));
-            Normal = mat3(transpose(inverse(model))) * aNormal;
+            vec3 normal = packedNormals ? decodeOctahedral(aNormal.xy) : aNormal;
+            Normal = mat3(transpose(inverse(model))) * normal;
             gl_Position = projection * view * model * vec4(aPos, 1.0);
             VertColor = vec4(0.8, 0.8, 0.8, 1.0);
         }
@@ -261,18 +448,15 @@ void OpenGLWidget::paintGL() {
     glEnable(GL_CULL_FACE);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-    QList<RenderableObjectGL> selected;
+    bool anySelected = false;
 
     for (auto& roGL : m_renderableObjects) {
 
-        if(m_hiddenGuids.contains(roGL.guid)) continue;
+        const uint8_t flags = m_objectFlags[roGL.handle];
+        if(flags & Hidden) continue;
 
-        bool isSelected = false;
-
-        if(m_selectedGuids.contains(roGL.guid)){
-            selected.push_back(roGL);
-            isSelected = true;
-        }
+        const bool isSelected = flags & Selected;
+        anySelected |= isSelected;
 
         m_program->setUniformValue("model", roGL.transform);
 
@@ -287,13 +471,14 @@ void OpenGLWidget::paintGL() {
                 m_program->setUniformValue("objectColor", m_highlightColor);
             else
                 m_program->setUniformValue("objectColor", meshGL->color.toVector3D());
+            m_program->setUniformValue("packedNormals", meshGL->packedNormals);
 
             glDrawArrays(GL_TRIANGLES, 0, meshGL->vertexCount);
         }
     }
 
     // --- PASS 2: Draw outline for the selected object ---
-    if(!selected.isEmpty())
+    if(anySelected)
     {
         glCullFace(GL_FRONT);
         glDepthMask(GL_FALSE);
@@ -301,7 +486,11 @@ void OpenGLWidget::paintGL() {
         glEnable(GL_POLYGON_OFFSET_FILL);
 
 
-        for (auto& roGL : selected) {
+        for (auto handle : m_selectedHandles) {
+
+            const qsizetype index = m_objectIndexByHandle[handle];
+            if (index < 0 || (m_objectFlags[handle] & Hidden)) continue;
+            const RenderableObjectGL& roGL = m_renderableObjects[index];
 
             QMatrix4x4 scaledModelMatrix = roGL.transform;
             // Scaling should be around the object's center, or it will shift.
@@ -315,6 +504,7 @@ void OpenGLWidget::paintGL() {
             for (auto& meshGL : roGL.meshes) {
                 if (meshGL->vertexCount == 0 || !meshGL->vao.isCreated()) continue;
                 QOpenGLVertexArrayObject::Binder vaoBinder(&meshGL->vao);
+                m_program->setUniformValue("packedNormals", meshGL->packedNormals);
                 glDrawArrays(GL_TRIANGLES, 0, meshGL->vertexCount);
             }
         }
@@ -11,15 +11,23 @@
 #include <QVector3D>
 #include <QVector4D>
 #include <QList>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "SceneData.h"
+#include "IfcMemory.h"
 
 struct RenderableMeshGL {
     QOpenGLVertexArrayObject vao; // VAO to encapsulate VBO bindings and attribute pointers
-    QOpenGLBuffer vboVertices;
+    QOpenGLBuffer vboVertices; // positions, or interleaved positions and normals for packed meshes
     QOpenGLBuffer vboNormals;
     int vertexCount = 0;
+    bool packedNormals = false; // normals are octahedral encoded in vboVertices
+    qint64 gpuBytes = 0;        // size of the VBOs, counted in IfcMemory::Category::GpuBuffers
     QVector4D color;          // Store the actual color for this mesh part
 
     RenderableMeshGL() : vboVertices(QOpenGLBuffer::VertexBuffer), vboNormals(QOpenGLBuffer::VertexBuffer) {}
@@ -29,6 +37,8 @@ struct RenderableMeshGL {
         if (vao.isCreated()) vao.destroy();
         if (vboVertices.isCreated()) vboVertices.destroy();
         if (vboNormals.isCreated()) vboNormals.destroy();
+        IfcMemory::add(IfcMemory::Category::GpuBuffers, -gpuBytes);
+        gpuBytes = 0;
     }
 };
 
@@ -37,6 +47,7 @@ struct RenderableObjectGL {
     QList<std::shared_ptr<RenderableMeshGL>> meshes; // Each object can have multiple meshes (e.g., per material)
     QString guid;
     QString type;
+    uint32_t handle = 0; // see OpenGLWidget::ObjectHandle
 };
 
 class OpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core {
@@ -48,8 +59,13 @@ public:
 
 public slots:
     void addNewObject(std::shared_ptr<SceneData::Object> pObject); // New slot for progressive loading
+    void replaceObjectMeshes(std::shared_ptr<SceneData::Object> pObject); // Swap in refined meshes of a loaded object
+    void addNewObjects(std::shared_ptr<std::vector<SceneData::Object>> spObjects); // Batched progressive loading, one repaint per batch
+    void replaceObjectsMeshes(std::shared_ptr<std::vector<SceneData::Object>> spObjects);
     void clearScene();
+    void removeObjects(const QSet<QString>& guids);
     void setVisibility(const QString& guid, bool visible);
+    void setObjectsVisibility(const QStringList& guids, bool visible); // One repaint for the whole set
     void selectObjects(const QSet<QString>& guids);
     void deselect();
 
@@ -64,12 +80,22 @@ protected:
     void wheelEvent(QWheelEvent *event) override;
 
 private:
+    // Dense number of an object GUID, given on first use and kept until clearScene.
+    // The per-frame state is kept in arrays indexed by handle, GUIDs are only hashed at the slots.
+    using ObjectHandle = uint32_t;
+    enum ObjectFlag : uint8_t {
+        Hidden = 0x1,
+        Selected = 0x2
+    };
+
     qreal m_dpiScale;
     QOpenGLShaderProgram *m_program;
 
     QList<RenderableObjectGL> m_renderableObjects; // Stores all displayable objects
-    QSet<QString> m_hiddenGuids;
-    QSet<QString> m_selectedGuids;
+    QHash<QString, ObjectHandle> m_handleByGuid;
+    std::vector<qsizetype> m_objectIndexByHandle; // Index in m_renderableObjects, -1 if the object is not loaded
+    std::vector<uint8_t> m_objectFlags;          // ObjectFlag bits by handle, also for objects not loaded yet
+    std::vector<ObjectHandle> m_selectedHandles;
 
     // Camera parameters
     QMatrix4x4 m_projectionMatrix;
@@ -83,6 +109,15 @@ private:
 
     QPoint m_lastMousePos;
 
+    // The OpenGL context must be current. An object already loaded is replaced, never drawn twice
+    void appendObject(const SceneData::Object& object);
+    void replaceMeshes(const SceneData::Object& object);
+    QList<std::shared_ptr<RenderableMeshGL>> createMeshesGL(const SceneData::Object& object);
+
+    ObjectHandle handleOf(const QString& guid); // A new handle for a GUID not seen yet
+    qsizetype objectIndexOf(const QString& guid) const; // -1 if the object is not loaded
+    bool setObjectFlag(ObjectHandle handle, ObjectFlag flag, bool set); // true if it changed
+
 
 
 };
@@ -6,10 +6,12 @@
 #include "SceneData.h"
 
 Q_DECLARE_METATYPE(std::shared_ptr<SceneData::Object>);
+Q_DECLARE_METATYPE(std::shared_ptr<std::vector<SceneData::Object>>);
 
 void registerQtMetaType()
 {
     qRegisterMetaType<std::shared_ptr<SceneData::Object>>("std::shared_ptr<SceneData::Object>");
+    qRegisterMetaType<std::shared_ptr<std::vector<SceneData::Object>>>("std::shared_ptr<std::vector<SceneData::Object>>");
 }
 
 #endif // QTREGISTRATION_H
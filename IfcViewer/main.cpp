@@ -4,6 +4,7 @@
 #include <QSurfaceFormat>
 
 #include "QtRegistration.h"
+#include "TaskScheduler.h"
 
 int main(int argc, char *argv[])
 {
@@ -11,6 +12,9 @@ int main(int argc, char *argv[])
 
     registerQtMetaType();
 
+    // IfcCore workers: one per core, minus one kept free for the UI thread
+    TaskScheduler::configure(0, 1);
+
     // --- Configure OpenGL Context ---
     QSurfaceFormat format;
     format.setDepthBufferSize(24);